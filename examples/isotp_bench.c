@@ -0,0 +1,738 @@
+/**
+ * @file isotp_bench.c
+ * @brief Throughput and latency benchmark for the isotp-c RT-Thread adapter.
+ *
+ * The benchmark sends PDUs from a number of sender links to the same number of receiver links and
+ * reports, for every combination of payload size, receiver block size (BS), STmin and link count:
+ * - PDUs/s and payload bytes/s over all links,
+ * - p50/p99 latency from the start of `isotp_rtt_send` to the complete PDU at the receiver,
+ * - CPU load during the run (requires RT_USING_IDLE_HOOK).
+ *
+ * By default it runs over a virtual loopback CAN device registered by this file, on which every
+ * written frame is received again, so results only depend on the adapter and the scheduler and can
+ * be compared between releases. Passing two real CAN devices connected to the same bus measures
+ * the complete system instead. It is run as an MSH command:
+ *
+ * @code
+ * isotp_bench                                  # full sweep over the loopback device
+ * isotp_bench -s 4095 -b 0 -m 0 -l 1 -n 200    # a single case
+ * isotp_bench -d can1 can2                     # over hardware, can1 sends, can2 receives
+ * @endcode
+ *
+ * @author wdfk-prog ()
+ * @version 1.0
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @note :
+ * @par 修改日志:
+ * Date       Version Author      Description
+ * 2026-10-14 1.0     wdfk-prog   first version
+ */
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+#include "isotp_rtt.h"
+
+#define DBG_TAG "isotp.bench"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+/* --- Benchmark Configuration --- */
+#define BENCH_LOOPBACK_NAME     "canlo"  ///< Name of the virtual loopback CAN device.
+#define BENCH_LOOPBACK_DEPTH    64       ///< Frames the loopback device buffers until they are read.
+#define BENCH_MAX_LINKS         8        ///< Maximum number of sender/receiver link pairs.
+#define BENCH_MAX_PDU_SIZE      4095     ///< Largest payload of the sweep.
+#define BENCH_DEFAULT_PDUS      50       ///< PDUs sent per link and case unless `-n` is given.
+#define BENCH_REQ_ID_BASE       0x600    ///< CAN ID of the first sender link, one ID per link.
+#define BENCH_RESP_ID_BASE      0x680    ///< CAN ID of the first receiver link (flow control frames).
+#define BENCH_PDU_TIMEOUT_MS    2000     ///< Timeout of a single send or receive.
+#define BENCH_THREAD_STACK_SIZE 2048     ///< Stack size of the sender and receiver threads.
+#define BENCH_THREAD_PRIO       20       ///< Priority of the sender and receiver threads.
+#define BENCH_RX_MQ_SIZE        64       ///< Frames buffered by the RX consumer without the adapter's RX dispatcher.
+
+/* --- Sweep --- */
+static const rt_uint16_t bench_sizes[]   = {7, 62, 256, 1024, 4095};
+static const rt_uint8_t  bench_bs[]      = {0, 8};
+static const rt_uint32_t bench_st_min[]  = {0, 1000};
+static const rt_uint8_t  bench_links[]   = {1, 4};
+
+#define BENCH_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/**
+ * @brief A sender link, the receiver link it talks to, and the results of the current case.
+ */
+struct bench_pair
+{
+    isotp_rtt_link_t tx_link;       ///< Sends the PDUs.
+    isotp_rtt_link_t rx_link;       ///< Receives the PDUs and sends the flow control frames.
+    uint8_t *payload;               ///< PDU sent by this pair, `bench_payload` with the PDU index in byte 0.
+    uint8_t *tx_buf;                ///< Send buffer of `tx_link`.
+    uint8_t *rx_buf;                ///< Receive buffer of `rx_link`.
+    uint8_t fc_rx_buf[8];           ///< Receive buffer of `tx_link`, which only receives flow control frames.
+    uint8_t fc_tx_buf[8];           ///< Send buffer of `rx_link`, which only sends flow control frames.
+
+    struct rt_semaphore rx_done;    ///< Released by the receiver for the PDU in flight.
+    volatile uint32_t start_us;     ///< Time the PDU in flight was started.
+    volatile rt_uint8_t seq;        ///< Index (modulo 256) of the PDU in flight, carried in its byte 0.
+    uint32_t *samples;              ///< Latency of every received PDU, in microseconds.
+    rt_uint16_t received;           ///< Number of valid entries in `samples`.
+    rt_uint16_t errors;             ///< Failed sends, receive timeouts and corrupted PDUs.
+};
+
+/**
+ * @brief Parameters of the case being run, shared by all threads.
+ */
+struct bench_case
+{
+    rt_uint16_t size;               ///< Payload size.
+    rt_uint16_t count;              ///< PDUs per link.
+    volatile rt_bool_t stop;        ///< Set to end the receiver threads.
+    struct rt_semaphore finished;   ///< Released once by every sender and every receiver thread.
+};
+
+static struct bench_pair bench_pairs[BENCH_MAX_LINKS];
+static struct bench_case bench_run;
+static uint8_t bench_payload[BENCH_MAX_PDU_SIZE];
+static rt_bool_t bench_running = RT_FALSE;
+
+#ifdef RT_USING_IDLE_HOOK
+static volatile rt_uint32_t bench_idle_count; ///< Incremented by the idle thread, see `bench_idle_hook`.
+#endif
+
+/*************************************************************************************************/
+/** @name Virtual Loopback CAN Device
+ *  @{
+ *  @brief A CAN device without hardware: every frame written to it can be read back, and the
+ *         rx_indicate callback is called for it straight away, as a controller in loopback mode would.
+ */
+/*************************************************************************************************/
+
+#if defined(RT_VERSION_CHECK) && (RTTHREAD_VERSION >= RT_VERSION_CHECK(5, 0, 1))
+typedef rt_ssize_t bench_io_size_t;
+#else
+typedef rt_size_t bench_io_size_t;
+#endif
+
+static struct rt_device bench_lo_dev;
+static struct rt_can_msg bench_lo_ring[BENCH_LOOPBACK_DEPTH];
+static rt_uint32_t bench_lo_head, bench_lo_tail;
+
+/**
+ * @brief  Reads buffered frames from the loopback device.
+ * @return The number of bytes read, a multiple of `sizeof(struct rt_can_msg)`.
+ */
+static bench_io_size_t bench_lo_read(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    struct rt_can_msg *msg = (struct rt_can_msg *)buffer;
+    rt_size_t n = 0;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    while ((n + 1) * sizeof(struct rt_can_msg) <= size && bench_lo_tail != bench_lo_head)
+    {
+        msg[n++] = bench_lo_ring[bench_lo_tail++ % BENCH_LOOPBACK_DEPTH];
+    }
+    rt_hw_interrupt_enable(level);
+
+    return n * sizeof(struct rt_can_msg);
+}
+
+/**
+ * @brief  Writes one frame to the loopback device and indicates it as received.
+ * @note   Sender, polling and RX threads write concurrently, while rx_indicate callbacks such as
+ *         the adapter's RX ring expect a single producer. The frame is therefore indicated with
+ *         interrupts disabled, as from the receive interrupt of a real controller, which also
+ *         keeps the indications in the order the frames were written.
+ * @return `sizeof(struct rt_can_msg)`, or 0 if the device buffer is full.
+ */
+static bench_io_size_t bench_lo_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    if (size != sizeof(struct rt_can_msg))
+        return 0;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (bench_lo_head - bench_lo_tail >= BENCH_LOOPBACK_DEPTH)
+    {
+        rt_hw_interrupt_enable(level);
+        return 0;
+    }
+    bench_lo_ring[bench_lo_head++ % BENCH_LOOPBACK_DEPTH] = *(const struct rt_can_msg *)buffer;
+
+    rt_interrupt_enter();
+    if (dev->rx_indicate)
+        dev->rx_indicate(dev, 1);
+    rt_interrupt_leave();
+    rt_hw_interrupt_enable(level);
+    return size;
+}
+
+/**
+ * @brief  Accepts every CAN control command, the loopback device has nothing to configure.
+ */
+static rt_err_t bench_lo_control(rt_device_t dev, int cmd, void *args)
+{
+    return RT_EOK;
+}
+
+#ifdef RT_USING_DEVICE_OPS
+static const struct rt_device_ops bench_lo_ops = {
+    RT_NULL, RT_NULL, RT_NULL, bench_lo_read, bench_lo_write, bench_lo_control,
+};
+#endif
+
+/**
+ * @brief  Registers the loopback device on first use.
+ * @return The device, or RT_NULL if it could not be registered.
+ */
+static rt_device_t bench_lo_get(void)
+{
+    rt_device_t dev = rt_device_find(BENCH_LOOPBACK_NAME);
+    if (dev)
+        return dev;
+
+    rt_memset(&bench_lo_dev, 0, sizeof(bench_lo_dev));
+    bench_lo_dev.type = RT_Device_Class_CAN;
+#ifdef RT_USING_DEVICE_OPS
+    bench_lo_dev.ops = &bench_lo_ops;
+#else
+    bench_lo_dev.read = bench_lo_read;
+    bench_lo_dev.write = bench_lo_write;
+    bench_lo_dev.control = bench_lo_control;
+#endif
+    if (rt_device_register(&bench_lo_dev, BENCH_LOOPBACK_NAME, RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX) != RT_EOK)
+        return RT_NULL;
+    return &bench_lo_dev;
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name CAN Reception
+ *  @{
+ *  @brief With PKG_ISOTP_C_USING_RX_DISPATCHER the devices are attached to the adapter's RX path,
+ *         otherwise the producer-consumer model of isotp_examples.c is used.
+ */
+/*************************************************************************************************/
+
+#ifndef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief A received frame and the device it came from.
+ */
+struct bench_rx_frame
+{
+    rt_device_t dev;
+    struct rt_can_msg msg;
+};
+
+static rt_mq_t bench_rx_mq;
+static rt_thread_t bench_rx_tid;
+
+/**
+ * @brief The consumer thread, feeds received frames into the links of their device.
+ */
+static void bench_rx_consumer_entry(void *parameter)
+{
+    struct bench_rx_frame frame;
+    while (1)
+    {
+        if (rt_mq_recv(bench_rx_mq, &frame, sizeof(frame), RT_WAITING_FOREVER) == sizeof(frame))
+            isotp_rtt_on_can_msg_received_from(frame.dev, &frame.msg);
+    }
+}
+
+/**
+ * @brief The producer, reads every buffered frame and posts it to the message queue.
+ */
+static rt_err_t bench_rx_callback(rt_device_t dev, rt_size_t size)
+{
+    struct bench_rx_frame frame;
+
+    frame.dev = dev;
+    frame.msg.hdr_index = -1;
+    while (rt_device_read(dev, 0, &frame.msg, sizeof(frame.msg)) == sizeof(frame.msg))
+    {
+        if (rt_mq_send(bench_rx_mq, &frame, sizeof(frame)) != RT_EOK)
+            LOG_W("Bench RX queue is full, frame dropped.");
+        frame.msg.hdr_index = -1;
+    }
+    return RT_EOK;
+}
+#endif
+
+/**
+ * @brief  Opens a CAN device and connects it to the adapter.
+ * @param  dev The device.
+ * @param  old_rx_indicate Output: the rx_indicate callback to restore afterwards.
+ * @return RT_EOK on success.
+ */
+static rt_err_t bench_dev_setup(rt_device_t dev, rt_err_t (**old_rx_indicate)(rt_device_t, rt_size_t))
+{
+    rt_bool_t start = RT_TRUE;
+
+    *old_rx_indicate = dev->rx_indicate;
+    if (rt_device_open(dev, RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX) != RT_EOK)
+        return -RT_ERROR;
+
+    if (dev != &bench_lo_dev)
+    {
+        rt_device_control(dev, RT_CAN_CMD_SET_BAUD, (void *)CAN1MBaud);
+        rt_device_control(dev, RT_CAN_CMD_SET_MODE, (void *)RT_CAN_MODE_NORMAL);
+        rt_device_control(dev, RT_CAN_CMD_START, &start);
+    }
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    return isotp_rtt_port_attach(dev);
+#else
+    return rt_device_set_rx_indicate(dev, bench_rx_callback);
+#endif
+}
+
+/**
+ * @brief  Disconnects a CAN device from the adapter and closes it.
+ */
+static void bench_dev_teardown(rt_device_t dev, rt_err_t (*old_rx_indicate)(rt_device_t, rt_size_t))
+{
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    isotp_rtt_port_detach(dev);
+#endif
+    rt_device_set_rx_indicate(dev, old_rx_indicate);
+    rt_device_close(dev);
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Benchmark Threads
+ *  @{
+ *  @brief Every link pair has a sender and a receiver thread. The sender keeps one PDU in flight:
+ *         it starts the next one once the receiver has reported the previous one.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief Sends `count` PDUs on the pair's sender link.
+ */
+static void bench_sender_entry(void *parameter)
+{
+    struct bench_pair *pair = (struct bench_pair *)parameter;
+    rt_int32_t timeout = rt_tick_from_millisecond(BENCH_PDU_TIMEOUT_MS);
+
+    for (rt_uint16_t i = 0; i < bench_run.count; i++)
+    {
+        /* A PDU that timed out may still be reported late: drop its release and retag, so it is
+         * not taken for this one. The receiver checks the tag in the same critical section. */
+        rt_enter_critical();
+        while (rt_sem_trytake(&pair->rx_done) == RT_EOK)
+            ;
+        pair->seq = (rt_uint8_t)i;
+        pair->start_us = isotp_user_get_us();
+        rt_exit_critical();
+        pair->payload[0] = (uint8_t)i;
+        if (isotp_rtt_send(pair->tx_link, pair->payload, bench_run.size, timeout) != ISOTP_RET_OK ||
+            rt_sem_take(&pair->rx_done, timeout) != RT_EOK)
+        {
+            pair->errors++;
+        }
+    }
+    rt_sem_release(&bench_run.finished);
+}
+
+/**
+ * @brief Receives PDUs on the pair's receiver link and records their latency.
+ */
+static void bench_receiver_entry(void *parameter)
+{
+    struct bench_pair *pair = (struct bench_pair *)parameter;
+    rt_int32_t timeout = rt_tick_from_millisecond(BENCH_PDU_TIMEOUT_MS);
+    const uint8_t *pdu;
+    uint16_t size;
+
+    while (!bench_run.stop)
+    {
+        /* Borrowing avoids a copy, so the benchmark measures the adapter rather than itself. */
+        if (isotp_rtt_receive_borrow(pair->rx_link, &pdu, &size, timeout) != RT_EOK)
+            continue;
+
+        rt_bool_t intact = size == bench_run.size && rt_memcmp(pdu + 1, bench_payload + 1, size - 1) == 0;
+        rt_uint8_t tag = pdu[0];
+        isotp_rtt_receive_release(pair->rx_link);
+
+        if (!intact)
+        {
+            pair->errors++;
+            continue;
+        }
+        rt_enter_critical();
+        if (tag == pair->seq)   /* otherwise a PDU whose sender already gave up on it */
+        {
+            uint32_t latency = isotp_user_get_us() - pair->start_us;
+            if (pair->received < bench_run.count)
+                pair->samples[pair->received++] = latency;
+            rt_sem_release(&pair->rx_done);
+        }
+        rt_exit_critical();
+    }
+    rt_sem_release(&bench_run.finished);
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Measurement
+ *  @{
+ */
+/*************************************************************************************************/
+
+#ifdef RT_USING_IDLE_HOOK
+/**
+ * @brief Idle hook counting idle loop iterations, the basis of the CPU load figure.
+ */
+static void bench_idle_hook(void)
+{
+    bench_idle_count++;
+}
+#endif
+
+/**
+ * @brief  Sorts the latency samples in place (shell sort, no allocation).
+ */
+static void bench_sort(uint32_t *v, rt_uint32_t n)
+{
+    for (rt_uint32_t gap = n / 2; gap > 0; gap /= 2)
+    {
+        for (rt_uint32_t i = gap; i < n; i++)
+        {
+            uint32_t tmp = v[i];
+            rt_uint32_t j = i;
+            for (; j >= gap && v[j - gap] > tmp; j -= gap)
+                v[j] = v[j - gap];
+            v[j] = tmp;
+        }
+    }
+}
+
+/**
+ * @brief  Creates the links of one pair with buffers for `size` byte PDUs.
+ * @note   The pair must be destroyed with `bench_pair_destroy` even if this fails.
+ * @return RT_EOK on success, -RT_ENOMEM otherwise.
+ */
+static rt_err_t bench_pair_create(struct bench_pair *pair, int index, rt_device_t tx_dev, rt_device_t rx_dev, rt_uint16_t size)
+{
+    rt_memset(pair, 0, sizeof(*pair));
+    rt_sem_init(&pair->rx_done, "bench_rx", 0, RT_IPC_FLAG_FIFO);
+    pair->payload = rt_malloc(size);
+    pair->tx_buf = rt_malloc(size);
+    pair->rx_buf = rt_malloc(size);
+    pair->samples = rt_malloc(bench_run.count * sizeof(uint32_t));
+    if (!pair->payload || !pair->tx_buf || !pair->rx_buf || !pair->samples)
+        return -RT_ENOMEM;
+    rt_memcpy(pair->payload, bench_payload, size);
+
+    pair->tx_link = isotp_rtt_create(tx_dev, BENCH_REQ_ID_BASE + index, BENCH_RESP_ID_BASE + index, RT_CAN_STDID, RT_CAN_DTR,
+                                     pair->tx_buf, size, pair->fc_rx_buf, sizeof(pair->fc_rx_buf));
+    pair->rx_link = isotp_rtt_create(rx_dev, BENCH_RESP_ID_BASE + index, BENCH_REQ_ID_BASE + index, RT_CAN_STDID, RT_CAN_DTR,
+                                     pair->fc_tx_buf, sizeof(pair->fc_tx_buf), pair->rx_buf, size);
+    return (pair->tx_link && pair->rx_link) ? RT_EOK : -RT_ENOMEM;
+}
+
+/**
+ * @brief  Destroys the links of one pair and frees its buffers.
+ */
+static void bench_pair_destroy(struct bench_pair *pair)
+{
+    if (pair->tx_link)
+        isotp_rtt_destroy(pair->tx_link);
+    if (pair->rx_link)
+        isotp_rtt_destroy(pair->rx_link);
+    rt_sem_detach(&pair->rx_done);
+    rt_free(pair->payload);
+    rt_free(pair->tx_buf);
+    rt_free(pair->rx_buf);
+    rt_free(pair->samples);
+    rt_memset(pair, 0, sizeof(*pair));
+}
+
+/**
+ * @brief  Runs one case and prints its result line.
+ * @param  idle_per_ms Idle loop iterations per millisecond of an idle system, 0 if unknown.
+ */
+static void bench_run_case(rt_device_t tx_dev, rt_device_t rx_dev, rt_uint16_t size, rt_uint8_t bs, rt_uint32_t st_min_us,
+                           rt_uint8_t links, rt_uint16_t count, rt_uint32_t idle_per_ms)
+{
+    rt_uint32_t total = 0, errors = 0;
+    rt_err_t result = RT_EOK;
+    uint32_t *all;
+    int n, created;
+
+    bench_run.size = size;
+    bench_run.count = count;
+    bench_run.stop = RT_FALSE;
+    rt_sem_init(&bench_run.finished, "bench_fin", 0, RT_IPC_FLAG_FIFO);
+
+    for (created = 0; created < links && result == RT_EOK; created++)
+    {
+        result = bench_pair_create(&bench_pairs[created], created, tx_dev, rx_dev, size);
+        if (result == RT_EOK)
+            isotp_rtt_set_rx_flow_control(bench_pairs[created].rx_link, bs, st_min_us);
+    }
+    if (result != RT_EOK)
+    {
+        rt_kprintf("%5u %5u %3u %6u   out of memory\n", links, size, bs, st_min_us);
+        goto cleanup;
+    }
+
+    /* Receivers first, so that no PDU arrives before anybody listens. */
+    int started = 0;
+    for (n = 0; n < links; n++)
+    {
+        rt_thread_t tid = rt_thread_create("bench_rx", bench_receiver_entry, &bench_pairs[n], BENCH_THREAD_STACK_SIZE, BENCH_THREAD_PRIO, 10);
+        if (tid && rt_thread_startup(tid) == RT_EOK)
+            started++;
+    }
+
+#ifdef RT_USING_IDLE_HOOK
+    rt_uint32_t idle_start = bench_idle_count;
+#endif
+    uint32_t start_us = isotp_user_get_us();
+
+    int senders = 0;
+    for (n = 0; n < links; n++)
+    {
+        rt_thread_t tid = rt_thread_create("bench_tx", bench_sender_entry, &bench_pairs[n], BENCH_THREAD_STACK_SIZE, BENCH_THREAD_PRIO, 10);
+        if (tid && rt_thread_startup(tid) == RT_EOK)
+            senders++;
+    }
+    for (n = 0; n < senders; n++)
+        rt_sem_take(&bench_run.finished, RT_WAITING_FOREVER);
+
+    uint32_t elapsed_us = isotp_user_get_us() - start_us;
+#ifdef RT_USING_IDLE_HOOK
+    rt_uint32_t idle = bench_idle_count - idle_start;
+#endif
+
+    /* Receivers notice `stop` at their next receive timeout at the latest. */
+    bench_run.stop = RT_TRUE;
+    for (n = 0; n < started; n++)
+        rt_sem_take(&bench_run.finished, RT_WAITING_FOREVER);
+
+    for (n = 0; n < links; n++)
+    {
+        total += bench_pairs[n].received;
+        errors += bench_pairs[n].errors;
+    }
+    if (senders < links || total == 0 || elapsed_us == 0)
+    {
+        rt_kprintf("%5u %5u %3u %6u   failed (%u errors)\n", links, size, bs, st_min_us, errors);
+        goto cleanup;
+    }
+
+    /* Merge the samples of all pairs for the percentiles. */
+    all = rt_malloc(total * sizeof(uint32_t));
+    if (!all)
+    {
+        rt_kprintf("%5u %5u %3u %6u   out of memory\n", links, size, bs, st_min_us);
+        goto cleanup;
+    }
+    rt_uint32_t k = 0;
+    for (n = 0; n < links; n++)
+    {
+        rt_memcpy(&all[k], bench_pairs[n].samples, bench_pairs[n].received * sizeof(uint32_t));
+        k += bench_pairs[n].received;
+    }
+    bench_sort(all, total);
+
+    char cpu[8] = "n/a";
+#ifdef RT_USING_IDLE_HOOK
+    if (idle_per_ms)
+    {
+        rt_uint64_t idle_expected = (rt_uint64_t)idle_per_ms * elapsed_us / 1000;
+        rt_uint32_t load = idle >= idle_expected ? 0 : (rt_uint32_t)(100 - (rt_uint64_t)idle * 100 / idle_expected);
+        rt_snprintf(cpu, sizeof(cpu), "%u%%", load);
+    }
+#endif
+
+    rt_kprintf("%5u %5u %3u %6u %8u %9u %8u %8u %5s %6u\n", links, size, bs, st_min_us,
+               (rt_uint32_t)((rt_uint64_t)total * 1000000 / elapsed_us),
+               (rt_uint32_t)((rt_uint64_t)total * size * 1000000 / elapsed_us),
+               all[total / 2], all[(total * 99) / 100], cpu, errors);
+    rt_free(all);
+
+cleanup:
+    /* Only the pairs that were set up, including the one that failed. */
+    for (n = 0; n < created; n++)
+        bench_pair_destroy(&bench_pairs[n]);
+    rt_sem_detach(&bench_run.finished);
+}
+
+/**
+ * @brief  Measures the idle loop rate of the otherwise idle system.
+ * @return Idle loop iterations per millisecond, 0 without RT_USING_IDLE_HOOK.
+ */
+static rt_uint32_t bench_calibrate_idle(void)
+{
+#ifdef RT_USING_IDLE_HOOK
+    rt_uint32_t idle_start = bench_idle_count;
+    uint32_t start_us = isotp_user_get_us();
+    rt_thread_mdelay(200);
+    uint32_t elapsed_us = isotp_user_get_us() - start_us;
+    return elapsed_us ? (rt_uint32_t)((rt_uint64_t)(bench_idle_count - idle_start) * 1000 / elapsed_us) : 0;
+#else
+    return 0;
+#endif
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name MSH Command Implementation
+ *  @{
+ */
+/*************************************************************************************************/
+
+static void bench_usage(void)
+{
+    rt_kprintf("Usage: isotp_bench [-d tx_dev rx_dev] [-n pdus] [-s size] [-b bs] [-m stmin_us] [-l links]\n");
+    rt_kprintf("  Without -d the virtual loopback device '%s' is used.\n", BENCH_LOOPBACK_NAME);
+    rt_kprintf("  -s/-b/-m/-l fix one dimension of the sweep, -n sets the PDUs per link (default %d).\n", BENCH_DEFAULT_PDUS);
+}
+
+/**
+ * @brief MSH command entry point of the benchmark.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return RT_EOK, or -RT_EINVAL on invalid arguments.
+ */
+static int isotp_bench(int argc, char **argv)
+{
+    const char *tx_name = RT_NULL, *rx_name = RT_NULL;
+    long count = BENCH_DEFAULT_PDUS, size = -1, bs = -1, st_min = -1, links = -1;
+    rt_err_t (*old_tx_rx_indicate)(rt_device_t, rt_size_t) = RT_NULL;
+    rt_err_t (*old_rx_rx_indicate)(rt_device_t, rt_size_t) = RT_NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!rt_strcmp(argv[i], "-d") && i + 2 < argc)
+        {
+            tx_name = argv[++i];
+            rx_name = argv[++i];
+        }
+        else if (i + 1 < argc && argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0')
+        {
+            long value = atol(argv[++i]);
+            switch (argv[i - 1][1])
+            {
+            case 'n': count = value; break;
+            case 's': size = value; break;
+            case 'b': bs = value; break;
+            case 'm': st_min = value; break;
+            case 'l': links = value; break;
+            default: bench_usage(); return -RT_EINVAL;
+            }
+        }
+        else
+        {
+            bench_usage();
+            return -RT_EINVAL;
+        }
+    }
+    if (count < 1 || count > 0xFFFF || size == 0 || size > BENCH_MAX_PDU_SIZE || bs > 0xFF || st_min > 127000 ||
+        links == 0 || links > BENCH_MAX_LINKS)
+    {
+        bench_usage();
+        return -RT_EINVAL;
+    }
+    if (bench_running)
+    {
+        rt_kprintf("isotp_bench is already running.\n");
+        return -RT_EBUSY;
+    }
+
+    rt_device_t tx_dev = tx_name ? rt_device_find(tx_name) : bench_lo_get();
+    rt_device_t rx_dev = rx_name ? rt_device_find(rx_name) : tx_dev;
+    if (!tx_dev || !rx_dev)
+    {
+        rt_kprintf("CAN device not found.\n");
+        return -RT_EINVAL;
+    }
+    bench_running = RT_TRUE;
+
+    for (rt_size_t i = 0; i < sizeof(bench_payload); i++)
+        bench_payload[i] = (uint8_t)(i * 7 + 1);
+
+#ifndef PKG_ISOTP_C_USING_RX_DISPATCHER
+    bench_rx_mq = rt_mq_create("bench_mq", sizeof(struct bench_rx_frame), BENCH_RX_MQ_SIZE, RT_IPC_FLAG_FIFO);
+    bench_rx_tid = rt_thread_create("bench_con", bench_rx_consumer_entry, RT_NULL, BENCH_THREAD_STACK_SIZE, BENCH_THREAD_PRIO - 1, 10);
+    if (!bench_rx_mq || !bench_rx_tid)
+    {
+        rt_kprintf("Failed to create the RX consumer.\n");
+        goto exit;
+    }
+    rt_thread_startup(bench_rx_tid);
+#endif
+
+    if (bench_dev_setup(tx_dev, &old_tx_rx_indicate) != RT_EOK ||
+        (rx_dev != tx_dev && bench_dev_setup(rx_dev, &old_rx_rx_indicate) != RT_EOK))
+    {
+        rt_kprintf("Failed to set up the CAN devices.\n");
+        goto teardown;
+    }
+
+#ifdef RT_USING_IDLE_HOOK
+    rt_thread_idle_sethook(bench_idle_hook);
+#endif
+    rt_uint32_t idle_per_ms = bench_calibrate_idle();
+
+    rt_kprintf("ISO-TP benchmark on %.*s -> %.*s, %ld PDUs per link\n", RT_NAME_MAX, tx_dev->parent.name,
+               RT_NAME_MAX, rx_dev->parent.name, count);
+    rt_kprintf("links  size  bs  stmin   pdus/s   bytes/s  p50(us)  p99(us)   cpu errors\n");
+
+    for (rt_size_t l = 0; l < BENCH_ARRAY_SIZE(bench_links); l++)
+    {
+        if (links > 0 && l > 0)
+            break;
+        rt_uint8_t case_links = links > 0 ? (rt_uint8_t)links : bench_links[l];
+
+        for (rt_size_t s = 0; s < BENCH_ARRAY_SIZE(bench_sizes); s++)
+        {
+            if (size > 0 && s > 0)
+                break;
+            rt_uint16_t case_size = size > 0 ? (rt_uint16_t)size : bench_sizes[s];
+
+            for (rt_size_t b = 0; b < BENCH_ARRAY_SIZE(bench_bs); b++)
+            {
+                if (bs >= 0 && b > 0)
+                    break;
+                for (rt_size_t m = 0; m < BENCH_ARRAY_SIZE(bench_st_min); m++)
+                {
+                    if (st_min >= 0 && m > 0)
+                        break;
+                    bench_run_case(tx_dev, rx_dev, case_size, bs >= 0 ? (rt_uint8_t)bs : bench_bs[b],
+                                   st_min >= 0 ? (rt_uint32_t)st_min : bench_st_min[m], case_links, (rt_uint16_t)count, idle_per_ms);
+                }
+            }
+        }
+    }
+
+#ifdef RT_USING_IDLE_HOOK
+    rt_thread_idle_delhook(bench_idle_hook);
+#endif
+
+teardown:
+    bench_dev_teardown(tx_dev, old_tx_rx_indicate);
+    if (rx_dev != tx_dev)
+        bench_dev_teardown(rx_dev, old_rx_rx_indicate);
+#ifndef PKG_ISOTP_C_USING_RX_DISPATCHER
+exit:
+    if (bench_rx_tid)
+        rt_thread_delete(bench_rx_tid);
+    if (bench_rx_mq)
+        rt_mq_delete(bench_rx_mq);
+    bench_rx_tid = RT_NULL;
+    bench_rx_mq = RT_NULL;
+#endif
+    bench_running = RT_FALSE;
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(isotp_bench, ISO-TP throughput and latency benchmark);
+/** @} */
@@ -323,6 +323,7 @@ static void isotp_example_start(void)
     rt_device_close(can1_dev);
     rt_device_close(can2_dev);
 
+#ifndef PKG_ISOTP_C_USING_RX_DISPATCHER
     /* 3. Create IPC objects and the consumer thread. */
     can_rx_mq = rt_mq_create("can_rx_mq", sizeof(struct rt_can_msg), CAN_RX_MQ_SIZE, RT_IPC_FLAG_FIFO);
     if (!can_rx_mq)
@@ -342,13 +343,14 @@ static void isotp_example_start(void)
         LOG_E("Failed to create consumer thread.");
         return;
     }
+#endif
 
     /* 4. Open devices and configure hardware. */
     rt_device_open(can1_dev, RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX);
     rt_device_open(can2_dev, RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX);
 
-    /* 4a. Configure hardware filters. */
-#ifdef RT_CAN_USING_HDR
+    /* 4a. Configure hardware filters. With PKG_ISOTP_C_USING_HW_FILTER the adapter programs them per link. */
+#if defined(RT_CAN_USING_HDR) && !defined(PKG_ISOTP_C_USING_HW_FILTER)
     struct rt_can_filter_item items[] = {
         {
             .id = 0,                    // 当掩码为0时, ID可以是任意值, 0最清晰
@@ -378,9 +380,16 @@ static void isotp_example_start(void)
     rt_device_control(can2_dev, RT_CAN_CMD_SET_MODE, (void *)RT_CAN_MODE_NORMAL);
 
     /* 5. Set our new RX callback. */
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    /* The adapter owns the RX path: it installs its own rx_indicate hook and dispatcher thread. */
+    LOG_I("Attaching CAN devices to the ISO-TP RX dispatcher...");
+    isotp_rtt_port_attach(can1_dev);
+    isotp_rtt_port_attach(can2_dev);
+#else
     LOG_I("Setting up new rx_indicate callbacks...");
     rt_device_set_rx_indicate(can1_dev, can_rx_callback);
     rt_device_set_rx_indicate(can2_dev, can_rx_callback);
+#endif
 
     /* 6. Create and start application threads. */
     server_tid = rt_thread_create("isotp_server", server_thread_entry, RT_NULL, 2048, 22, 10);
@@ -428,6 +437,13 @@ static void isotp_example_stop(void)
 
     /* 2. Restore original device context and close devices. */
     LOG_I("Restoring original rx_indicate and closing devices...");
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    /* Detaching restores the rx_indicate callback the devices had when they were attached. */
+    if (can1_dev)
+        isotp_rtt_port_detach(can1_dev);
+    if (can2_dev)
+        isotp_rtt_port_detach(can2_dev);
+#endif
     if (can1_dev)
     {
         rt_device_set_rx_indicate(can1_dev, old_can1_rx_indicate);
@@ -11,10 +11,15 @@
 
 #include "isotp.h"
 
+#if (ISO_TP_DEFAULT_TX_DL < 8) || (ISO_TP_DEFAULT_TX_DL > ISO_TP_MAX_FRAME_LEN)
+    #error "ISO_TP_DEFAULT_TX_DL must be between 8 and ISO_TP_MAX_FRAME_LEN"
+#endif
+
 ///////////////////////////////////////////////////////
 ///                 STATIC FUNCTIONS                ///
 ///////////////////////////////////////////////////////
 
+#ifndef ISO_TP_DISABLE_RECEIVE
 /* st_min to microsecond */
 static uint8_t isotp_us_to_st_min(uint32_t us) {
     // ISO 15765-2:2016 defines STmin encoding:
@@ -35,7 +40,9 @@ static uint8_t isotp_us_to_st_min(uint32_t us) {
 
     return 0;
 }
+#endif
 
+#ifndef ISO_TP_DISABLE_TRANSMIT
 /* st_min to usec  */
 static uint32_t isotp_st_min_to_us(uint8_t st_min) {
     // ISO 15765-2:2016 defines STmin encoding:
@@ -56,236 +63,507 @@ static uint32_t isotp_st_min_to_us(uint8_t st_min) {
     return 0;
 }
 
+#endif
+
+/* round a frame length up to the next valid CAN (FD) data length */
+static uint8_t isotp_can_dl_align(uint8_t len) {
+    // CAN FD only allows data lengths of 0..8, 12, 16, 20, 24, 32, 48 and 64 bytes
+    static const uint8_t CAN_FD_DL[] = {12, 16, 20, 24, 32, 48, 64};
+    uint8_t              i;
+
+    if (len <= 8) { return len; }
+    for (i = 0; i < sizeof(CAN_FD_DL); i++) {
+        if (len <= CAN_FD_DL[i]) { return CAN_FD_DL[i]; }
+    }
+    return 0xFF;
+}
+
+/* number of address bytes in front of the PCI: one with extended and mixed addressing */
+#ifdef ISO_TP_ADDRESSING
+    #define isotp_addr_len(link) ((uint8_t)((link)->addr_mode >= ISOTP_ADDRESSING_EXTENDED ? 1u : 0u))
+#else
+    #define isotp_addr_len(link) ((uint8_t)0u)
+#endif
+
+/* length of the CAN frame carrying `len` bytes of PCI and payload, not counting the address byte */
+static uint8_t isotp_frame_length(const IsoTpLink* link, uint8_t len) {
+    uint8_t addr_len = isotp_addr_len(link);
+
+    len = (uint8_t)(len + addr_len);
+    if (link->frame_padding && len < 8) { return (uint8_t)(8u - addr_len); }
+    // frames longer than 8 bytes are always padded up to the next DLC step
+    return (uint8_t)(isotp_can_dl_align(len) - addr_len);
+}
+
+/* largest payload of a single frame for a given TX_DL / RX_DL */
+static uint32_t isotp_single_frame_max(uint8_t dl, uint8_t addr_len) {
+    // ISO 15765-2:2016: CAN_DL > 8 needs the two-byte escape sequence header
+    return (dl <= 8) ? (uint32_t)(7u - addr_len) : (uint32_t)(dl - 2u - addr_len);
+}
+
+/* writes the address byte at the start of a frame, returns where its PCI goes */
+static uint8_t* isotp_frame_pci(const IsoTpLink* link, uint8_t* frame) {
+#ifdef ISO_TP_ADDRESSING
+    if (isotp_addr_len(link)) {
+        frame[0] = link->send_addr;
+        return frame + 1;
+    }
+#else
+    (void)link;
+#endif
+    return frame;
+}
+
+/* returns the buffer a frame of `pci_type` is formatted in: the shim's with ISO_TP_USER_SEND_CAN_ALLOC,
+ * `local` otherwise; NULL if the shim has none free */
+static uint8_t* isotp_frame_begin(const IsoTpLink* link, uint32_t id, uint8_t pci_type, uint8_t* local) {
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+    (void)local;
+    return isotp_user_alloc_can(id, pci_type
+    #if defined(ISO_TP_USER_SEND_CAN_ARG)
+                                , link->user_send_can_arg
+    #endif
+    );
+#else
+    (void)link;
+    (void)id;
+    (void)pci_type;
+    return local;
+#endif
+}
+
+/* sends a frame of `size` bytes formatted in the buffer of isotp_frame_begin, a size of zero drops it */
+static int isotp_frame_end(const IsoTpLink* link, uint32_t id, uint8_t* frame, uint8_t size) {
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+    return isotp_user_commit_can(id, frame, size
+    #if defined(ISO_TP_USER_SEND_CAN_ARG)
+                                 , link->user_send_can_arg
+    #endif
+    );
+#else
+    if (0 == size) { return ISOTP_RET_OK; }
+    return isotp_user_send_can(id, frame, size
+    #if defined(ISO_TP_USER_SEND_CAN_ARG)
+                               , link->user_send_can_arg
+    #endif
+    );
+#endif
+}
+
+#ifndef ISO_TP_DISABLE_RECEIVE
 static int isotp_send_flow_control(const IsoTpLink* link, uint8_t flow_status, uint8_t block_size, uint32_t st_min_us) {
-    IsoTpCanMessage message;
-    (void)memset(&message, 0, sizeof(message));
-    int             ret;
-    uint8_t         size = 0;
+    uint8_t  local[ISO_TP_MAX_FRAME_LEN];
+    uint8_t* frame = isotp_frame_begin(link, link->send_arbitration_id, ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME, local);
+    uint8_t* pci;
+    uint8_t  size;
+
+    if (NULL == frame) { return ISOTP_RET_NOSPACE; }
 
     /* setup message  */
-    message.as.flow_control.type  = ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME;
-    message.as.flow_control.FS    = flow_status;
-    message.as.flow_control.BS    = block_size;
-    message.as.flow_control.STmin = isotp_us_to_st_min(st_min_us);
+    pci    = isotp_frame_pci(link, frame);
+    pci[0] = (uint8_t)((ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME << 4) | (flow_status & 0x0F));
+    pci[1] = block_size;
+    pci[2] = isotp_us_to_st_min(st_min_us);
 
     /* send message */
-#ifdef ISO_TP_FRAME_PADDING
-    (void)memset(message.as.flow_control.reserve, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.flow_control.reserve));
-    size = sizeof(message);
-#else
-    size = 3;
+    size = isotp_frame_length(link, 3);
+    (void)memset(pci + 3, link->frame_padding_value, size - 3);
+
+    return isotp_frame_end(link, link->send_arbitration_id, frame, (uint8_t)(size + isotp_addr_len(link)));
+}
+
+/* send the flow control frame decided for a reception, one the shim has no space for is sent again from isotp_poll */
+static void isotp_receive_flow_control_out(IsoTpLink* link) {
+    int ret;
+
+    if (link->receive_fc_wait) {
+        ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_WAIT, 0, 0);
+    } else {
+        ret = isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, link->receive_fc_st_min_us);
+    }
+
+    /* refresh timer cr, retries of a pending flow control frame do not extend it */
+    if (ISOTP_RET_NOSPACE != ret || 0 == link->receive_fc_pending) { link->receive_timer_cr = isotp_user_get_us() + link->response_timeout_us; }
+    link->receive_fc_pending = (ISOTP_RET_NOSPACE == ret) ? 1 : 0;
+}
+
+/* send the next flow control frame of a reception, as decided by the policy */
+static void isotp_receive_send_flow_control(IsoTpLink* link) {
+    uint8_t  block_size  = link->receive_block_size;
+    uint32_t st_min_us   = link->receive_st_min_us;
+    uint8_t  flow_status = PCI_FLOW_STATUS_CONTINUE;
+
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+    if (link->fc_policy_cb != NULL) { flow_status = link->fc_policy_cb(link, &block_size, &st_min_us, link->fc_policy_cb_arg); }
 #endif
 
-    ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, size
-#if defined(ISO_TP_USER_SEND_CAN_ARG)
-                              , link->user_send_can_arg
+    if (PCI_FLOW_STATUS_WAIT == flow_status && link->receive_wft_count < link->max_wft_number) {
+        link->receive_wft_count += 1;
+        link->receive_fc_wait    = 1;
+        link->receive_timer_wait = isotp_user_get_us() + link->response_timeout_us / 4; // well within the sender's N_Bs
+    } else {
+        /* continue, also forced once the allowed number of FC.WAIT is used up */
+        link->receive_wft_count = 0;
+        link->receive_fc_wait   = 0;
+        link->receive_bs_count  = block_size;
+    }
+
+    link->receive_fc_st_min_us = st_min_us;
+    link->receive_fc_pending   = 0;
+    isotp_receive_flow_control_out(link);
+}
 #endif
-    );
 
-    return ret;
+#ifndef ISO_TP_DISABLE_TRANSMIT
+/* copies len payload bytes from offset on into a frame, from the send buffer or the streaming source */
+static int isotp_send_load(const IsoTpLink* link, isotp_size_t offset, uint8_t* data, uint32_t len) {
+#ifdef ISO_TP_STREAMING_SEND
+    if (link->send_source_cb != NULL) { return link->send_source_cb((void*)link, offset, data, (uint8_t)len, link->send_source_cb_arg); }
+#endif
+    (void)memcpy(data, link->send_buffer + offset, len);
+    return ISOTP_RET_OK;
 }
 
 static int isotp_send_single_frame(const IsoTpLink* link, uint32_t id) {
     (void)id; // Prevent unused variable warning
 
-    IsoTpCanMessage message;
-    int             ret;
-    uint8_t         size = 0;
+    uint8_t  local[ISO_TP_MAX_FRAME_LEN];
+    uint8_t* frame;
+    uint8_t* pci;
+    uint8_t  length = (uint8_t)(link->send_size + 1);
+    uint8_t  size   = 0;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size <= 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size <= isotp_single_frame_max(link->send_tx_dl, isotp_addr_len(link)));
 
-    /* setup message  */
-    message.as.single_frame.type  = ISOTP_PCI_TYPE_SINGLE;
-    message.as.single_frame.SF_DL = (uint8_t)link->send_size;
-    (void)memcpy(message.as.single_frame.data, link->send_buffer, link->send_size);
+    frame = isotp_frame_begin(link, link->send_arbitration_id, ISOTP_PCI_TYPE_SINGLE, local);
+    if (NULL == frame) { return ISOTP_RET_NOSPACE; }
 
-    /* send message */
-#ifdef ISO_TP_FRAME_PADDING
-    (void)memset(message.as.single_frame.data + link->send_size, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.single_frame.data) - link->send_size);
-    size = sizeof(message);
-#else
-    size = link->send_size + (uint8_t)1;
+    /* setup message  */
+    pci = isotp_frame_pci(link, frame);
+#ifdef ISO_TP_CAN_FD
+    if (link->send_size > 7u - isotp_addr_len(link)) { // ISO15765-2:2016
+        pci[0] = (uint8_t)(ISOTP_PCI_TYPE_SINGLE << 4);
+        pci[1] = (uint8_t)link->send_size;
+        length = (uint8_t)(link->send_size + 2);
+    } else
 #endif
+    {
+        pci[0] = (uint8_t)((ISOTP_PCI_TYPE_SINGLE << 4) | link->send_size);
+    }
+    if (ISOTP_RET_OK != isotp_send_load(link, 0, pci + length - link->send_size, link->send_size)) {
+        (void)isotp_frame_end(link, link->send_arbitration_id, frame, 0);
+        return ISOTP_RET_ERROR;
+    }
 
-    ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, size
-#if defined(ISO_TP_USER_SEND_CAN_ARG)
-                              , link->user_send_can_arg
-#endif
-    );
+    /* send message */
+    size = isotp_frame_length(link, length);
+    if (size > length) { (void)memset(pci + length, link->frame_padding_value, size - length); }
 
-    return ret;
+    return isotp_frame_end(link, link->send_arbitration_id, frame, (uint8_t)(size + isotp_addr_len(link)));
 }
+
 static int isotp_send_first_frame(IsoTpLink* link, uint32_t id) {
-    IsoTpCanMessage message = {0};
-    int             ret     = 0;
+    uint8_t  local[ISO_TP_MAX_FRAME_LEN];
+    uint8_t* frame;
+    uint8_t* pci;
+    int      ret    = 0;
+    uint8_t  dl     = (uint8_t)(link->send_tx_dl - isotp_addr_len(link));
+    uint8_t  header = 2;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_single_frame_max(link->send_tx_dl, isotp_addr_len(link)));
 
+    frame = isotp_frame_begin(link, id, ISOTP_PCI_TYPE_FIRST_FRAME, local);
+    if (NULL == frame) { return ISOTP_RET_NOSPACE; }
+
+    /* a first frame always uses the full TX_DL */
+    pci = isotp_frame_pci(link, frame);
     if (link->send_size <= 4095) {
         /* setup 'short' message */
-        message.as.first_frame_short.type       = ISOTP_PCI_TYPE_FIRST_FRAME;
-        message.as.first_frame_short.FF_DL_low  = (uint8_t)link->send_size;
-        message.as.first_frame_short.FF_DL_high = (uint8_t)(0x0F & (link->send_size >> 8));
-        (void)memcpy(message.as.first_frame_short.data, link->send_buffer, sizeof(message.as.first_frame_short.data));
-
-        /* send 'short' message */
-        ret = isotp_user_send_can(id, message.as.data_array.ptr, sizeof(message)
-#if defined(ISO_TP_USER_SEND_CAN_ARG)
-                                  , link->user_send_can_arg
-#endif
-        );
-
-        if (ISOTP_RET_OK == ret) { link->send_offset += sizeof(message.as.first_frame_short.data); }
+        pci[0] = (uint8_t)((ISOTP_PCI_TYPE_FIRST_FRAME << 4) | (0x0F & (link->send_size >> 8)));
+        pci[1] = (uint8_t)link->send_size;
     } else { // ISO15765-2:2016
-        /* setup 'long' message */
-        message.as.first_frame_long.set_to_zero_high = 0;
-        message.as.first_frame_long.set_to_zero_low  = 0;
-        message.as.first_frame_long.type             = ISOTP_PCI_TYPE_FIRST_FRAME;
-        message.as.first_frame_long.FF_DL            = LE32TOH(link->send_size);
-        (void)memcpy(message.as.first_frame_long.data, link->send_buffer, sizeof(message.as.first_frame_long.data));
-
-        /* send 'long' message */
-        ret = isotp_user_send_can(id, message.as.data_array.ptr, sizeof(message)
-#if defined(ISO_TP_USER_SEND_CAN_ARG)
-                                                                     ,
-                                  link->user_send_can_arg
-#endif
-        );
-
-        if (ISOTP_RET_OK == ret) { link->send_offset += sizeof(message.as.first_frame_long.data); }
+        /* setup 'long' message, FF_DL is big endian after the escape sequence */
+        pci[0] = (uint8_t)(ISOTP_PCI_TYPE_FIRST_FRAME << 4);
+        pci[1] = 0;
+        pci[2] = (uint8_t)((uint32_t)link->send_size >> 24);
+        pci[3] = (uint8_t)((uint32_t)link->send_size >> 16);
+        pci[4] = (uint8_t)(link->send_size >> 8);
+        pci[5] = (uint8_t)link->send_size;
+        header = 6;
+    }
+    if (ISOTP_RET_OK != isotp_send_load(link, 0, pci + header, dl - header)) {
+        (void)isotp_frame_end(link, id, frame, 0);
+        return ISOTP_RET_ERROR;
     }
 
+    /* send message */
+    ret = isotp_frame_end(link, id, frame, link->send_tx_dl);
+    if (ISOTP_RET_OK == ret) { link->send_offset += dl - header; }
+
     link->send_sn = 1;
 
     return ret;
 }
 
-static int isotp_send_consecutive_frame(IsoTpLink* link) {
-    IsoTpCanMessage message;
-    uint32_t        data_length;
-    int             ret;
-    uint8_t         size = 0;
+/* formats the consecutive frame carrying the payload from offset on into `frame`, returns ISOTP_RET_OK and
+ * the frame size, or ISOTP_RET_NO_DATA if a streaming source does not have that payload yet */
+static int isotp_fill_consecutive_frame(const IsoTpLink* link, uint8_t* frame, isotp_size_t offset, uint8_t sn, uint8_t* size,
+                                        isotp_size_t* data_length) {
+    isotp_size_t length = link->send_size - offset;
+    uint8_t*     pci    = isotp_frame_pci(link, frame);
+    int          ret;
+
+    pci[0] = (uint8_t)((ISOTP_PCI_TYPE_CONSECUTIVE_FRAME << 4) | sn);
+    if (length > link->send_tx_dl - 1u - isotp_addr_len(link)) { length = link->send_tx_dl - 1u - isotp_addr_len(link); }
+    ret = isotp_send_load(link, offset, pci + 1, length);
+    if (ISOTP_RET_OK != ret) { return (ISOTP_RET_NO_DATA == ret) ? ret : ISOTP_RET_ERROR; }
+
+    /* only the last frame may be shorter than TX_DL */
+    *size = isotp_frame_length(link, (uint8_t)(length + 1));
+    (void)memset(pci + 1 + length, link->frame_padding_value, *size - length - 1);
+    *size = (uint8_t)(*size + isotp_addr_len(link));
+
+    *data_length = length;
+    return ISOTP_RET_OK;
+}
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+#ifndef ISO_TP_USER_SEND_CAN_BATCH
+static int isotp_send_consecutive_frames(IsoTpLink* link, uint32_t max_frames, uint32_t* sent) {
+    uint8_t      local[ISO_TP_MAX_FRAME_LEN];
+    uint8_t*     frame;
+    isotp_size_t data_length;
+    int          ret;
+    uint8_t      size = 0;
 
-    /* setup message  */
-    message.as.consecutive_frame.type = ISOTP_PCI_TYPE_CONSECUTIVE_FRAME;
-    message.as.consecutive_frame.SN   = link->send_sn;
-    data_length                       = link->send_size - link->send_offset;
-    if (data_length > sizeof(message.as.consecutive_frame.data)) { data_length = sizeof(message.as.consecutive_frame.data); }
-    (void)memcpy(message.as.consecutive_frame.data, link->send_buffer + link->send_offset, data_length);
+    (void)max_frames;
 
-    /* send message */
-#ifdef ISO_TP_FRAME_PADDING
-    (void)memset(message.as.consecutive_frame.data + data_length, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.consecutive_frame.data) - data_length);
-    size = sizeof(message);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_single_frame_max(link->send_tx_dl, isotp_addr_len(link)));
+
+    *sent = 0;
+
+    frame = isotp_frame_begin(link, link->send_arbitration_id, ISOTP_PCI_TYPE_CONSECUTIVE_FRAME, local);
+    if (NULL == frame) { return ISOTP_RET_NOSPACE; }
+
+    /* setup and send message */
+    ret = isotp_fill_consecutive_frame(link, frame, link->send_offset, link->send_sn, &size, &data_length);
+    if (ISOTP_RET_OK != ret) {
+        (void)isotp_frame_end(link, link->send_arbitration_id, frame, 0);
+        return ret;
+    }
+
+    ret = isotp_frame_end(link, link->send_arbitration_id, frame, size);
+
+    if (ISOTP_RET_OK == ret) {
+        link->send_offset += data_length;
+        if (++(link->send_sn) > 0x0F) { link->send_sn = 0; }
+        *sent = 1;
+    }
+
+    return ret;
+}
 #else
-    size = data_length + 1;
-#endif
+/* sends up to max_frames consecutive frames with one isotp_user_send_can_batch call */
+static int isotp_send_consecutive_frames(IsoTpLink* link, uint32_t max_frames, uint32_t* sent) {
+    uint8_t      frames[ISO_TP_MAX_CF_BATCH][ISO_TP_MAX_FRAME_LEN];
+    uint8_t      sizes[ISO_TP_MAX_CF_BATCH];
+    isotp_size_t lengths[ISO_TP_MAX_CF_BATCH] = {0};
+    isotp_size_t offset = link->send_offset;
+    uint8_t      sn     = link->send_sn;
+    uint8_t      count  = 0;
+    int          ret;
+
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_single_frame_max(link->send_tx_dl, isotp_addr_len(link)));
+
+    if (max_frames > ISO_TP_MAX_CF_BATCH) { max_frames = ISO_TP_MAX_CF_BATCH; }
+
+    *sent = 0;
+
+    /* setup messages, stop at the end of the payload; a source error or missing payload ends the batch early */
+    while (count < max_frames && offset < link->send_size) {
+        ret = isotp_fill_consecutive_frame(link, frames[count], offset, sn, &sizes[count], &lengths[count]);
+        if (ISOTP_RET_OK != ret) {
+            if (0 == count) { return ret; }
+            break;
+        }
+        offset += lengths[count];
+        sn = (uint8_t)((sn + 1u) & 0x0F);
+        count++;
+    }
 
-    ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, size
+    ret = isotp_user_send_can_batch(link->send_arbitration_id, frames[0], sizes, count
 #if defined(ISO_TP_USER_SEND_CAN_ARG)
-                              , link->user_send_can_arg
+                                    , link->user_send_can_arg
 #endif
     );
 
-    if (ISOTP_RET_OK == ret) {
-        link->send_offset += data_length;
+    if (ret < 0) { return ret; }
+    if (ret > count) { ret = count; }
+
+    /* account for the frames the shim accepted, the rest is sent again on the next call */
+    for (*sent = 0; *sent < (uint32_t)ret; (*sent)++) {
+        link->send_offset += lengths[*sent];
         if (++(link->send_sn) > 0x0F) { link->send_sn = 0; }
     }
 
-    return ret;
+    return (ret == count) ? ISOTP_RET_OK : ISOTP_RET_NOSPACE;
 }
+#endif
+#endif
+
+#ifndef ISO_TP_DISABLE_RECEIVE
+/* the handlers below parse the PCI straight from the received frame, `data` starts at the PCI byte */
+static int isotp_receive_single_frame(IsoTpLink* link, const uint8_t* data, uint8_t len) {
+    uint8_t sf_dl = data[0] & 0x0F;
+
+#ifdef ISO_TP_CAN_FD
+    /* CAN FD frames longer than 8 bytes carry SF_DL in the byte after the escape sequence */
+    if (len + isotp_addr_len(link) > 8) {
+        if (0 != sf_dl) {
+            isotp_user_debug("Single-frame escape sequence missing.");
+            return ISOTP_RET_LENGTH;
+        }
+        sf_dl = data[1];
+        data += 1;
+        len  -= 1;
+    }
+#endif
 
-static int isotp_receive_single_frame(IsoTpLink* link, const IsoTpCanMessage* message, uint8_t len) {
     /* check data length */
-    if ((0 == message->as.single_frame.SF_DL) || (message->as.single_frame.SF_DL > (len - 1))) {
+    if ((0 == sf_dl) || (sf_dl > (len - 1))) {
         isotp_user_debug("Single-frame length too small.");
         return ISOTP_RET_LENGTH;
     }
 
+    if (sf_dl > link->receive_buf_size) {
+        isotp_user_debug("Single-frame too large for receiving buffer.");
+        return ISOTP_RET_OVERFLOW;
+    }
+
     /* copying data */
-    (void)memcpy(link->receive_buffer, message->as.single_frame.data, message->as.single_frame.SF_DL);
-    link->receive_size = message->as.single_frame.SF_DL;
+    (void)memcpy(link->receive_buffer, data + 1, sf_dl);
+    link->receive_size = sf_dl;
+
+    return ISOTP_RET_OK;
+}
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+/* tells the sink that the streamed reception in progress was abandoned */
+static void isotp_receive_stream_abort(IsoTpLink* link) {
+    if (link->receive_streaming) {
+        link->receive_streaming = 0;
+        (void)link->receive_sink_cb(link, link->receive_offset, NULL, 0, link->receive_size, link->receive_sink_cb_arg);
+    }
+}
+#endif
 
+/* stores received payload at receive_offset; a streamed reception flushes every full chunk to the sink */
+static int isotp_receive_store(IsoTpLink* link, const uint8_t* data, uint32_t len) {
+#ifdef ISO_TP_STREAMING_RECEIVE
+    if (link->receive_streaming) {
+        while (len > 0) {
+            uint32_t staged = link->receive_offset % link->receive_buf_size;
+            uint32_t n      = link->receive_buf_size - staged;
+            int      ret;
+
+            if (n > len) { n = len; }
+            (void)memcpy(link->receive_buffer + staged, data, n);
+            link->receive_offset += (isotp_size_t)n;
+            data += n;
+            len -= n;
+
+            if (staged + n < link->receive_buf_size && link->receive_offset < link->receive_size) { continue; }
+            ret = link->receive_sink_cb(link, link->receive_offset - (staged + n), link->receive_buffer, staged + n, link->receive_size,
+                                        link->receive_sink_cb_arg);
+            if (ISOTP_RET_OK != ret) {
+                isotp_receive_stream_abort(link);
+                return ISOTP_RET_ERROR;
+            }
+        }
+        return ISOTP_RET_OK;
+    }
+#endif
+    (void)memcpy(link->receive_buffer + link->receive_offset, data, len);
+    link->receive_offset += (isotp_size_t)len;
     return ISOTP_RET_OK;
 }
 
-static int isotp_receive_first_frame(IsoTpLink* link, IsoTpCanMessage* message, uint8_t len) {
-    uint8_t  is_long_packet = 0;
+static int isotp_receive_first_frame(IsoTpLink* link, const uint8_t* data, uint8_t len) {
+    uint8_t  header = 2;
+    uint8_t  rx_dl  = (uint8_t)(len + isotp_addr_len(link));
     uint32_t payload_length;
 
-    if (8 != len) {
-        isotp_user_debug("First frame should be 8 bytes in length.");
+    /* the first frame defines RX_DL: 8 bytes, or a full CAN FD data length */
+    if (rx_dl < 8 || isotp_can_dl_align(rx_dl) != rx_dl) {
+        isotp_user_debug("First frame should be 8 bytes in length or a valid CAN FD length.");
         return ISOTP_RET_LENGTH;
     }
 
     /* check data length */
-    payload_length = message->as.first_frame_short.FF_DL_high;
-    payload_length = (payload_length << 8) + message->as.first_frame_short.FF_DL_low;
+    payload_length = ((uint32_t)(data[0] & 0x0F) << 8) | data[1];
 
-    /* if length is ZERO we get a long message > 4095bytes of payload */
+    /* if length is ZERO we get a long message > 4095bytes of payload, FF_DL is big endian */
     if (payload_length == 0) {
-        is_long_packet = 1;
-        payload_length = LE32TOH(message->as.first_frame_long.FF_DL);
+        header         = 6;
+        payload_length = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
     }
 
     /* should not use multiple frame transmition */
-    if (payload_length <= 7) {
+    if (payload_length <= isotp_single_frame_max(rx_dl, isotp_addr_len(link))) {
         isotp_user_debug("Should not use multiple frame transmission.");
         return ISOTP_RET_LENGTH;
     }
 
+#ifdef ISO_TP_STREAMING_RECEIVE
+    /* a streamed PDU only has to fit the link's size type, the buffer just stages chunks */
+    link->receive_streaming = (link->receive_sink_cb != NULL && link->receive_buf_size > 0) ? 1 : 0;
+    if (link->receive_streaming ? (payload_length > ISOTP_SIZE_MAX) : (payload_length > link->receive_buf_size)) {
+        link->receive_streaming = 0;
+#else
     if (payload_length > link->receive_buf_size) {
+#endif
         isotp_user_debug("Multi-frame response too large for receiving buffer.");
         return ISOTP_RET_OVERFLOW;
     }
 
-    /* copying data */
-    if (is_long_packet) {
-        (void)memcpy(link->receive_buffer, message->as.first_frame_long.data, sizeof(message->as.first_frame_long.data));
-        link->receive_offset = sizeof(message->as.first_frame_long.data);
-    } else {
-        (void)memcpy(link->receive_buffer, message->as.first_frame_short.data, sizeof(message->as.first_frame_short.data));
-        link->receive_offset = sizeof(message->as.first_frame_short.data);
-    }
-
-    link->receive_size = payload_length;
-    link->receive_sn   = 1;
+    link->receive_rx_dl  = rx_dl;
+    link->receive_size   = (isotp_size_t)payload_length;
+    link->receive_sn     = 1;
+    link->receive_offset = 0;
 
-    return ISOTP_RET_OK;
+    /* copying data */
+    return isotp_receive_store(link, data + header, (uint32_t)(len - header));
 }
 
-static int isotp_receive_consecutive_frame(IsoTpLink* link, const IsoTpCanMessage* message, uint8_t len) {
+static int isotp_receive_consecutive_frame(IsoTpLink* link, const uint8_t* data, uint8_t len) {
     uint32_t remaining_bytes;
 
     /* check sn */
-    if (link->receive_sn != message->as.consecutive_frame.SN) { return ISOTP_RET_WRONG_SN; }
+    if (link->receive_sn != (data[0] & 0x0F)) { return ISOTP_RET_WRONG_SN; }
 
     /* check data length */
     remaining_bytes = link->receive_size - link->receive_offset;
-    if (remaining_bytes > sizeof(message->as.consecutive_frame.data)) { remaining_bytes = sizeof(message->as.consecutive_frame.data); }
+    if (remaining_bytes > link->receive_rx_dl - 1u - isotp_addr_len(link)) { remaining_bytes = link->receive_rx_dl - 1u - isotp_addr_len(link); }
     if (remaining_bytes > (uint32_t)(len - 1)) {
         isotp_user_debug("Consecutive frame too short.");
         return ISOTP_RET_LENGTH;
     }
 
     /* copying data */
-    (void)memcpy(link->receive_buffer + link->receive_offset, message->as.consecutive_frame.data, remaining_bytes);
-
-    link->receive_offset += remaining_bytes;
     if (++(link->receive_sn) > 0x0F) { link->receive_sn = 0; }
 
-    return ISOTP_RET_OK;
+    return isotp_receive_store(link, data + 1, remaining_bytes);
 }
+#endif
 
-static int isotp_receive_flow_control_frame(IsoTpLink* link, IsoTpCanMessage* message, uint8_t len) {
+#ifndef ISO_TP_DISABLE_TRANSMIT
+static int isotp_receive_flow_control_frame(IsoTpLink* link, const uint8_t* data, uint8_t len) {
     /* unused args */
     (void)link;
-    (void)message;
+    (void)data;
 
     /* check message length */
     if (len < 3) {
@@ -295,16 +573,50 @@ static int isotp_receive_flow_control_frame(IsoTpLink* link, IsoTpCanMessage* me
 
     return ISOTP_RET_OK;
 }
+#endif
 
 ///////////////////////////////////////////////////////
 ///                 PUBLIC FUNCTIONS                ///
 ///////////////////////////////////////////////////////
 
+#ifndef ISO_TP_DISABLE_TRANSMIT
 int isotp_send(IsoTpLink* link, const uint8_t payload[], uint32_t size) { return isotp_send_with_id(link, link->send_arbitration_id, payload, size); }
 
-int isotp_send_with_id(IsoTpLink* link, uint32_t id, const uint8_t payload[], uint32_t size) {
+/* starts the transmission set up in send_size and the send buffer or source */
+static int isotp_send_start(IsoTpLink* link, uint32_t id) {
     int ret;
 
+    link->send_offset = 0;
+
+    if (link->send_size <= isotp_single_frame_max(link->send_tx_dl, isotp_addr_len(link))) {
+        /* send single frame */
+        ret = isotp_send_single_frame(link, id);
+#ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
+        if (ret == ISOTP_RET_OK && link->tx_done_cb) { link->tx_done_cb(link, link->send_size, link->tx_done_cb_arg); }
+#endif
+    } else {
+        /* send multi-frame */
+        ret = isotp_send_first_frame(link, id);
+
+        /* init multi-frame control flags */
+        if (ISOTP_RET_OK == ret) {
+            link->send_bs_remain       = 0;
+            link->send_st_min_us       = 0;
+            link->send_wtf_count       = 0;
+            link->send_timer_st        = isotp_user_get_us();
+            link->send_timer_bs        = isotp_user_get_us() + link->response_timeout_us;
+            link->send_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+            link->send_status          = ISOTP_SEND_STATUS_INPROGRESS;
+#ifdef ISO_TP_ACTIVE_CALLBACK
+            if (link->active_cb != NULL) { link->active_cb(link, link->active_cb_arg); }
+#endif
+        }
+    }
+
+    return ret;
+}
+
+int isotp_send_with_id(IsoTpLink* link, uint32_t id, const uint8_t payload[], uint32_t size) {
     if (link == 0x0) {
         isotp_user_debug("Link is null!");
         return ISOTP_RET_ERROR;
@@ -330,55 +642,67 @@ int isotp_send_with_id(IsoTpLink* link, uint32_t id, const uint8_t payload[], ui
     }
 
     /* copy into local buffer */
-    link->send_size   = size;
-    link->send_offset = 0;
+    link->send_size = (isotp_size_t)size;
     (void)memcpy(link->send_buffer, payload, size);
-
-    if (link->send_size < 8) {
-        /* send single frame */
-        ret = isotp_send_single_frame(link, id);
-#ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
-        if (ret == ISOTP_RET_OK && link->tx_done_cb) { link->tx_done_cb(link, link->send_size, link->tx_done_cb_arg); }
+#ifdef ISO_TP_STREAMING_SEND
+    link->send_source_cb = NULL;
 #endif
-    } else {
-        /* send multi-frame */
-        ret = isotp_send_first_frame(link, id);
 
-        /* init multi-frame control flags */
-        if (ISOTP_RET_OK == ret) {
-            link->send_bs_remain       = 0;
-            link->send_st_min_us       = 0;
-            link->send_wtf_count       = 0;
-            link->send_timer_st        = isotp_user_get_us();
-            link->send_timer_bs        = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
-            link->send_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-            link->send_status          = ISOTP_SEND_STATUS_INPROGRESS;
-        }
+    return isotp_send_start(link, id);
+}
+
+#ifdef ISO_TP_STREAMING_SEND
+int isotp_send_stream(IsoTpLink* link, uint32_t size, isotp_tx_source_cb cb, void* arg) {
+    if (link == 0x0 || cb == NULL || size == 0 || size > ISOTP_SIZE_MAX) {
+        isotp_user_debug("Invalid streaming send arguments!");
+        return ISOTP_RET_ERROR;
     }
 
-    return ret;
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
+        isotp_user_debug("Abort previous message, transmission in progress.\n");
+        return ISOTP_RET_INPROGRESS;
+    }
+
+    /* nothing is staged, frames are formatted straight from the source */
+    link->send_size          = (isotp_size_t)size;
+    link->send_source_cb     = cb;
+    link->send_source_cb_arg = arg;
+
+    return isotp_send_start(link, link->send_arbitration_id);
 }
+#endif
+#endif
 
 void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
-    IsoTpCanMessage message;
-    int             ret;
+    int ret;
 
-    if (len < 2 || len > 8) { return; }
+    if (len < 2 || len > ISO_TP_MAX_FRAME_LEN) { return; }
 
-    memcpy(message.as.data_array.ptr, data, len);
-    memset(message.as.data_array.ptr + len, 0, sizeof(message.as.data_array.ptr) - len);
+#ifdef ISO_TP_ADDRESSING
+    /* frames for other targets may share the CAN ID, only those with our address byte are handled */
+    if (isotp_addr_len(link)) {
+        if (data[0] != link->receive_addr) { return; }
+        data += 1;
+        len  -= 1;
+    }
+#endif
 
-    switch (message.as.common.type) {
+    /* the frame is handled in place, the PCI type is the high nibble of its first byte */
+    switch (data[0] >> 4) {
+#ifndef ISO_TP_DISABLE_RECEIVE
         case ISOTP_PCI_TYPE_SINGLE: {
             /* update protocol result */
             if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+#ifdef ISO_TP_STREAMING_RECEIVE
+                isotp_receive_stream_abort(link);
+#endif
             } else {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
             }
 
             /* handle message */
-            ret = isotp_receive_single_frame(link, &message, len);
+            ret = isotp_receive_single_frame(link, data, len);
 
             if (ISOTP_RET_OK == ret) {
                 /* change status */
@@ -390,12 +714,25 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
             /* update protocol result */
             if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+#ifdef ISO_TP_STREAMING_RECEIVE
+                isotp_receive_stream_abort(link);
+#endif
             } else {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
             }
 
             /* handle message */
-            ret = isotp_receive_first_frame(link, &message, len);
+            ret = isotp_receive_first_frame(link, data, len);
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+            /* the sink refused the first chunk, tell the sender to give up */
+            if (ISOTP_RET_ERROR == ret && link->receive_sink_cb != NULL) {
+                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
+                link->receive_status          = ISOTP_RECEIVE_STATUS_IDLE;
+                isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+                break;
+            }
+#endif
 
             /* if overflow happened */
             if (ISOTP_RET_OVERFLOW == ret) {
@@ -412,11 +749,14 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
             if (ISOTP_RET_OK == ret) {
                 /* change status */
                 link->receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
-                /* send fc frame */
-                link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_US);
-                /* refresh timer cs */
-                link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+                /* send fc frame, refreshes timer cr */
+                link->receive_wft_count = 0;
+                isotp_receive_send_flow_control(link);
+#ifdef ISO_TP_ACTIVE_CALLBACK
+                if (link->active_cb != NULL && ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
+                    link->active_cb(link, link->active_cb_arg);
+                }
+#endif
             }
 
             break;
@@ -429,76 +769,104 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
             }
 
             /* handle message */
-            ret = isotp_receive_consecutive_frame(link, &message, len);
+            ret = isotp_receive_consecutive_frame(link, data, len);
 
             /* if wrong sn */
             if (ISOTP_RET_WRONG_SN == ret) {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_WRONG_SN;
                 link->receive_status          = ISOTP_RECEIVE_STATUS_IDLE;
+#ifdef ISO_TP_STREAMING_RECEIVE
+                isotp_receive_stream_abort(link);
+#endif
                 break;
             }
 
+#ifdef ISO_TP_STREAMING_RECEIVE
+            /* the sink refused a chunk, the rest of the PDU is ignored */
+            if (ISOTP_RET_ERROR == ret && link->receive_streaming == 0 && link->receive_sink_cb != NULL) {
+                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_ERROR;
+                link->receive_status          = ISOTP_RECEIVE_STATUS_IDLE;
+                break;
+            }
+#endif
+
             /* if success */
             if (ISOTP_RET_OK == ret) {
                 /* refresh timer cs */
-                link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+                link->receive_timer_cr = isotp_user_get_us() + link->response_timeout_us;
 
                 /* receive finished */
                 if (link->receive_offset >= link->receive_size) {
+#ifdef ISO_TP_STREAMING_RECEIVE
+                    /* the sink already has the whole PDU */
+                    if (link->receive_streaming) {
+                        link->receive_streaming = 0;
+                        link->receive_status    = ISOTP_RECEIVE_STATUS_IDLE;
+                        break;
+                    }
+#endif
                     link->receive_status = ISOTP_RECEIVE_STATUS_FULL;
                 } else {
-                    /* send fc when bs reaches limit */
-                    if (0 == --link->receive_bs_count) {
-                        link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                        isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_US);
-                    }
+                    /* send fc when bs reaches limit, a block size of zero means no limit */
+                    if (0 != link->receive_bs_count && 0 == --link->receive_bs_count) { isotp_receive_send_flow_control(link); }
                 }
             }
 
             break;
         }
+#endif
+#ifndef ISO_TP_DISABLE_TRANSMIT
         case ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME:
             /* handle fc frame only when sending in progress  */
             if (ISOTP_SEND_STATUS_INPROGRESS != link->send_status) { break; }
 
             /* handle message */
-            ret = isotp_receive_flow_control_frame(link, &message, len);
+            ret = isotp_receive_flow_control_frame(link, data, len);
 
             if (ISOTP_RET_OK == ret) {
                 /* refresh bs timer */
-                link->send_timer_bs = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+                link->send_timer_bs = isotp_user_get_us() + link->response_timeout_us;
 
                 /* overflow */
-                if (PCI_FLOW_STATUS_OVERFLOW == message.as.flow_control.FS) {
+                uint8_t flow_status = data[0] & 0x0F;
+
+                if (PCI_FLOW_STATUS_OVERFLOW == flow_status) {
                     link->send_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
                     link->send_status          = ISOTP_SEND_STATUS_ERROR;
                 }
 
                 /* wait */
-                else if (PCI_FLOW_STATUS_WAIT == message.as.flow_control.FS) {
+                else if (PCI_FLOW_STATUS_WAIT == flow_status) {
                     link->send_wtf_count += 1;
                     /* wait exceed allowed count */
-                    if (link->send_wtf_count > ISO_TP_MAX_WFT_NUMBER) {
+                    if (link->send_wtf_count > link->max_wft_number) {
                         link->send_protocol_result = ISOTP_PROTOCOL_RESULT_WFT_OVRN;
                         link->send_status          = ISOTP_SEND_STATUS_ERROR;
                     }
                 }
 
                 /* permit send */
-                else if (PCI_FLOW_STATUS_CONTINUE == message.as.flow_control.FS) {
-                    if (0 == message.as.flow_control.BS) {
+                else if (PCI_FLOW_STATUS_CONTINUE == flow_status) {
+                    if (0 == data[1]) {
                         link->send_bs_remain = ISOTP_INVALID_BS;
                     } else {
-                        link->send_bs_remain = message.as.flow_control.BS;
+                        link->send_bs_remain = data[1];
                     }
-                    uint32_t message_st_min_us = isotp_st_min_to_us(message.as.flow_control.STmin);
-                    link->send_st_min_us       = message_st_min_us > ISO_TP_DEFAULT_ST_MIN_US
+                    uint32_t message_st_min_us = isotp_st_min_to_us(data[2]);
+                    link->send_st_min_us       = message_st_min_us > link->send_st_min_floor_us
                                                      ? message_st_min_us
-                                                     : ISO_TP_DEFAULT_ST_MIN_US; // prefer as much st_min as possible for stability?
+                                                     : link->send_st_min_floor_us; // prefer as much st_min as possible for stability?
                     link->send_wtf_count       = 0;
                 }
+
+                /* reserved flow status */
+                else {
+                    link->send_protocol_result = ISOTP_PROTOCOL_RESULT_INVALID_FS;
+                    link->send_status          = ISOTP_SEND_STATUS_ERROR;
+                }
             }
             break;
+#endif
         default: break;
     };
 
@@ -512,6 +880,7 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
     return;
 }
 
+#ifndef ISO_TP_DISABLE_RECEIVE
 int isotp_receive(IsoTpLink* link, uint8_t* payload, const uint32_t payload_size, uint32_t* out_size) {
     uint32_t copylen;
 
@@ -532,16 +901,82 @@ int isotp_receive(IsoTpLink* link, uint8_t* payload, const uint32_t payload_size
 
     return ISOTP_RET_OK;
 }
+#endif
+
+void isotp_link_config_init(IsoTpLinkConfig* config) {
+    if (config == NULL) { return; }
+
+    config->block_size          = ISO_TP_DEFAULT_BLOCK_SIZE;
+    config->st_min_us           = ISO_TP_DEFAULT_ST_MIN_US;
+    config->tx_st_min_floor_us  = ISO_TP_DEFAULT_ST_MIN_US;
+    config->response_timeout_us = ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+    config->max_wft_number      = ISO_TP_MAX_WFT_NUMBER;
+#ifdef ISO_TP_FRAME_PADDING
+    config->frame_padding       = 1;
+#else
+    config->frame_padding       = 0;
+#endif
+    config->frame_padding_value = ISO_TP_FRAME_PADDING_VALUE;
+    config->tx_dl               = ISO_TP_DEFAULT_TX_DL;
+#ifdef ISO_TP_ADDRESSING
+    config->addr_mode           = ISOTP_ADDRESSING_NORMAL;
+    config->send_addr           = 0;
+    config->receive_addr        = 0;
+#endif
+}
 
 void isotp_init_link(IsoTpLink* link, uint32_t sendid, uint8_t* sendbuf, uint32_t sendbufsize, uint8_t* recvbuf, uint32_t recvbufsize) {
+    isotp_init_link_with_config(link, sendid, sendbuf, sendbufsize, recvbuf, recvbufsize, NULL);
+}
+
+void isotp_init_link_with_config(IsoTpLink* link, uint32_t sendid, uint8_t* sendbuf, uint32_t sendbufsize, uint8_t* recvbuf, uint32_t recvbufsize,
+                                 const IsoTpLinkConfig* config) {
+    IsoTpLinkConfig defaults;
+
+    if (config == NULL) {
+        isotp_link_config_init(&defaults);
+        config = &defaults;
+    }
+
+    if (sendbufsize > ISOTP_SIZE_MAX || recvbufsize > ISOTP_SIZE_MAX) {
+        isotp_user_debug("Buffer larger than ISOTP_SIZE_MAX, only the first ISOTP_SIZE_MAX bytes are used.");
+        if (sendbufsize > ISOTP_SIZE_MAX) { sendbufsize = ISOTP_SIZE_MAX; }
+        if (recvbufsize > ISOTP_SIZE_MAX) { recvbufsize = ISOTP_SIZE_MAX; }
+    }
+
     memset(link, 0, sizeof(*link));
-    link->receive_status      = ISOTP_RECEIVE_STATUS_IDLE;
-    link->send_status         = ISOTP_SEND_STATUS_IDLE;
+    link->response_timeout_us = config->response_timeout_us;
+    link->max_wft_number      = config->max_wft_number;
+    link->frame_padding       = config->frame_padding;
+    link->frame_padding_value = config->frame_padding_value;
     link->send_arbitration_id = sendid;
+    link->receive_block_size  = config->block_size;
+    link->receive_st_min_us   = config->st_min_us;
+#ifdef ISO_TP_ADDRESSING
+    if (ISOTP_RET_OK != isotp_set_addressing(link, config->addr_mode, config->send_addr, config->receive_addr)) {
+        isotp_user_debug("Invalid addressing in link config, using normal addressing.");
+    }
+#endif
+
+#ifndef ISO_TP_DISABLE_TRANSMIT
+    link->send_status         = ISOTP_SEND_STATUS_IDLE;
+    link->send_tx_dl          = ISO_TP_DEFAULT_TX_DL;
     link->send_buffer         = sendbuf;
-    link->send_buf_size       = sendbufsize;
+    link->send_buf_size       = (isotp_size_t)sendbufsize;
+    link->send_st_min_floor_us = config->tx_st_min_floor_us;
+
+    if (ISOTP_RET_OK != isotp_set_tx_dl(link, config->tx_dl)) { isotp_user_debug("Invalid TX_DL in link config, using ISO_TP_DEFAULT_TX_DL."); }
+#else
+    (void)sendbuf;
+#endif
+
+#ifndef ISO_TP_DISABLE_RECEIVE
+    link->receive_status      = ISOTP_RECEIVE_STATUS_IDLE;
     link->receive_buffer      = recvbuf;
-    link->receive_buf_size    = recvbufsize;
+    link->receive_buf_size    = (isotp_size_t)recvbufsize;
+#else
+    (void)recvbuf;
+#endif
 
 #ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
     link->tx_done_cb     = NULL;
@@ -553,6 +988,16 @@ void isotp_init_link(IsoTpLink* link, uint32_t sendid, uint8_t* sendbuf, uint32_
     link->rx_done_cb_arg = NULL;
 #endif
 
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+    link->fc_policy_cb     = NULL;
+    link->fc_policy_cb_arg = NULL;
+#endif
+
+#ifdef ISO_TP_ACTIVE_CALLBACK
+    link->active_cb     = NULL;
+    link->active_cb_arg = NULL;
+#endif
+
     return;
 }
 
@@ -575,20 +1020,53 @@ void isotp_destroy_link(IsoTpLink* link) {
 }
 
 void isotp_poll(IsoTpLink* link) {
+    /* only read the clock when an operation is in progress */
+#ifndef ISO_TP_DISABLE_TRANSMIT
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
+        isotp_poll_with_time(link, isotp_user_get_us());
+        return;
+    }
+#endif
+#ifndef ISO_TP_DISABLE_RECEIVE
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) { isotp_poll_with_time(link, isotp_user_get_us()); }
+#endif
+}
+
+void isotp_poll_with_time(IsoTpLink* link, uint32_t now) {
     int ret = 0;
 
+    (void)ret;
+
+#ifndef ISO_TP_DISABLE_TRANSMIT
     /* only polling when operation in progress */
     if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
-        /* continue send data */
-        if (/* send data if bs_remain is invalid or bs_remain large than zero */
-            (ISOTP_INVALID_BS == link->send_bs_remain || link->send_bs_remain > 0) &&
-            /* and if st_min is zero or go beyond interval time */
-            (0 == link->send_st_min_us || IsoTpTimeAfter(isotp_user_get_us(), link->send_timer_st))) {
-            ret = isotp_send_consecutive_frame(link);
-            if (ISOTP_RET_OK == ret) {
-                if (ISOTP_INVALID_BS != link->send_bs_remain) { link->send_bs_remain -= 1; }
-                link->send_timer_bs = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
-                link->send_timer_st = isotp_user_get_us() + link->send_st_min_us;
+#if ISO_TP_MAX_CF_BURST > 0
+        uint32_t burst = 0;
+#endif
+
+        /* continue send data, as many frames as the current block and STmin allow */
+        while (ISOTP_SEND_STATUS_INPROGRESS == link->send_status &&
+               /* send data if bs_remain is invalid or bs_remain large than zero */
+               (ISOTP_INVALID_BS == link->send_bs_remain || link->send_bs_remain > 0) &&
+               /* and if st_min is zero or go beyond interval time */
+               (0 == link->send_st_min_us || IsoTpTimeAfter(now, link->send_timer_st))) {
+            /* without STmin, the rest of the block may go out in one batch */
+            uint32_t window = (ISOTP_INVALID_BS == link->send_bs_remain) ? UINT32_MAX : link->send_bs_remain;
+            uint32_t sent   = 0;
+            if (0 != link->send_st_min_us) { window = 1; }
+#if ISO_TP_MAX_CF_BURST > 0
+            if (window > ISO_TP_MAX_CF_BURST - burst) { window = ISO_TP_MAX_CF_BURST - burst; }
+#endif
+
+            ret = isotp_send_consecutive_frames(link, window, &sent);
+#if ISO_TP_MAX_CF_BURST > 0
+            burst += sent;
+#endif
+            if (sent > 0) {
+                now = isotp_user_get_us();
+                if (ISOTP_INVALID_BS != link->send_bs_remain) { link->send_bs_remain -= (uint16_t)sent; }
+                link->send_timer_bs = now + link->response_timeout_us;
+                link->send_timer_st = now + link->send_st_min_us;
 
                 /* check if send finish */
                 if (link->send_offset >= link->send_size) {
@@ -596,33 +1074,114 @@ void isotp_poll(IsoTpLink* link) {
 #ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
                     if (link->tx_done_cb != NULL) { link->tx_done_cb(link, link->send_size, link->tx_done_cb_arg); }
 #endif
+                    break;
                 }
-            } else if (ISOTP_RET_NOSPACE == ret) {
-                /* shim reported that it isn't able to send a frame at present, retry on next call */
+            }
+
+            if (ISOTP_RET_OK == ret) {
+                /* the whole window went out, continue */
+            } else if (ISOTP_RET_NOSPACE == ret || ISOTP_RET_NO_DATA == ret) {
+                /* shim reported that it isn't able to send a frame at present, or the streaming
+                 * source does not have its payload yet, retry on next call */
+                break;
             } else {
                 link->send_status = ISOTP_SEND_STATUS_ERROR;
+                break;
             }
+
+#if ISO_TP_MAX_CF_BURST > 0
+            if (burst >= ISO_TP_MAX_CF_BURST) { break; }
+#endif
         }
 
         /* check timeout */
-        if (IsoTpTimeAfter(isotp_user_get_us(), link->send_timer_bs)) {
+        if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status && IsoTpTimeAfter(now, link->send_timer_bs)) {
             link->send_protocol_result = ISOTP_PROTOCOL_RESULT_TIMEOUT_BS;
             link->send_status          = ISOTP_SEND_STATUS_ERROR;
         }
     }
+#endif
 
+#ifndef ISO_TP_DISABLE_RECEIVE
     /* only polling when operation in progress */
     if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
+        if (link->receive_fc_pending) {
+            /* the shim had no space for the last flow control frame */
+            isotp_receive_flow_control_out(link);
+            now = isotp_user_get_us();
+        } else if (link->receive_fc_wait && IsoTpTimeAfter(now, link->receive_timer_wait)) {
+            /* sender was told to wait, ask the policy again */
+            isotp_receive_send_flow_control(link);
+            now = isotp_user_get_us();
+        }
+
         /* check timeout */
-        if ((link->receive_timer_cr > 0) && IsoTpTimeAfter(isotp_user_get_us(), link->receive_timer_cr)) {
+        if ((link->receive_timer_cr > 0) && IsoTpTimeAfter(now, link->receive_timer_cr)) {
             link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_TIMEOUT_CR;
             link->receive_status          = ISOTP_RECEIVE_STATUS_IDLE;
+#ifdef ISO_TP_STREAMING_RECEIVE
+            isotp_receive_stream_abort(link);
+#endif
         }
     }
+#endif
 
     return;
 }
 
+#ifndef ISO_TP_DISABLE_TRANSMIT
+int isotp_set_tx_dl(IsoTpLink* link, uint8_t tx_dl) {
+    if (link == NULL) { return ISOTP_RET_ERROR; }
+
+    if (tx_dl < 8 || tx_dl > ISO_TP_MAX_FRAME_LEN || isotp_can_dl_align(tx_dl) != tx_dl) {
+        isotp_user_debug("Invalid TX_DL, must be 8 or a CAN FD data length up to ISO_TP_MAX_FRAME_LEN.");
+        return ISOTP_RET_ERROR;
+    }
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) { return ISOTP_RET_INPROGRESS; }
+
+    link->send_tx_dl = tx_dl;
+    return ISOTP_RET_OK;
+}
+#endif
+
+#ifdef ISO_TP_ADDRESSING
+int isotp_set_addressing(IsoTpLink* link, uint8_t addr_mode, uint8_t send_addr, uint8_t receive_addr) {
+    if (link == NULL || addr_mode > ISOTP_ADDRESSING_MIXED) { return ISOTP_RET_ERROR; }
+
+    /* the frame layout must not change under a segmented transfer */
+#ifndef ISO_TP_DISABLE_TRANSMIT
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) { return ISOTP_RET_INPROGRESS; }
+#endif
+#ifndef ISO_TP_DISABLE_RECEIVE
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) { return ISOTP_RET_INPROGRESS; }
+#endif
+
+    link->addr_mode    = addr_mode;
+    link->send_addr    = send_addr;
+    link->receive_addr = receive_addr;
+    return ISOTP_RET_OK;
+}
+#endif
+
+void isotp_set_rx_flow_control(IsoTpLink* link, uint8_t block_size, uint32_t st_min_us) {
+    if (link != NULL) {
+        link->receive_block_size = block_size;
+        link->receive_st_min_us  = st_min_us;
+    }
+}
+
+#ifndef ISO_TP_DISABLE_RECEIVE
+int isotp_resume_receive(IsoTpLink* link) {
+    if (link == NULL || ISOTP_RECEIVE_STATUS_INPROGRESS != link->receive_status || 0 == link->receive_fc_wait || link->receive_fc_pending) {
+        return ISOTP_RET_NO_DATA;
+    }
+
+    isotp_receive_send_flow_control(link);
+    return ISOTP_RET_OK;
+}
+#endif
+
 #ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
 void isotp_set_tx_done_cb(IsoTpLink* link, isotp_tx_done_cb cb, void* arg) {
     if (link != NULL) {
@@ -640,3 +1199,32 @@ void isotp_set_rx_done_cb(IsoTpLink* link, isotp_rx_done_cb cb, void* arg) {
     }
 }
 #endif
+
+#if defined(ISO_TP_STREAMING_RECEIVE) && !defined(ISO_TP_DISABLE_RECEIVE)
+void isotp_set_rx_sink_cb(IsoTpLink* link, isotp_rx_sink_cb cb, void* arg) {
+    if (link != NULL) {
+        /* a reception already streaming keeps its old sink until it ends */
+        if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status && link->receive_streaming) { return; }
+        link->receive_sink_cb     = cb;
+        link->receive_sink_cb_arg = arg;
+    }
+}
+#endif
+
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+void isotp_set_fc_policy_cb(IsoTpLink* link, isotp_fc_policy_cb cb, void* arg) {
+    if (link != NULL) {
+        link->fc_policy_cb     = cb;
+        link->fc_policy_cb_arg = arg;
+    }
+}
+#endif
+
+#ifdef ISO_TP_ACTIVE_CALLBACK
+void isotp_set_active_cb(IsoTpLink* link, isotp_active_cb cb, void* arg) {
+    if (link != NULL) {
+        link->active_cb     = cb;
+        link->active_cb_arg = arg;
+    }
+}
+#endif
@@ -22,50 +22,107 @@ extern "C" {
 #include "isotp_defines.h"
 #include "isotp_user.h"
 
+/**
+ * @brief Per-link protocol parameters, see @link isotp_init_link_with_config @endlink.
+ * Use @link isotp_link_config_init @endlink to fill it with the compile-time defaults first.
+ */
+typedef struct IsoTpLinkConfig {
+    uint8_t             block_size;          /* BS advertised as receiver, 0 for no limit (ISO_TP_DEFAULT_BLOCK_SIZE) */
+    uint32_t            st_min_us;           /* STmin advertised as receiver (ISO_TP_DEFAULT_ST_MIN_US) */
+    uint32_t            tx_st_min_floor_us;  /* Lower bound of the peer's STmin when sending (ISO_TP_DEFAULT_ST_MIN_US) */
+    uint32_t            response_timeout_us; /* N_Bs and N_Cr timeout (ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US) */
+    uint8_t             max_wft_number;      /* FC.WAIT accepted as sender and sent as receiver in a row (ISO_TP_MAX_WFT_NUMBER) */
+    uint8_t             frame_padding;       /* Non-zero to pad frames to 8 bytes (ISO_TP_FRAME_PADDING) */
+    uint8_t             frame_padding_value; /* Padding byte (ISO_TP_FRAME_PADDING_VALUE) */
+    uint8_t             tx_dl;               /* TX_DL (ISO_TP_DEFAULT_TX_DL) */
+#ifdef ISO_TP_ADDRESSING
+    uint8_t             addr_mode;           /* IsoTpAddressingTypes (ISOTP_ADDRESSING_NORMAL) */
+    uint8_t             send_addr;           /* Address byte of sent frames with extended or mixed addressing */
+    uint8_t             receive_addr;        /* Address byte a received frame must carry to be handled by the link */
+#endif
+} IsoTpLinkConfig;
+
 /**
  * @brief Struct containing the data for linking an application to a CAN instance.
  * The data stored in this struct is used internally and may be used by software programs
  * using this library.
+ *
+ * Fields are grouped by access: the state isotp_poll and isotp_on_can_message touch for every
+ * frame comes first, the configuration after it. Byte-sized fields are packed together, and
+ * with ISO_TP_COMPACT_LINK sizes and offsets are stored in 16 bits. ISO_TP_DISABLE_TRANSMIT
+ * and ISO_TP_DISABLE_RECEIVE remove the state of the unused direction.
  */
 typedef struct IsoTpLink {
-    /* sender paramters */
-    uint32_t            send_arbitration_id; /* used to reply consecutive frame */
-
-    /* message buffer */
+    /* hot state */
+#ifndef ISO_TP_DISABLE_TRANSMIT
+    uint8_t             send_status;
+    uint8_t             send_sn;
+    uint8_t             send_tx_dl;          /* TX_DL, 8 for classic CAN, up to 64 with ISO_TP_CAN_FD */
+    uint8_t             send_wtf_count;      /* Number of FC.WAIT received in a row */
+    uint16_t            send_bs_remain;      /* Remaining block size, ISOTP_INVALID_BS when unlimited */
+    isotp_size_t        send_size;
+    isotp_size_t        send_offset;
+    uint32_t            send_st_min_us;      /* Separation Time between consecutive frames */
+    uint32_t            send_timer_st;       /* Last time send consecutive frame */
+    uint32_t            send_timer_bs;       /* Time until reception of the next FlowControl N_PDU
+                                                start at sending FF, CF, receive FC
+                                                end at receive FC */
     uint8_t*            send_buffer;
-    uint32_t            send_buf_size;
-    uint32_t            send_size;
-    uint32_t            send_offset;
+#ifdef ISO_TP_STREAMING_SEND
+    isotp_tx_source_cb  send_source_cb;      /* Payload source of a streaming transmission, NULL for send_buffer */
+    void*               send_source_cb_arg;  /* User argument for callback */
+#endif
+#endif
 
-    /* multi-frame flags */
-    uint8_t             send_sn;
-    uint32_t            send_bs_remain; /* Remaining block size */
-    uint32_t            send_st_min_us; /* Separation Time between consecutive frames */
-    uint8_t             send_wtf_count; /* Maximum number of FC.Wait frame transmissions  */
-    uint32_t            send_timer_st;  /* Last time send consecutive frame */
-    uint32_t            send_timer_bs;  /* Time until reception of the next FlowControl N_PDU
-                                           start at sending FF, CF, receive FC
-                                           end at receive FC */
-    int32_t             send_protocol_result;
-    uint8_t             send_status;
+#ifndef ISO_TP_DISABLE_RECEIVE
+    uint8_t             receive_status;
+    uint8_t             receive_sn;
+    uint8_t             receive_rx_dl;       /* RX_DL, learned from the length of the First Frame */
+    uint8_t             receive_bs_count;    /* Remaining consecutive frames of the current block, 0 when unlimited */
+    uint8_t             receive_fc_wait;     /* Set while the sender was told to wait */
+    uint8_t             receive_fc_pending;  /* Set while the last flow control frame could not be sent (ISOTP_RET_NOSPACE) */
+    uint8_t             receive_wft_count;   /* Number of FC.WAIT sent in a row */
+#ifdef ISO_TP_STREAMING_RECEIVE
+    uint8_t             receive_streaming;   /* Set while the reception in progress goes to receive_sink_cb */
+#endif
+    isotp_size_t        receive_size;
+    isotp_size_t        receive_offset;
+    uint32_t            receive_timer_cr;    /* Time until transmission of the next ConsecutiveFrame N_PDU
+                                                start at sending FC, receive CF
+                                                end at receive FC */
+    uint32_t            receive_timer_wait;  /* Time at which the flow control policy is asked again after FC.WAIT */
+    uint32_t            receive_fc_st_min_us; /* STmin of the last flow control frame */
+    uint8_t*            receive_buffer;
+#ifdef ISO_TP_STREAMING_RECEIVE
+    isotp_rx_sink_cb    receive_sink_cb;     /* Sink of segmented receptions, NULL to assemble them in receive_buffer */
+    void*               receive_sink_cb_arg; /* User argument for callback */
+#endif
+#endif
 
-    /* receiver paramters */
+    /* link configuration */
+    uint32_t            send_arbitration_id; /* used to reply consecutive frame */
     uint32_t            receive_arbitration_id;
-    
-    /* message buffer */
-    uint8_t*            receive_buffer;
-    uint32_t            receive_buf_size;
-    uint32_t            receive_size;
-    uint32_t            receive_offset;
+    uint32_t            response_timeout_us; /* N_Bs / N_Cr timeout */
+    uint32_t            receive_st_min_us;   /* STmin advertised in flow control frames */
+    uint8_t             receive_block_size;  /* Block size advertised in flow control frames */
+    uint8_t             max_wft_number;      /* Maximum number of FC.WAIT in a row */
+    uint8_t             frame_padding;       /* Pad frames to 8 bytes */
+    uint8_t             frame_padding_value; /* Padding byte */
+#ifdef ISO_TP_ADDRESSING
+    uint8_t             addr_mode;           /* IsoTpAddressingTypes */
+    uint8_t             send_addr;           /* N_TA / N_AE put in front of sent frames */
+    uint8_t             receive_addr;        /* N_TA / N_AE expected in front of received frames */
+#endif
 
-    /* multi-frame control */
-    uint8_t             receive_sn;
-    uint8_t             receive_bs_count; /* Maximum number of FC.Wait frame transmissions  */
-    uint32_t            receive_timer_cr; /* Time until transmission of the next ConsecutiveFrame N_PDU
-                                    start at sending FC, receive CF
-                                    end at receive FC */
-    int                 receive_protocol_result;
-    uint8_t             receive_status;
+#ifndef ISO_TP_DISABLE_TRANSMIT
+    isotp_size_t        send_buf_size;
+    isotp_result_t      send_protocol_result;
+    uint32_t            send_st_min_floor_us; /* Lower bound of the peer's STmin */
+#endif
+#ifndef ISO_TP_DISABLE_RECEIVE
+    isotp_size_t        receive_buf_size;
+    isotp_result_t      receive_protocol_result;
+#endif
 
 #if defined(ISO_TP_USER_SEND_CAN_ARG)
     void*               user_send_can_arg;
@@ -81,6 +138,16 @@ typedef struct IsoTpLink {
     void*               rx_done_cb_arg; /* User argument for callback */
 #endif
 
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+    isotp_fc_policy_cb  fc_policy_cb;     /* User callback choosing each flow control frame */
+    void*               fc_policy_cb_arg; /* User argument for callback */
+#endif
+
+#ifdef ISO_TP_ACTIVE_CALLBACK
+    isotp_active_cb     active_cb;     /* User callback for the start of a segmented transfer */
+    void*               active_cb_arg; /* User argument for callback */
+#endif
+
 } IsoTpLink;
 
 /**
@@ -95,6 +162,30 @@ typedef struct IsoTpLink {
  */
 void isotp_init_link(IsoTpLink* link, uint32_t sendid, uint8_t* sendbuf, uint32_t sendbufsize, uint8_t* recvbuf, uint32_t recvbufsize);
 
+/**
+ * @brief Fills a link configuration with the compile-time defaults from isotp_config.h.
+ *
+ * @param config The configuration to initialise.
+ */
+void isotp_link_config_init(IsoTpLinkConfig* config);
+
+/**
+ * @brief Initialises the ISO-TP library with per-link protocol parameters.
+ *
+ * Same as @link isotp_init_link @endlink, but timeouts, flow control, padding and TX_DL are taken from
+ * @p config instead of the compile-time defaults. An invalid tx_dl falls back to ISO_TP_DEFAULT_TX_DL.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param sendid The ID used to send data to other CAN nodes.
+ * @param sendbuf A pointer to an area in memory which can be used as a buffer for data to be sent.
+ * @param sendbufsize The size of the buffer area.
+ * @param recvbuf A pointer to an area in memory which can be used as a buffer for data to be received.
+ * @param recvbufsize The size of the buffer area.
+ * @param config The link configuration, or NULL for the defaults. It is copied.
+ */
+void isotp_init_link_with_config(IsoTpLink* link, uint32_t sendid, uint8_t* sendbuf, uint32_t sendbufsize, uint8_t* recvbuf, uint32_t recvbufsize,
+                                 const IsoTpLinkConfig* config);
+
 /**
  * @brief Destroys the ISO-TP link and releases associated resources.
  *
@@ -105,10 +196,25 @@ void isotp_destroy_link(IsoTpLink* link);
 /**
  * @brief Polling function; call this function periodically to handle timeouts, send consecutive frames, etc.
  *
+ * While STmin allows it and block-size credit remains, several consecutive frames are sent in
+ * one call (see ISO_TP_MAX_CF_BURST). The burst stops early when the shim returns ISOTP_RET_NOSPACE.
+ *
  * @param link The @code IsoTpLink @endcode instance used.
  */
 void isotp_poll(IsoTpLink* link);
 
+/**
+ * @brief Same as @link isotp_poll @endlink, with the current time supplied by the caller.
+ *
+ * Lets a caller polling many links read the clock once per pass. Returns at once for a link
+ * with no transfer in progress. isotp_user_get_us is still read after frames were sent, so
+ * that STmin and N_Bs are measured from the actual transmission.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param now The current time, as returned by isotp_user_get_us.
+ */
+void isotp_poll_with_time(IsoTpLink* link, uint32_t now);
+
 /**
  * @brief Handles incoming CAN messages.
  * Determines whether an incoming message is a valid ISO-TP frame or not and handles it accordingly.
@@ -119,6 +225,7 @@ void isotp_poll(IsoTpLink* link);
  */
 void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len);
 
+#ifndef ISO_TP_DISABLE_TRANSMIT
 /**
  * @brief Sends ISO-TP frames via CAN, using the ID set in the initialising function.
  *
@@ -141,7 +248,33 @@ int isotp_send(IsoTpLink* link, const uint8_t payload[], uint32_t size);
  * @brief See @link isotp_send @endlink, with the exception that this function is used only for functional addressing.
  */
 int isotp_send_with_id(IsoTpLink* link, uint32_t id, const uint8_t payload[], uint32_t size);
+#endif
 
+#if defined(ISO_TP_STREAMING_SEND) && !defined(ISO_TP_DISABLE_TRANSMIT)
+/**
+ * @brief Sends a PDU whose payload is pulled from a callback while it is being sent.
+ *
+ * Nothing is copied into the send buffer: the single or first frame is formatted from @p cb
+ * immediately, each consecutive frame when isotp_poll sends it. The PDU may therefore be
+ * larger than the send buffer, up to ISOTP_SIZE_MAX bytes; beyond 4095 bytes the 32-bit
+ * first frame (ISO 15765-2:2016) is used. The source may hold a consecutive frame back with
+ * ISOTP_RET_NO_DATA until its payload is available, e.g. to forward data still being received.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param size The size of the PDU.
+ * @param cb The payload source, see isotp_tx_source_cb. It must stay usable until the transmission ends.
+ * @param arg A pointer that will be passed to the callback function.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_INPROGRESS @endcode
+ *  - @code ISOTP_RET_ERROR @endcode if an argument is invalid or the source failed
+ *  - The return value of the user shim function isotp_user_send_can().
+ */
+int isotp_send_stream(IsoTpLink* link, uint32_t size, isotp_tx_source_cb cb, void* arg);
+#endif
+
+#ifndef ISO_TP_DISABLE_RECEIVE
 /**
  * @brief Receives and parses the received data and copies the parsed data in to the internal buffer.
  * @param link The @link IsoTpLink @endlink instance used to transceive data.
@@ -154,6 +287,80 @@ int isotp_send_with_id(IsoTpLink* link, uint32_t id, const uint8_t payload[], ui
  *      - @link ISOTP_RET_NO_DATA @endlink
  */
 int isotp_receive(IsoTpLink* link, uint8_t* payload, const uint32_t payload_size, uint32_t* out_size);
+#endif
+
+#ifndef ISO_TP_DISABLE_TRANSMIT
+/**
+ * @brief Sets the transmit data link layer data length (TX_DL) of a link.
+ *
+ * Classic CAN links use 8. With ISO_TP_CAN_FD, any CAN FD data length up to 64 bytes
+ * (12, 16, 20, 24, 32, 48, 64) can be used; single frames then carry up to TX_DL - 2 bytes
+ * and consecutive frames TX_DL - 1 bytes. The receive side adapts to the peer's RX_DL
+ * automatically.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param tx_dl The new TX_DL.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_INPROGRESS @endcode if a multi-frame transmission is in progress
+ *  - @code ISOTP_RET_ERROR @endcode if the link is null or tx_dl is not a valid data length
+ */
+int isotp_set_tx_dl(IsoTpLink* link, uint8_t tx_dl);
+#endif
+
+#ifdef ISO_TP_ADDRESSING
+/**
+ * @brief Sets the addressing format of a link.
+ *
+ * With ISOTP_ADDRESSING_EXTENDED or ISOTP_ADDRESSING_MIXED every frame the link sends starts
+ * with @p send_addr, and received frames are only handled when their first byte equals
+ * @p receive_addr; frames for other addresses are ignored, so several links may receive on
+ * the same CAN ID. The address byte costs one payload byte per frame: single frames carry
+ * up to 6 bytes on classic CAN, consecutive frames TX_DL - 2 bytes. Normal and normal fixed
+ * addressing use the plain frame layout, normal fixed only describes how the CAN IDs passed
+ * to the link are built, the addresses are not used by the core.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param addr_mode One of IsoTpAddressingTypes.
+ * @param send_addr N_TA (extended) or N_AE (mixed) of sent frames.
+ * @param receive_addr N_TA (extended) or N_AE (mixed) of received frames.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_INPROGRESS @endcode if a segmented transmission or reception is in progress
+ *  - @code ISOTP_RET_ERROR @endcode if the link is null or addr_mode is unknown
+ */
+int isotp_set_addressing(IsoTpLink* link, uint8_t addr_mode, uint8_t send_addr, uint8_t receive_addr);
+#endif
+
+/**
+ * @brief Sets the block size and STmin the link advertises as a receiver.
+ *
+ * Links start with ISO_TP_DEFAULT_BLOCK_SIZE and ISO_TP_DEFAULT_ST_MIN_US. The new values are
+ * used from the next flow control frame on, including one of a reception in progress.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param block_size Number of consecutive frames per block, 0 for no further flow control.
+ * @param st_min_us Minimum separation time between consecutive frames, in microseconds.
+ */
+void isotp_set_rx_flow_control(IsoTpLink* link, uint8_t block_size, uint32_t st_min_us);
+
+#ifndef ISO_TP_DISABLE_RECEIVE
+/**
+ * @brief Asks the flow control policy again for a sender held with FC.WAIT, without waiting for the retry time.
+ *
+ * Meant for a policy that knows when its reason for waiting is gone. Like @link isotp_poll @endlink,
+ * it must be called from the context that polls the link and passes it received frames.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ *
+ * @return Possible return values:
+ *  - @code ISOTP_RET_OK @endcode
+ *  - @code ISOTP_RET_NO_DATA @endcode if no reception is held with FC.WAIT
+ */
+int isotp_resume_receive(IsoTpLink* link);
+#endif
 
 #ifdef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
 /**
@@ -177,6 +384,54 @@ void isotp_set_tx_done_cb(IsoTpLink* link, isotp_tx_done_cb cb, void* arg);
 void isotp_set_rx_done_cb(IsoTpLink* link, isotp_rx_done_cb cb, void* arg);
 #endif
 
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+/**
+ * @brief Sets the receiver flow control policy callback.
+ *
+ * The callback is called before every flow control frame of a multi-frame reception, from
+ * isotp_on_can_message or, after FC.WAIT, from isotp_poll. It can narrow or widen the block,
+ * change STmin, or make the sender wait while the receiving side is congested.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param cb The policy callback, or NULL to always send the configured BS/STmin.
+ * @param arg A pointer that will be passed to the callback function.
+ */
+void isotp_set_fc_policy_cb(IsoTpLink* link, isotp_fc_policy_cb cb, void* arg);
+#endif
+
+#ifdef ISO_TP_ACTIVE_CALLBACK
+/**
+ * @brief Sets the callback function for the start of a segmented transfer.
+ *
+ * The callback is called when a first frame was sent or received, i.e. whenever the link goes
+ * from having nothing for isotp_poll to do to needing it. A poller can keep a set of active
+ * links this way and remove a link once it is idle in both directions again.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param cb The callback function, or NULL.
+ * @param arg A pointer that will be passed to the callback function.
+ */
+void isotp_set_active_cb(IsoTpLink* link, isotp_active_cb cb, void* arg);
+#endif
+
+#if defined(ISO_TP_STREAMING_RECEIVE) && !defined(ISO_TP_DISABLE_RECEIVE)
+/**
+ * @brief Streams segmented receptions to a callback instead of assembling them in the receive buffer.
+ *
+ * The receive buffer only stages one chunk: whenever it is full, and at the end of the PDU, its
+ * content is handed to @p cb, so data can be written to flash while the transfer continues and
+ * the buffer can be much smaller than the PDU (first frames announcing up to ISOTP_SIZE_MAX
+ * bytes are accepted). Streamed PDUs are complete with their last chunk; they are not reported
+ * through the receive complete callback or isotp_receive. Single frames are still received into
+ * the buffer as before.
+ *
+ * @param link The @code IsoTpLink @endcode instance used for transceiving data.
+ * @param cb The sink, or NULL to assemble segmented receptions in the receive buffer again.
+ * @param arg A pointer that will be passed to the callback function.
+ */
+void isotp_set_rx_sink_cb(IsoTpLink* link, isotp_rx_sink_cb cb, void* arg);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
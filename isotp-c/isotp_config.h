@@ -14,6 +14,10 @@
 #ifndef ISOTPC_CONFIG_H
 #define ISOTPC_CONFIG_H
 
+/* The ISO_TP_DEFAULT_* values, ISO_TP_MAX_WFT_NUMBER and the padding settings below are
+ * only the defaults of a link; isotp_init_link_with_config overrides them per link.
+ */
+
 /* Max number of messages the receiver can receive at one time, this value
  * is affected by can driver queue length
  */
@@ -35,6 +39,36 @@
     #define ISO_TP_MAX_WFT_NUMBER 1
 #endif
 
+/* Maximum number of consecutive frames isotp_poll sends in a single call while
+ * STmin has expired and block-size credit remains. 0 means no limit: the burst
+ * only stops at the end of the block, at the end of the message, or when the shim
+ * returns ISOTP_RET_NOSPACE. Set it to 1 for the classic one-frame-per-poll behaviour.
+ */
+#ifndef ISO_TP_MAX_CF_BURST
+    #define ISO_TP_MAX_CF_BURST 0
+#endif
+
+/* Enables ISO 15765-2:2016 CAN FD framing: a per-link TX_DL of up to 64 bytes,
+ * single frames with escape sequence and DLC-aligned padding. Without it only
+ * classic 8-byte CAN frames are handled.
+ */
+/* #define ISO_TP_CAN_FD */
+
+/* Private: Largest CAN frame data length the core has to encode or decode.
+ */
+#ifdef ISO_TP_CAN_FD
+    #define ISO_TP_MAX_FRAME_LEN 64
+#else
+    #define ISO_TP_MAX_FRAME_LEN 8
+#endif
+
+/* TX_DL a link starts with after isotp_init_link, use isotp_set_tx_dl to change it
+ * per link. Must be 8 or a valid CAN FD data length not larger than ISO_TP_MAX_FRAME_LEN.
+ */
+#ifndef ISO_TP_DEFAULT_TX_DL
+    #define ISO_TP_DEFAULT_TX_DL 8
+#endif
+
 /* Private: The default timeout to use when waiting for a response during a
  * multi-frame send or receive.
  */
@@ -44,7 +78,9 @@
 
 /* Private: Determines if by default, padding is added to ISO-TP message frames.
  */
-#define ISO_TP_FRAME_PADDING
+#ifndef ISO_TP_FRAME_PADDING
+    #define ISO_TP_FRAME_PADDING
+#endif
 
 /* Private: Value to use when padding frames if enabled by ISO_TP_FRAME_PADDING
  */
@@ -55,12 +91,102 @@
 /* Private: Determines if by default, an additional argument is present in the
  * definition of isotp_user_send_can.
  */
-#define ISO_TP_USER_SEND_CAN_ARG
+#ifndef ISO_TP_USER_SEND_CAN_ARG
+    #define ISO_TP_USER_SEND_CAN_ARG
+#endif
+
+/* Adds isotp_send_stream: the payload of a transmission is pulled from a user
+ * callback frame by frame as it is sent, instead of being copied into the link's
+ * send buffer up front, so PDUs may be larger than the send buffer.
+ */
+/* #define ISO_TP_STREAMING_SEND */
+
+/* Adds isotp_set_rx_sink_cb: once a sink is set, segmented receptions are handed to
+ * it in chunks of up to the receive buffer size while they arrive, instead of being
+ * assembled in the receive buffer, so PDUs may be larger than the receive buffer.
+ */
+/* #define ISO_TP_STREAMING_RECEIVE */
+
+/* Hands consecutive frames to isotp_user_send_can_batch, up to ISO_TP_MAX_CF_BATCH
+ * per call, instead of one isotp_user_send_can call per frame. Only frames that may
+ * be sent back to back are batched: those of the current block when STmin is zero.
+ */
+/* #define ISO_TP_USER_SEND_CAN_BATCH */
+
+/* Maximum number of consecutive frames in one isotp_user_send_can_batch call. The
+ * frames are formatted on the stack of isotp_poll, ISO_TP_MAX_FRAME_LEN bytes each.
+ */
+#ifndef ISO_TP_MAX_CF_BATCH
+    #define ISO_TP_MAX_CF_BATCH 8
+#endif
+
+#if defined(ISO_TP_USER_SEND_CAN_BATCH) && ((ISO_TP_MAX_CF_BATCH < 1) || (ISO_TP_MAX_CF_BATCH > 255))
+    #error "ISO_TP_MAX_CF_BATCH must be between 1 and 255"
+#endif
+
+/* Formats single, first, consecutive and flow control frames straight into a buffer
+ * handed out by isotp_user_alloc_can and sends them with isotp_user_commit_can, e.g.
+ * the data field of the driver's message, instead of staging them on the stack for
+ * isotp_user_send_can. Batched consecutive frames still go through
+ * isotp_user_send_can_batch.
+ */
+/* #define ISO_TP_USER_SEND_CAN_ALLOC */
 
 /* Enable support for transmission complete callback */
-#define ISO_TP_TRANSMIT_COMPLETE_CALLBACK
+#ifndef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
+    #define ISO_TP_TRANSMIT_COMPLETE_CALLBACK
+#endif
 
 /* Enable support for receive complete callback */
-#define ISO_TP_RECEIVE_COMPLETE_CALLBACK
+#ifndef ISO_TP_RECEIVE_COMPLETE_CALLBACK
+    #define ISO_TP_RECEIVE_COMPLETE_CALLBACK
+#endif
+
+/* Enable support for a flow control policy callback, which lets the receiver choose
+ * BS/STmin or FC.WAIT for every flow control frame it sends
+ */
+#ifndef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+    #define ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+#endif
+
+/* Enable support for an active callback, called whenever a link starts a segmented
+ * transmission or reception, so that the caller of isotp_poll can poll active links only
+ */
+#ifndef ISO_TP_ACTIVE_CALLBACK
+    #define ISO_TP_ACTIVE_CALLBACK
+#endif
+
+/* Adds extended and mixed addressing (isotp_set_addressing): every frame of such a link
+ * starts with an address byte (N_TA or N_AE) in front of the PCI, so links of different
+ * peers can share one CAN ID. Normal and normal fixed addressing are always available.
+ */
+/* #define ISO_TP_ADDRESSING */
+
+/* Stores sizes and offsets of a link in 16 bits and protocol results in 8 bits, which
+ * shrinks IsoTpLink noticeably on 32-bit MCUs. Message and buffer sizes are then limited
+ * to 65535 bytes; larger buffers passed to isotp_init_link are clamped.
+ */
+/* #define ISO_TP_COMPACT_LINK */
+
+/* Remove the sender (segmented transmission, isotp_send) or the receiver (reassembly,
+ * isotp_receive) from every link of a build whose links only go one direction. Flow
+ * control frames are still sent by a receiver and handled by a sender.
+ */
+/* #define ISO_TP_DISABLE_TRANSMIT */
+/* #define ISO_TP_DISABLE_RECEIVE */
+
+#if defined(ISO_TP_DISABLE_TRANSMIT) && defined(ISO_TP_DISABLE_RECEIVE)
+    #error "ISO_TP_DISABLE_TRANSMIT and ISO_TP_DISABLE_RECEIVE cannot both be defined"
+#endif
+
+/* Private: Callbacks of a removed direction are not available.
+ */
+#ifdef ISO_TP_DISABLE_TRANSMIT
+    #undef ISO_TP_TRANSMIT_COMPLETE_CALLBACK
+#endif
+#ifdef ISO_TP_DISABLE_RECEIVE
+    #undef ISO_TP_RECEIVE_COMPLETE_CALLBACK
+    #undef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+#endif
 
 #endif // ISOTPC_CONFIG_H
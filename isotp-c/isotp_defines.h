@@ -48,6 +48,17 @@
 #define ISOTP_RET_LENGTH -7
 #define ISOTP_RET_NOSPACE -8
 
+/* storage of sizes/offsets and protocol results in IsoTpLink */
+#ifdef ISO_TP_COMPACT_LINK
+typedef uint16_t isotp_size_t;
+typedef int8_t   isotp_result_t;
+    #define ISOTP_SIZE_MAX 0xFFFFu
+#else
+typedef uint32_t isotp_size_t;
+typedef int32_t  isotp_result_t;
+    #define ISOTP_SIZE_MAX 0xFFFFFFFFu
+#endif
+
 /* return logic true if 'a' is after 'b' */
 #define IsoTpTimeAfter(a, b) ((int32_t)((int32_t)(b) - (int32_t)(a)) < 0)
 
@@ -71,25 +82,42 @@ typedef enum {
     ISOTP_RECEIVE_STATUS_FULL,
 } IsoTpReceiveStatusTypes;
 
-/* can fram defination */
+/* ISOTP addressing formats (ISO 15765-2), extended and mixed need ISO_TP_ADDRESSING */
+typedef enum {
+    ISOTP_ADDRESSING_NORMAL,       /* the CAN IDs identify the link */
+    ISOTP_ADDRESSING_NORMAL_FIXED, /* N_TA and N_SA in a 29-bit CAN ID, same frame layout as normal */
+    ISOTP_ADDRESSING_EXTENDED,     /* N_TA in the first data byte */
+    ISOTP_ADDRESSING_MIXED,        /* N_AE in the first data byte */
+} IsoTpAddressingTypes;
+
+/* can fram defination
+ * Deprecated: the core parses and builds frames byte by byte and no longer uses these types or
+ * IsoTpCanMessage, they are kept for source compatibility of code that includes this header. */
 #if defined(ISOTP_BYTE_ORDER_LITTLE_ENDIAN)
 typedef struct {
     uint8_t reserve_1 : 4;
     uint8_t type      : 4;
-    uint8_t reserve_2[7];
+    uint8_t reserve_2[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpPciType;
 
 typedef struct {
     uint8_t SF_DL : 4;
     uint8_t type  : 4;
-    uint8_t data[7];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpSingleFrame;
 
+typedef struct {
+    uint8_t set_to_zero : 4;
+    uint8_t type        : 4;
+    uint8_t SF_DL;
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 2];
+} IsoTpSingleFrameLong;
+
 typedef struct {
     uint8_t FF_DL_high : 4;
     uint8_t type       : 4;
     uint8_t FF_DL_low;
-    uint8_t data[6];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 2];
 } IsoTpFirstFrameShort;
 
 ISOTP_PACKED_STRUCT({
@@ -97,13 +125,13 @@ ISOTP_PACKED_STRUCT({
     uint8_t  type             : 4;
     uint8_t  set_to_zero_low;
     uint32_t FF_DL;
-    uint8_t  data[2];
+    uint8_t  data[ISO_TP_MAX_FRAME_LEN - 6];
 } IsoTpFirstFrameLong);
 
 typedef struct {
     uint8_t SN   : 4;
     uint8_t type : 4;
-    uint8_t data[7];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpConsecutiveFrame;
 
 typedef struct {
@@ -111,7 +139,7 @@ typedef struct {
     uint8_t type : 4;
     uint8_t BS;
     uint8_t STmin;
-    uint8_t reserve[5];
+    uint8_t reserve[ISO_TP_MAX_FRAME_LEN - 3];
 } IsoTpFlowControl;
 
 #else
@@ -119,7 +147,7 @@ typedef struct {
 typedef struct {
     uint8_t type      : 4;
     uint8_t reserve_1 : 4;
-    uint8_t reserve_2[7];
+    uint8_t reserve_2[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpPciType;
 
 /*
@@ -135,9 +163,26 @@ typedef struct {
 typedef struct {
     uint8_t type  : 4;
     uint8_t SF_DL : 4;
-    uint8_t data[7];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpSingleFrame;
 
+/*
+ * single frame with escape sequence (CAN FD, CAN_DL > 8)
+ * +-------------------------+-----------------------+-----+
+ * | byte #0                 | byte #1               | ... |
+ * +-------------------------+-----------+-----------+-----+
+ * | nibble #0   | nibble #1 | nibble #2 | nibble #3 | ... |
+ * +-------------+-----------+-----------+-----------+-----+
+ * | PCIType = 0 | unused=0  | SF_DL                 | ... |
+ * +-------------+-----------+-----------------------+-----+
+ */
+typedef struct {
+    uint8_t type        : 4;
+    uint8_t set_to_zero : 4;
+    uint8_t SF_DL;
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 2];
+} IsoTpSingleFrameLong;
+
 /*
  * first frame short
  * +-------------------------+-----------------------+-----+
@@ -152,7 +197,7 @@ typedef struct {
     uint8_t FF_DL_high : 4;
     uint8_t type       : 4;
     uint8_t FF_DL_low;
-    uint8_t data[6];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 2];
 } IsoTpFirstFrameShort;
 
 /*
@@ -170,7 +215,7 @@ ISOTP_PACKED_STRUCT({
     uint8_t  type             : 4;
     uint8_t  set_to_zero_low;
     uint32_t FF_DL;
-    uint8_t  data[2];
+    uint8_t  data[ISO_TP_MAX_FRAME_LEN - 6];
 } IsoTpFirstFrameLong);
 
 /*
@@ -186,7 +231,7 @@ ISOTP_PACKED_STRUCT({
 typedef struct {
     uint8_t type : 4;
     uint8_t SN   : 4;
-    uint8_t data[7];
+    uint8_t data[ISO_TP_MAX_FRAME_LEN - 1];
 } IsoTpConsecutiveFrame;
 
 /*
@@ -204,19 +249,20 @@ typedef struct {
     uint8_t FS   : 4;
     uint8_t BS;
     uint8_t STmin;
-    uint8_t reserve[5];
+    uint8_t reserve[ISO_TP_MAX_FRAME_LEN - 3];
 } IsoTpFlowControl;
 
 #endif
 
 typedef struct {
-        uint8_t ptr[8];
+        uint8_t ptr[ISO_TP_MAX_FRAME_LEN];
 } IsoTpDataArray;
 
 typedef struct {
     union {
         IsoTpPciType          common;
         IsoTpSingleFrame      single_frame;
+        IsoTpSingleFrameLong  single_frame_long;
         IsoTpFirstFrameShort  first_frame_short;
         IsoTpFirstFrameLong   first_frame_long;
         IsoTpConsecutiveFrame consecutive_frame;
@@ -243,6 +289,47 @@ typedef void (*isotp_tx_done_cb)(void* link, uint32_t tx_size, void* user_arg);
 typedef void (*isotp_rx_done_cb)(void* link, const uint8_t* data, uint32_t size, void* user_arg);
 #endif
 
+#ifdef ISO_TP_STREAMING_SEND
+/* Private: Function pointer type for the payload source of a streaming transmission
+ * Called whenever a frame is formatted, to copy size payload bytes starting at offset
+ * into data. Offsets increase through the PDU, but a range is requested again when
+ * the frame it belongs to could not be sent (ISOTP_RET_NOSPACE). Returns ISOTP_RET_OK,
+ * or ISOTP_RET_NO_DATA if the payload of a consecutive frame is not available yet: the
+ * frame is then requested again on the next isotp_poll. Anything else, and a missing
+ * payload for the single or first frame, aborts the transmission.
+ */
+typedef int (*isotp_tx_source_cb)(void* link, uint32_t offset, uint8_t* data, uint8_t size, void* user_arg);
+#endif
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+/* Private: Function pointer type for the sink of a streaming reception
+ * Called with consecutive chunks of a segmented PDU of total_size bytes as they arrive;
+ * offset + size == total_size marks the last chunk, after which the PDU is complete.
+ * data == NULL (size 0) reports that the reception was aborted at offset. Returning
+ * anything but ISOTP_RET_OK aborts the reception.
+ */
+typedef int (*isotp_rx_sink_cb)(void* link, uint32_t offset, const uint8_t* data, uint32_t size, uint32_t total_size, void* user_arg);
+#endif
+
+#ifdef ISO_TP_FLOW_CONTROL_POLICY_CALLBACK
+/* Private: Function pointer type for the receiver flow control policy
+ * Called before every flow control frame of a multi-frame reception. block_size and
+ * st_min_us hold the link's configured values and may be changed. Returns
+ * PCI_FLOW_STATUS_CONTINUE to send them, or PCI_FLOW_STATUS_WAIT to send FC.WAIT instead
+ * (at most max_wft_number times in a row, after that CONTINUE is forced).
+ */
+typedef uint8_t (*isotp_fc_policy_cb)(void* link, uint8_t* block_size, uint32_t* st_min_us, void* user_arg);
+#endif
+
+#ifdef ISO_TP_ACTIVE_CALLBACK
+/* Private: Function pointer type for the active callback
+ * Called right after send_status or receive_status became INPROGRESS, i.e. when the link
+ * starts needing isotp_poll. It runs in the thread calling isotp_send or
+ * isotp_on_can_message and must not call back into the link.
+ */
+typedef void (*isotp_active_cb)(void* link, void* user_arg);
+#endif
+
 /* Private: Protocol Control Information (PCI) types, for identifying each frame of an ISO-TP message.
  */
 typedef enum {
@@ -30,6 +30,58 @@ int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t* data, cons
 #endif
 );
 
+#ifdef ISO_TP_USER_SEND_CAN_BATCH
+/**
+ * @brief user implemented, send several consecutive frames with the same arbitration id in one call.
+ * Only used with ISO_TP_USER_SEND_CAN_BATCH; single, first and flow control frames still go through
+ * isotp_user_send_can.
+ *
+ * @param data the frames; frame i starts at data + i * ISO_TP_MAX_FRAME_LEN and is sizes[i] bytes long
+ * @param sizes the size of each frame
+ * @param count the number of frames, 1 to ISO_TP_MAX_CF_BATCH
+ *
+ * @return the number of frames accepted, counted from the first one. Fewer than count means the
+ * remaining frames should be retried later, as with ISOTP_RET_NOSPACE. ISOTP_RET_ERROR if
+ * transmission couldn't be completed
+ */
+int isotp_user_send_can_batch(const uint32_t arbitration_id, const uint8_t* data, const uint8_t* sizes, const uint8_t count
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                              , void* arg
+#endif
+);
+#endif
+
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+/**
+ * @brief user implemented, returns the buffer the next frame with this arbitration id is formatted in.
+ * Only used with ISO_TP_USER_SEND_CAN_ALLOC, which replaces isotp_user_send_can. Every buffer handed
+ * out is passed back to isotp_user_commit_can before the core formats another frame of the link.
+ *
+ * @param pci_type the ISOTP_PCI_TYPE_* of the frame, e.g. to pick a queue for flow control frames
+ *
+ * @return a buffer of at least ISO_TP_MAX_FRAME_LEN bytes, or NULL if none is free; the frame is
+ * then retried later, as with ISOTP_RET_NOSPACE
+ */
+uint8_t* isotp_user_alloc_can(const uint32_t arbitration_id, const uint8_t pci_type
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                              , void* arg
+#endif
+);
+
+/**
+ * @brief user implemented, sends the frame formatted in a buffer of isotp_user_alloc_can.
+ *
+ * @param size the CAN frame length, or 0 if the frame is dropped without being sent
+ *
+ * @return same as isotp_user_send_can
+ */
+int isotp_user_commit_can(const uint32_t arbitration_id, uint8_t* data, const uint8_t size
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                          , void* arg
+#endif
+);
+#endif
+
 /**
  * @brief user implemented, gets the amount of time passed since the last call in microseconds
  */
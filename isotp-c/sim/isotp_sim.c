@@ -0,0 +1,590 @@
+////////////////////////////////////////////////////////////////////////
+//                  ___ ___  ___ _____ ___      ___                   //
+//                 |_ _/ __|/ _ \_   _| _ \___ / __|                  //
+//                  | |\__ \ (_) || | |  _/___| (__                   //
+//                 |___|___/\___/ |_| |_|      \___|                  //
+//                                                                    //
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file isotp_sim.c
+ * @brief Host simulation of the isotp-c core on a virtual CAN bus with a simulated clock.
+ *
+ * N client links each send PDUs to their own server link. isotp_user_send_can() puts frames on an
+ * in-memory bus that models the bitrate (frames are serialised and take their approximate wire
+ * time), a fixed delivery delay, a controller queue depth and random frame loss.
+ * isotp_user_get_us() returns the simulated clock, which jumps straight to the next frame delivery
+ * or poll tick, so runs are deterministic and not slowed down by STmin or timeouts.
+ *
+ * Only the core and this file are compiled, which makes the program suitable for profiling the
+ * core with perf or valgrind and for comparing throughput between changes on a desktop:
+ *
+ * @code
+ * make sim && ./bin/isotp_sim -n 4 -c 100000 -s 62
+ * ./bin/isotp_sim -c 1000 -s 4095 -b 500000 -l 100 -B 8 -m 1000
+ * @endcode
+ *
+ * The wall clock report ends with the cost of one frame, for sending and receiving it and for the
+ * bus model, in ns and, on x86, in TSC cycles. Built with ISO_TP_USER_SEND_CAN_ALLOC the core
+ * formats every frame straight into its slot on the bus.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isotp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define SIM_CYCLES() __rdtsc()
+#endif
+
+#if defined(ISO_TP_DISABLE_TRANSMIT) || defined(ISO_TP_DISABLE_RECEIVE)
+    #error "the simulation needs links that can both send and receive"
+#endif
+#if !defined(ISO_TP_TRANSMIT_COMPLETE_CALLBACK) || !defined(ISO_TP_RECEIVE_COMPLETE_CALLBACK)
+    #error "the simulation needs ISO_TP_TRANSMIT_COMPLETE_CALLBACK and ISO_TP_RECEIVE_COMPLETE_CALLBACK"
+#endif
+
+#define SIM_MAX_LINKS        64      /* maximum number of client/server link pairs */
+#define SIM_MAX_PDU_SIZE     4095    /* largest payload */
+#define SIM_BUS_CAPACITY     1024    /* frames the bus can hold in flight, power of two */
+#define SIM_CLIENT_ID_BASE   0x700u  /* CAN ID of client i is SIM_CLIENT_ID_BASE + i */
+#define SIM_SERVER_ID_BASE   0x780u  /* CAN ID of server i is SIM_SERVER_ID_BASE + i */
+
+///////////////////////////////////////////////////////
+///                    SIM STATE                    ///
+///////////////////////////////////////////////////////
+
+/** @brief Simulation parameters, set from the command line. */
+typedef struct {
+    unsigned links;         /* number of client/server pairs */
+    unsigned count;         /* PDUs sent by every client */
+    unsigned size;          /* payload size */
+    unsigned bitrate;       /* bus bitrate in bit/s, 0 for an ideal bus without wire time */
+    unsigned delay_us;      /* delay between end of transmission and delivery */
+    unsigned loss_ppm;      /* frame loss probability in parts per million */
+    unsigned queue;         /* frames a sender may have in flight before the shim returns ISOTP_RET_NOSPACE */
+    unsigned tick_us;       /* period of isotp_poll while no frame is due */
+    unsigned block_size;    /* BS advertised by the servers */
+    unsigned st_min_us;     /* STmin advertised by the servers */
+    unsigned tx_dl;         /* TX_DL of all links */
+    unsigned seed;          /* seed of the frame loss generator */
+    unsigned stream;        /* send with isotp_send_stream instead of isotp_send */
+    unsigned sink_chunk;    /* receive buffer of the servers when streaming to a sink, 0 to assemble PDUs */
+} SimConfig;
+
+/** @brief A frame on the bus. */
+typedef struct {
+    uint64_t deliver_us;    /* simulated time at which the frame is received */
+    uint32_t id;
+    uint8_t  len;
+    uint8_t  data[ISO_TP_MAX_FRAME_LEN];
+} SimFrame;
+
+/** @brief A client link, the server link it talks to, and their counters. */
+typedef struct {
+    IsoTpLink client;
+    IsoTpLink server;
+    uint8_t   client_tx[SIM_MAX_PDU_SIZE];
+    uint8_t   client_rx[SIM_MAX_PDU_SIZE];
+    uint8_t   server_tx[SIM_MAX_PDU_SIZE];
+    uint8_t   server_rx[SIM_MAX_PDU_SIZE];
+    unsigned  started;      /* PDUs handed to isotp_send */
+    unsigned  sent;         /* PDUs whose transmission completed */
+    unsigned  received;     /* PDUs received intact */
+    unsigned  corrupt;      /* PDUs received with a wrong size or content */
+    unsigned  in_flight;    /* frames of this client still on the bus */
+    unsigned  sink_ok;      /* chunks of the streamed PDU in progress matched so far */
+    uint64_t  start_us;     /* time the PDU in progress was started */
+    uint64_t  latency_sum;  /* sum of the latency of all received PDUs */
+    uint64_t  latency_max;  /* highest latency of a received PDU */
+} SimPair;
+
+static SimConfig g_cfg = {
+    .links = 1, .count = 100000, .size = 7, .bitrate = 0, .delay_us = 0, .loss_ppm = 0, .queue = 32,
+    .tick_us = 100, .block_size = 0, .st_min_us = 0, .tx_dl = 8, .seed = 1,
+};
+
+static SimPair* g_pairs;
+static uint8_t  g_payload[SIM_MAX_PDU_SIZE];
+static uint64_t g_now_us;
+static uint64_t g_bus_free_us;
+static SimFrame g_bus[SIM_BUS_CAPACITY];
+static unsigned g_bus_head, g_bus_tail;
+static uint64_t g_frames, g_lost, g_nospace, g_bus_busy_us;
+static uint32_t g_rand_state;
+
+///////////////////////////////////////////////////////
+///                  USER SHIM                      ///
+///////////////////////////////////////////////////////
+
+void isotp_user_debug(const char* message, ...) {
+    (void)message;
+}
+
+uint32_t isotp_user_get_us(void) {
+    return (uint32_t)g_now_us;
+}
+
+/* xorshift32, good enough for frame loss and reproducible for a given seed */
+static uint32_t sim_rand(void) {
+    g_rand_state ^= g_rand_state << 13;
+    g_rand_state ^= g_rand_state >> 17;
+    g_rand_state ^= g_rand_state << 5;
+    return g_rand_state;
+}
+
+/* approximate wire time of a frame with an 11 bit ID, including worst-case bit stuffing */
+static uint64_t sim_frame_time_us(uint8_t len) {
+    uint64_t bits = 47u + 8u * len;
+
+    if (g_cfg.bitrate == 0) {
+        return 0;
+    }
+    bits += (34u + 8u * len - 1u) / 4u;
+    return (bits * 1000000u + g_cfg.bitrate - 1u) / g_cfg.bitrate;
+}
+
+static SimPair* sim_pair_of(uint32_t id, int* to_server) {
+    if (id >= SIM_CLIENT_ID_BASE && id < SIM_CLIENT_ID_BASE + g_cfg.links) {
+        *to_server = 1;
+        return &g_pairs[id - SIM_CLIENT_ID_BASE];
+    }
+    if (id >= SIM_SERVER_ID_BASE && id < SIM_SERVER_ID_BASE + g_cfg.links) {
+        *to_server = 0;
+        return &g_pairs[id - SIM_SERVER_ID_BASE];
+    }
+    return NULL;
+}
+
+/* the slot of the next frame put on the bus, NULL if the sender's queue or the bus is full */
+static SimFrame* sim_bus_slot(const SimPair* pair, int to_server) {
+    if ((to_server && pair->in_flight >= g_cfg.queue) || g_bus_tail - g_bus_head >= SIM_BUS_CAPACITY) {
+        g_nospace++;
+        return NULL;
+    }
+    return &g_bus[g_bus_tail & (SIM_BUS_CAPACITY - 1)];
+}
+
+/* puts the frame written to the slot of sim_bus_slot on the bus */
+static void sim_bus_put(SimPair* pair, int to_server, uint32_t arbitration_id, uint8_t size) {
+    uint64_t start_us, end_us;
+    SimFrame* frame;
+
+    /* the bus transmits one frame at a time, a frame starts when the previous one has ended */
+    start_us = g_bus_free_us > g_now_us ? g_bus_free_us : g_now_us;
+    end_us = start_us + sim_frame_time_us(size);
+    g_bus_busy_us += end_us - start_us;
+    g_bus_free_us = end_us;
+    g_frames++;
+
+    if (g_cfg.loss_ppm && sim_rand() % 1000000u < g_cfg.loss_ppm) {
+        g_lost++;
+        return;
+    }
+
+    frame = &g_bus[g_bus_tail++ & (SIM_BUS_CAPACITY - 1)];
+    frame->deliver_us = end_us + g_cfg.delay_us;
+    frame->id = arbitration_id;
+    frame->len = size;
+    if (to_server) {
+        pair->in_flight++;
+    }
+}
+
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t* data, const uint8_t size
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                        , void* arg
+#endif
+) {
+    int to_server;
+    SimPair* pair = sim_pair_of(arbitration_id, &to_server);
+    SimFrame* frame;
+
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+    (void)arg;
+#endif
+    if (pair == NULL || size > ISO_TP_MAX_FRAME_LEN) {
+        return ISOTP_RET_ERROR;
+    }
+    frame = sim_bus_slot(pair, to_server);
+    if (frame == NULL) {
+        return ISOTP_RET_NOSPACE;
+    }
+    memcpy(frame->data, data, size);
+    sim_bus_put(pair, to_server, arbitration_id, size);
+    return ISOTP_RET_OK;
+}
+
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+uint8_t* isotp_user_alloc_can(const uint32_t arbitration_id, const uint8_t pci_type
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                              , void* arg
+#endif
+) {
+    int to_server;
+    SimPair* pair = sim_pair_of(arbitration_id, &to_server);
+    SimFrame* frame;
+
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+    (void)arg;
+#endif
+    (void)pci_type;
+    if (pair == NULL) {
+        return NULL;
+    }
+    frame = sim_bus_slot(pair, to_server);
+    return frame != NULL ? frame->data : NULL;
+}
+
+int isotp_user_commit_can(const uint32_t arbitration_id, uint8_t* data, const uint8_t size
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                          , void* arg
+#endif
+) {
+    int to_server;
+    SimPair* pair = sim_pair_of(arbitration_id, &to_server);
+
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+    (void)arg;
+#endif
+    (void)data;
+    if (pair == NULL || size > ISO_TP_MAX_FRAME_LEN) {
+        return ISOTP_RET_ERROR;
+    }
+    if (size != 0) {
+        sim_bus_put(pair, to_server, arbitration_id, size);
+    }
+    return ISOTP_RET_OK;
+}
+#endif
+
+#ifdef ISO_TP_USER_SEND_CAN_BATCH
+int isotp_user_send_can_batch(const uint32_t arbitration_id, const uint8_t* data, const uint8_t* sizes, const uint8_t count
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                              , void* arg
+#endif
+) {
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        int ret = isotp_user_send_can(arbitration_id, data + i * ISO_TP_MAX_FRAME_LEN, sizes[i]
+#ifdef ISO_TP_USER_SEND_CAN_ARG
+                                      , arg
+#endif
+        );
+        if (ret == ISOTP_RET_NOSPACE) {
+            break;
+        }
+        if (ret != ISOTP_RET_OK) {
+            return i ? i : ret;
+        }
+    }
+    return i;
+}
+#endif
+
+///////////////////////////////////////////////////////
+///                  CALLBACKS                      ///
+///////////////////////////////////////////////////////
+
+#ifdef ISO_TP_STREAMING_SEND
+static int sim_source(void* link, uint32_t offset, uint8_t* data, uint8_t size, void* arg) {
+    (void)link;
+    (void)arg;
+    memcpy(data, g_payload + offset, size);
+    return ISOTP_RET_OK;
+}
+#endif
+
+static void sim_tx_done(void* link, uint32_t size, void* arg) {
+    SimPair* pair = (SimPair*)arg;
+    (void)link;
+    (void)size;
+    pair->sent++;
+}
+
+static void sim_rx_done(void* link, const uint8_t* data, uint32_t size, void* arg) {
+    SimPair* pair = (SimPair*)arg;
+    uint64_t latency = g_now_us - pair->start_us;
+    (void)link;
+
+    if (size != g_cfg.size || memcmp(data, g_payload, size) != 0) {
+        pair->corrupt++;
+        return;
+    }
+    pair->received++;
+    pair->latency_sum += latency;
+    if (latency > pair->latency_max) {
+        pair->latency_max = latency;
+    }
+}
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+static int sim_sink(void* link, uint32_t offset, const uint8_t* data, uint32_t size, uint32_t total_size, void* arg) {
+    SimPair* pair = (SimPair*)arg;
+
+    if (data == NULL) {
+        return ISOTP_RET_OK; /* aborted, the PDU counts as not delivered */
+    }
+    if (offset == 0) {
+        pair->sink_ok = 1;
+    }
+    if (total_size != g_cfg.size || memcmp(data, g_payload + offset, size) != 0) {
+        pair->sink_ok = 0;
+    }
+    if (offset + size == total_size) {
+        if (pair->sink_ok) {
+            sim_rx_done(link, g_payload, total_size, arg);
+        } else {
+            pair->corrupt++;
+        }
+    }
+    return ISOTP_RET_OK;
+}
+#endif
+
+///////////////////////////////////////////////////////
+///                  SIMULATION                     ///
+///////////////////////////////////////////////////////
+
+/* delivers every frame that is due; frames leave the bus in the order they were sent */
+static void sim_deliver(void) {
+    while (g_bus_head != g_bus_tail) {
+        SimFrame* frame = &g_bus[g_bus_head & (SIM_BUS_CAPACITY - 1)];
+        int to_server;
+        SimPair* pair;
+
+        if (frame->deliver_us > g_now_us) {
+            break;
+        }
+        g_bus_head++;
+        pair = sim_pair_of(frame->id, &to_server);
+        if (to_server) {
+            pair->in_flight--;
+            isotp_on_can_message(&pair->server, frame->data, frame->len);
+        } else {
+            isotp_on_can_message(&pair->client, frame->data, frame->len);
+        }
+    }
+}
+
+/*
+ * runs until every client has sent all its PDUs and the bus is empty; a client starts its next PDU
+ * once nothing of the previous one is left on the bus or in the server, so latencies are per PDU
+ */
+static void sim_run(void) {
+    unsigned done = 0;
+
+    while (done < g_cfg.links || g_bus_head != g_bus_tail) {
+        uint64_t next_us;
+        unsigned i;
+
+        sim_deliver();
+
+        done = 0;
+        for (i = 0; i < g_cfg.links; i++) {
+            SimPair* pair = &g_pairs[i];
+
+            isotp_poll(&pair->client);
+            isotp_poll(&pair->server);
+
+            if (pair->client.send_status != ISOTP_SEND_STATUS_INPROGRESS && pair->in_flight == 0 &&
+                pair->server.receive_status != ISOTP_RECEIVE_STATUS_INPROGRESS) {
+                if (pair->started < g_cfg.count) {
+                    int ret;
+
+                    pair->start_us = g_now_us;
+#ifdef ISO_TP_STREAMING_SEND
+                    if (g_cfg.stream) {
+                        ret = isotp_send_stream(&pair->client, g_cfg.size, sim_source, pair);
+                    } else
+#endif
+                    {
+                        ret = isotp_send(&pair->client, g_payload, g_cfg.size);
+                    }
+                    if (ret != ISOTP_RET_NOSPACE) {
+                        pair->started++;
+                    }
+                } else {
+                    done++;
+                }
+            }
+        }
+
+        /* jump to the next frame delivery, or one poll tick ahead when nothing is due earlier */
+        next_us = g_now_us + g_cfg.tick_us;
+        if (g_bus_head != g_bus_tail) {
+            uint64_t deliver_us = g_bus[g_bus_head & (SIM_BUS_CAPACITY - 1)].deliver_us;
+            if (deliver_us < next_us) {
+                next_us = deliver_us > g_now_us ? deliver_us : g_now_us;
+            }
+        }
+        g_now_us = next_us;
+    }
+}
+
+static void sim_usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n links     number of client/server link pairs (1..%d, default %u)\n"
+            "  -c count     PDUs sent by every client (default %u)\n"
+            "  -s size      payload size (1..%d, default %u)\n"
+            "  -b bitrate   bus bitrate in bit/s, 0 for an ideal bus (default %u)\n"
+            "  -d delay     delivery delay in us (default %u)\n"
+            "  -l loss      frame loss in parts per million (default %u)\n"
+            "  -q queue     frames a client may have in flight (default %u)\n"
+            "  -t tick      poll period in us (default %u)\n"
+            "  -B bs        block size advertised by the servers (default %u)\n"
+            "  -m stmin     STmin advertised by the servers, in us (default %u)\n"
+            "  -x tx_dl     TX_DL of all links, > 8 needs ISO_TP_CAN_FD (default %u)\n"
+            "  -r seed      seed of the frame loss generator (default %u)\n"
+            "  -S           send with isotp_send_stream, needs ISO_TP_STREAMING_SEND\n"
+            "  -R chunk     stream receptions to a sink through a chunk byte receive buffer,\n"
+            "               needs ISO_TP_STREAMING_RECEIVE (default off)\n",
+            name, SIM_MAX_LINKS, g_cfg.links, g_cfg.count, SIM_MAX_PDU_SIZE, g_cfg.size, g_cfg.bitrate,
+            g_cfg.delay_us, g_cfg.loss_ppm, g_cfg.queue, g_cfg.tick_us, g_cfg.block_size, g_cfg.st_min_us,
+            g_cfg.tx_dl, g_cfg.seed);
+}
+
+static int sim_parse(int argc, char** argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:s:b:d:l:q:t:B:m:x:r:R:Sh")) != -1) {
+        unsigned value = (unsigned)strtoul(optarg ? optarg : "0", NULL, 0);
+        switch (opt) {
+            case 'n': g_cfg.links = value; break;
+            case 'c': g_cfg.count = value; break;
+            case 's': g_cfg.size = value; break;
+            case 'b': g_cfg.bitrate = value; break;
+            case 'd': g_cfg.delay_us = value; break;
+            case 'l': g_cfg.loss_ppm = value; break;
+            case 'q': g_cfg.queue = value; break;
+            case 't': g_cfg.tick_us = value; break;
+            case 'B': g_cfg.block_size = value; break;
+            case 'm': g_cfg.st_min_us = value; break;
+            case 'x': g_cfg.tx_dl = value; break;
+            case 'r': g_cfg.seed = value; break;
+            case 'S': g_cfg.stream = 1; break;
+            case 'R': g_cfg.sink_chunk = value; break;
+            default: return -1;
+        }
+    }
+    if (g_cfg.links < 1 || g_cfg.links > SIM_MAX_LINKS || g_cfg.size < 1 || g_cfg.size > SIM_MAX_PDU_SIZE ||
+        g_cfg.queue < 1 || g_cfg.tick_us < 1 || g_cfg.sink_chunk > SIM_MAX_PDU_SIZE || g_cfg.block_size > 0xFF || g_cfg.seed == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct timespec wall_start, wall_end;
+#ifdef SIM_CYCLES
+    uint64_t cycles;
+#endif
+    uint64_t sent = 0, received = 0, corrupt = 0, latency_sum = 0, latency_max = 0;
+    double wall_s, sim_s;
+    unsigned i;
+
+    if (sim_parse(argc, argv) != 0) {
+        sim_usage(argv[0]);
+        return 2;
+    }
+
+    g_pairs = calloc(g_cfg.links, sizeof(SimPair));
+    if (g_pairs == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(g_payload); i++) {
+        g_payload[i] = (uint8_t)(i * 7u + 1u);
+    }
+    g_rand_state = g_cfg.seed;
+
+    for (i = 0; i < g_cfg.links; i++) {
+        SimPair* pair           = &g_pairs[i];
+        uint32_t server_rx_size = sizeof(pair->server_rx);
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+        if (g_cfg.sink_chunk) {
+            server_rx_size = g_cfg.sink_chunk;
+        }
+#endif
+        isotp_init_link(&pair->client, SIM_CLIENT_ID_BASE + i, pair->client_tx, sizeof(pair->client_tx),
+                        pair->client_rx, sizeof(pair->client_rx));
+        isotp_init_link(&pair->server, SIM_SERVER_ID_BASE + i, pair->server_tx, sizeof(pair->server_tx),
+                        pair->server_rx, server_rx_size);
+        if (isotp_set_tx_dl(&pair->client, (uint8_t)g_cfg.tx_dl) != ISOTP_RET_OK ||
+            isotp_set_tx_dl(&pair->server, (uint8_t)g_cfg.tx_dl) != ISOTP_RET_OK) {
+            fprintf(stderr, "invalid tx_dl %u\n", g_cfg.tx_dl);
+            return 2;
+        }
+        isotp_set_rx_flow_control(&pair->server, (uint8_t)g_cfg.block_size, g_cfg.st_min_us);
+        isotp_set_tx_done_cb(&pair->client, sim_tx_done, pair);
+        isotp_set_rx_done_cb(&pair->server, sim_rx_done, pair);
+#ifdef ISO_TP_STREAMING_RECEIVE
+        if (g_cfg.sink_chunk) {
+            isotp_set_rx_sink_cb(&pair->server, sim_sink, pair);
+        }
+#endif
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+#ifdef SIM_CYCLES
+    cycles = SIM_CYCLES();
+#endif
+    sim_run();
+#ifdef SIM_CYCLES
+    cycles = SIM_CYCLES() - cycles;
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    for (i = 0; i < g_cfg.links; i++) {
+        sent += g_pairs[i].sent;
+        received += g_pairs[i].received;
+        corrupt += g_pairs[i].corrupt;
+        latency_sum += g_pairs[i].latency_sum;
+        if (g_pairs[i].latency_max > latency_max) {
+            latency_max = g_pairs[i].latency_max;
+        }
+    }
+    wall_s = (double)(wall_end.tv_sec - wall_start.tv_sec) + (double)(wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    sim_s = (double)g_now_us / 1e6;
+
+    printf("links %u, size %u, bitrate %u, delay %u us, loss %u ppm, BS %u, STmin %u us, TX_DL %u\n",
+           g_cfg.links, g_cfg.size, g_cfg.bitrate, g_cfg.delay_us, g_cfg.loss_ppm, g_cfg.block_size,
+           g_cfg.st_min_us, g_cfg.tx_dl);
+    printf("PDUs:      %llu sent, %llu received, %llu corrupt, %llu not delivered\n",
+           (unsigned long long)sent, (unsigned long long)received, (unsigned long long)corrupt,
+           (unsigned long long)((uint64_t)g_cfg.links * g_cfg.count - received - corrupt));
+    printf("frames:    %llu sent, %llu lost, %llu NOSPACE, bus load %.1f%%\n",
+           (unsigned long long)g_frames, (unsigned long long)g_lost, (unsigned long long)g_nospace,
+           g_now_us ? 100.0 * (double)g_bus_busy_us / (double)g_now_us : 0.0);
+    if (g_cfg.bitrate == 0 && g_cfg.delay_us == 0) {
+        printf("simulated: ideal bus, frames take no time\n");
+    } else {
+        printf("simulated: %.3f s, %.0f PDUs/s, %.0f bytes/s, latency avg %.0f us, max %llu us\n",
+               sim_s, sim_s > 0 ? (double)received / sim_s : 0.0, sim_s > 0 ? (double)received * g_cfg.size / sim_s : 0.0,
+               received ? (double)latency_sum / (double)received : 0.0, (unsigned long long)latency_max);
+    }
+    printf("wall:      %.3f s, %.0f PDUs/s, %.0f frames/s\n",
+           wall_s, wall_s > 0 ? (double)received / wall_s : 0.0, wall_s > 0 ? (double)g_frames / wall_s : 0.0);
+    printf("per frame: %.1f ns", g_frames ? wall_s * 1e9 / (double)g_frames : 0.0);
+#ifdef SIM_CYCLES
+    printf(", %.1f TSC cycles", g_frames ? (double)cycles / (double)g_frames : 0.0);
+#endif
+    printf(" (send, receive and bus model)\n");
+
+    for (i = 0; i < g_cfg.links; i++) {
+        isotp_destroy_link(&g_pairs[i].client);
+        isotp_destroy_link(&g_pairs[i].server);
+    }
+    free(g_pairs);
+    return (corrupt == 0 && (g_cfg.loss_ppm != 0 || received == (uint64_t)g_cfg.links * g_cfg.count)) ? 0 : 1;
+}
@@ -13,8 +13,8 @@
  * - Supports unique naming for RTOS objects for easier debugging.
  * 
  * @author wdfk-prog ()
- * @version 1.1
- * @date 2025-11-05
+ * @version 1.2
+ * @date 2026-10-14
  * 
  * @copyright Copyright (c) 2025  
  * 
@@ -23,6 +23,7 @@
  * Date       Version Author      Description
  * 2025-11-05 1.0     wdfk-prog   first version
  * 2025-11-13 1.1     wdfk-prog   Implement non-blocking send functionality and optimize the blocking send interface
+ * 2026-10-14 1.2     wdfk-prog   Replace the fixed-interval poll loop with a deadline-driven scheduler
  */
 #include "isotp_rtt.h"
 #include <string.h>
@@ -32,35 +33,349 @@
 #include <rtdbg.h>
 
 /* Private Defines */
-#define EVENT_FLAG_TX_DONE (1 << 0) ///< Event flag: A complete PDU has been successfully transmitted.
-#define EVENT_FLAG_RX_DONE (1 << 1) ///< Event flag: A complete PDU has been successfully received.
-#define EVENT_FLAG_ERROR   (1 << 2) ///< Event flag: An error occurred during transmission or reception.
+/*
+ * The TX and RX directions of a link use disjoint flags of the link's event. `rt_event_recv` only
+ * clears the flags a waiter asked for, so a sender blocked in `isotp_rtt_send` and a receiver
+ * blocked in `isotp_rtt_receive` can share a link without consuming each other's completions.
+ */
+#define EVENT_FLAG_TX_DONE  (1 << 0) ///< Event flag: A complete PDU has been successfully transmitted.
+#define EVENT_FLAG_RX_DONE  (1 << 1) ///< Event flag: A complete PDU has been successfully received.
+#define EVENT_FLAG_TX_ERROR (1 << 2) ///< Event flag: The transmission of a PDU failed.
+#define EVENT_FLAGS_TX      (EVENT_FLAG_TX_DONE | EVENT_FLAG_TX_ERROR) ///< All flags of the transmit direction.
+#define EVENT_FLAG_TXN_DONE (1 << 3) ///< Event flag: The transaction started by `isotp_rtt_transact` has completed.
+
+#define POLL_EVENT_WAKEUP  (1 << 0) ///< Poll event flag: A link has new work, the next deadline must be recomputed.
+#define POLL_EVENT_RX      (1 << 1) ///< Poll event flag: The RX port of a worker's device has frames.
+
+#define TX_EVENT_KICK      (1 << 0) ///< TX ring event flag: Frames were queued for the device.
+
+#ifdef PKG_ISOTP_C_USING_STATS
+#define ISOTP_RTT_STATS_TX_TIMING (1 << 0) ///< Stats flag: A segmented transmission is being timed.
+#define ISOTP_RTT_STATS_RX_TIMING (1 << 1) ///< Stats flag: A segmented reception is being timed.
+#define ISOTP_RTT_STATS_FC_TIMING (1 << 2) ///< Stats flag: An FC is awaited after the frame sent at `fc_start_us`.
+
+#define ISOTP_RTT_STAT_INC(rtt_link, field)    ((rtt_link)->stats.field++)
+#define ISOTP_RTT_STAT_ADD(rtt_link, field, n) ((rtt_link)->stats.field += (n))
+#else
+#define ISOTP_RTT_STAT_INC(rtt_link, field)    do {} while (0)
+#define ISOTP_RTT_STAT_ADD(rtt_link, field, n) do {} while (0)
+#endif
+
+#ifndef PKG_ISOTP_C_DISPATCH_HASH_SIZE
+#define PKG_ISOTP_C_DISPATCH_HASH_SIZE 32 ///< Number of buckets of the RX dispatch table, must be a power of two.
+#endif
+
+#if (PKG_ISOTP_C_DISPATCH_HASH_SIZE & (PKG_ISOTP_C_DISPATCH_HASH_SIZE - 1)) != 0
+#error "PKG_ISOTP_C_DISPATCH_HASH_SIZE must be a power of two"
+#endif
+
+#ifndef PKG_ISOTP_C_TXN_P2_MS
+#define PKG_ISOTP_C_TXN_P2_MS 50              ///< Default response timeout of a transaction (UDS P2).
+#endif
+
+#ifndef PKG_ISOTP_C_TXN_P2_EXT_MS
+#define PKG_ISOTP_C_TXN_P2_EXT_MS 5000        ///< Default response timeout after a response pending NRC (UDS P2*).
+#endif
+
+#define ISOTP_RTT_TXN_IDLE 0 ///< Transaction state: No transaction is in progress.
+#define ISOTP_RTT_TXN_SEND 1 ///< Transaction state: The request is queued or being sent.
+#define ISOTP_RTT_TXN_WAIT 2 ///< Transaction state: The response is due by `txn_deadline_us`.
+
+#define UDS_NRC_RESPONSE_PENDING 0x78 ///< UDS negative response code: request correctly received, response pending.
+
+#ifndef PKG_ISOTP_C_LINK_POOL_SIZE
+#define PKG_ISOTP_C_LINK_POOL_SIZE 0          ///< Number of links `isotp_rtt_create` takes from a static pool, 0 to use the heap.
+#endif
+
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0 && !defined(RT_USING_MEMPOOL)
+#error "PKG_ISOTP_C_LINK_POOL_SIZE requires RT_USING_MEMPOOL"
+#endif
+
+/* Timebase of `isotp_user_get_us`, exactly one of the PKG_ISOTP_C_TIMEBASE_* options is used */
+#if defined(PKG_ISOTP_C_TIMEBASE_CLOCK_CPU)
+#ifndef RT_USING_CPUTIME
+#error "PKG_ISOTP_C_TIMEBASE_CLOCK_CPU requires RT_USING_CPUTIME"
+#endif
+#elif defined(PKG_ISOTP_C_TIMEBASE_DWT)
+#ifndef PKG_ISOTP_C_DWT_CPU_FREQ_HZ
+extern uint32_t SystemCoreClock;
+#define PKG_ISOTP_C_DWT_CPU_FREQ_HZ SystemCoreClock ///< Frequency of the DWT cycle counter (the core clock).
+#endif
+#define DWT_DEMCR   (*(volatile rt_uint32_t *)0xE000EDFCUL) ///< Debug Exception and Monitor Control Register.
+#define DWT_CTRL    (*(volatile rt_uint32_t *)0xE0001000UL) ///< DWT Control Register.
+#define DWT_CYCCNT  (*(volatile rt_uint32_t *)0xE0001004UL) ///< DWT Cycle Count Register.
+#define DWT_LAR     (*(volatile rt_uint32_t *)0xE0001FB0UL) ///< DWT Lock Access Register (Cortex-M7).
+#else
+#ifndef PKG_ISOTP_C_TIMEBASE_TICK
+#define PKG_ISOTP_C_TIMEBASE_TICK
+#endif
+#endif
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+#ifndef PKG_ISOTP_C_MAX_WORKERS
+#define PKG_ISOTP_C_MAX_WORKERS 4             ///< Maximum number of CAN devices with a worker thread.
+#endif
+#ifndef PKG_ISOTP_C_WORKER_STACK_SIZE
+#define PKG_ISOTP_C_WORKER_STACK_SIZE PKG_ISOTP_C_POLL_THREAD_STACK_SIZE ///< Stack size of each worker thread.
+#endif
+#ifndef PKG_ISOTP_C_WORKER_PRIORITY
+#define PKG_ISOTP_C_WORKER_PRIORITY PKG_ISOTP_C_POLL_THREAD_PRIORITY     ///< Initial priority of each worker thread.
+#endif
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+#error "PKG_ISOTP_C_USING_HWTIMER_PACING drives a single polling thread and cannot be used with PKG_ISOTP_C_USING_DEVICE_WORKERS"
+#endif
+#endif
+
+#ifdef PKG_ISOTP_C_USING_TX_RING
+#ifndef PKG_ISOTP_C_MAX_TX_RINGS
+#define PKG_ISOTP_C_MAX_TX_RINGS 4            ///< Maximum number of CAN devices with a TX ring.
+#endif
+#ifndef PKG_ISOTP_C_TX_RING_SIZE
+#define PKG_ISOTP_C_TX_RING_SIZE 16           ///< Single, first and consecutive frames queued per device, must be a power of two.
+#endif
+#ifndef PKG_ISOTP_C_TX_FC_RING_SIZE
+#define PKG_ISOTP_C_TX_FC_RING_SIZE 4         ///< Flow control frames queued per device, must be a power of two.
+#endif
+#ifndef PKG_ISOTP_C_TX_RING_BURST
+#define PKG_ISOTP_C_TX_RING_BURST 4           ///< Maximum number of frames per `rt_device_write` of the TX thread.
+#endif
+#ifndef PKG_ISOTP_C_TX_THREAD_STACK_SIZE
+#define PKG_ISOTP_C_TX_THREAD_STACK_SIZE 1024 ///< Stack size of each TX thread.
+#endif
+#ifndef PKG_ISOTP_C_TX_THREAD_PRIORITY
+#define PKG_ISOTP_C_TX_THREAD_PRIORITY PKG_ISOTP_C_POLL_THREAD_PRIORITY ///< Priority of each TX thread.
+#endif
+#if (PKG_ISOTP_C_TX_RING_SIZE & (PKG_ISOTP_C_TX_RING_SIZE - 1)) != 0 || (PKG_ISOTP_C_TX_FC_RING_SIZE & (PKG_ISOTP_C_TX_FC_RING_SIZE - 1)) != 0
+#error "PKG_ISOTP_C_TX_RING_SIZE and PKG_ISOTP_C_TX_FC_RING_SIZE must be powers of two"
+#endif
+#if PKG_ISOTP_C_TX_RING_SIZE < 4
+#error "PKG_ISOTP_C_TX_RING_SIZE must be at least 4"
+#endif
+#define ISOTP_RTT_TX_RING_RESERVE 2 ///< Slots of the TX ring consecutive frames leave to single and first frames.
+#endif
+
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+#ifndef RT_USING_HWTIMER
+#error "PKG_ISOTP_C_USING_HWTIMER_PACING requires RT_USING_HWTIMER"
+#endif
+#ifdef PKG_ISOTP_C_TIMEBASE_TICK
+#error "PKG_ISOTP_C_USING_HWTIMER_PACING requires a sub-tick timebase (PKG_ISOTP_C_TIMEBASE_CLOCK_CPU or PKG_ISOTP_C_TIMEBASE_DWT)"
+#endif
+#ifndef PKG_ISOTP_C_HWTIMER_DEVICE_NAME
+#define PKG_ISOTP_C_HWTIMER_DEVICE_NAME "timer0" ///< hwtimer device used to wake the polling thread at sub-tick deadlines.
+#endif
+#ifndef PKG_ISOTP_C_HWTIMER_MAX_US
+#define PKG_ISOTP_C_HWTIMER_MAX_US (2 * 1000000UL / RT_TICK_PER_SECOND) ///< Deadlines further away only use the tick timeout.
+#endif
+#endif
+
+#ifdef PKG_ISOTP_C_USING_CANFD
+#ifndef RT_CAN_USING_CANFD
+#error "PKG_ISOTP_C_USING_CANFD requires RT_CAN_USING_CANFD"
+#endif
+#ifndef ISO_TP_CAN_FD
+#error "PKG_ISOTP_C_USING_CANFD requires the isotp-c core to be built with ISO_TP_CAN_FD"
+#endif
+#endif
+
+#ifndef ISO_TP_ACTIVE_CALLBACK
+#error "The adapter requires the isotp-c core to be built with ISO_TP_ACTIVE_CALLBACK"
+#endif
+
+/* Extended and mixed addressing put an address byte in front of the PCI of every frame */
+#ifdef ISO_TP_ADDRESSING
+#define ISOTP_RTT_ADDR_LEN(rtt_link)    ((rtt_link)->link.addr_mode >= ISOTP_ADDRESSING_EXTENDED ? 1u : 0u)
+#define ISOTP_RTT_ADDR_KEY(rtt_link)    (ISOTP_RTT_ADDR_LEN(rtt_link) ? 0x100u | (rtt_link)->link.receive_addr : 0u)
+#else
+#define ISOTP_RTT_ADDR_LEN(rtt_link)    0u
+#define ISOTP_RTT_ADDR_KEY(rtt_link)    0u
+#endif
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+#if !defined(ISO_TP_STREAMING_SEND) || !defined(ISO_TP_STREAMING_RECEIVE) || !defined(ISO_TP_FLOW_CONTROL_POLICY_CALLBACK)
+#error "PKG_ISOTP_C_USING_GATEWAY requires the isotp-c core to be built with ISO_TP_STREAMING_SEND, ISO_TP_STREAMING_RECEIVE and ISO_TP_FLOW_CONTROL_POLICY_CALLBACK"
+#endif
+
+#define ISOTP_RTT_ROUTE_IDLE 0 ///< Route state: No PDU is being forwarded.
+#define ISOTP_RTT_ROUTE_RX   1 ///< Route state: A PDU is being received, its egress transmission is not queued yet.
+#define ISOTP_RTT_ROUTE_FWD  2 ///< Route state: The egress transmission of the PDU is queued or in progress.
+#define ISOTP_RTT_ROUTE_DROP 3 ///< Route state: The egress side failed, the rest of the ingress PDU is discarded.
+#endif
+
+#ifdef PKG_ISOTP_C_USING_HW_FILTER
+#ifndef PKG_ISOTP_C_HW_FILTER_BANKS
+#define PKG_ISOTP_C_HW_FILTER_BANKS 14        ///< Acceptance filter banks of each CAN device the adapter may program.
+#endif
+#ifndef PKG_ISOTP_C_HW_FILTER_BANK_BASE
+#define PKG_ISOTP_C_HW_FILTER_BANK_BASE 0     ///< First filter bank used by the adapter, lower banks are left to the application.
+#endif
+
+#if PKG_ISOTP_C_HW_FILTER_BANKS < 1 || PKG_ISOTP_C_HW_FILTER_BANKS > 32
+#error "PKG_ISOTP_C_HW_FILTER_BANKS must be between 1 and 32"
+#endif
+
+#define ISOTP_RTT_HW_FILTER_NONE (-1)                              ///< `hw_filter_bank` of a link that is only filtered in software.
+#define ISOTP_RTT_HW_FILTER_TOP  (PKG_ISOTP_C_HW_FILTER_BANKS - 1) ///< Bank holding the accept-all filter while a device falls back.
+#endif /* PKG_ISOTP_C_USING_HW_FILTER */
+
+#ifdef PKG_ISOTP_C_USING_TRACE
+#ifndef PKG_ISOTP_C_TRACE_DEPTH
+#define PKG_ISOTP_C_TRACE_DEPTH 256           ///< Number of records of the frame trace ring, must be a power of two.
+#endif
+#ifndef PKG_ISOTP_C_TRACE_DATA_SIZE
+#ifdef PKG_ISOTP_C_USING_CANFD
+#define PKG_ISOTP_C_TRACE_DATA_SIZE 64        ///< Payload bytes kept per traced frame, longer frames are cut.
+#else
+#define PKG_ISOTP_C_TRACE_DATA_SIZE 8         ///< Payload bytes kept per traced frame, longer frames are cut.
+#endif
+#endif
+
+#if (PKG_ISOTP_C_TRACE_DEPTH & (PKG_ISOTP_C_TRACE_DEPTH - 1)) != 0
+#error "PKG_ISOTP_C_TRACE_DEPTH must be a power of two"
+#endif
+#if PKG_ISOTP_C_TRACE_DATA_SIZE < 3 || PKG_ISOTP_C_TRACE_DATA_SIZE > 64
+#error "PKG_ISOTP_C_TRACE_DATA_SIZE must be between 3 and 64"
+#endif
+
+#define ISOTP_RTT_TRACE_TX    (1 << 0) ///< Trace flag: Sent by the adapter (a frame) or concerns the sender (a state).
+#define ISOTP_RTT_TRACE_IDE   (1 << 1) ///< Trace flag: The frame uses an extended (29-bit) identifier.
+#define ISOTP_RTT_TRACE_RTR   (1 << 2) ///< Trace flag: The frame is a remote frame.
+#define ISOTP_RTT_TRACE_FD    (1 << 3) ///< Trace flag: The frame is a CAN FD frame.
+#define ISOTP_RTT_TRACE_BRS   (1 << 4) ///< Trace flag: The CAN FD frame uses the data bitrate.
+#define ISOTP_RTT_TRACE_STATE (1 << 5) ///< Trace flag: A link state transition {old, new, protocol result} instead of a frame.
+#endif /* PKG_ISOTP_C_USING_TRACE */
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+#ifndef PKG_ISOTP_C_MAX_CAN_PORTS
+#define PKG_ISOTP_C_MAX_CAN_PORTS 4           ///< Maximum number of CAN devices that can be attached at the same time.
+#endif
+#ifndef PKG_ISOTP_C_RX_RING_SIZE
+#define PKG_ISOTP_C_RX_RING_SIZE 64           ///< Number of frames buffered per attached device, must be a power of two.
+#endif
+#ifndef PKG_ISOTP_C_RX_BATCH_SIZE
+#define PKG_ISOTP_C_RX_BATCH_SIZE 16          ///< Maximum number of frames dispatched from one device before moving on to the next.
+#endif
+#ifndef PKG_ISOTP_C_RX_THREAD_STACK_SIZE
+#define PKG_ISOTP_C_RX_THREAD_STACK_SIZE 2048 ///< Stack size of the RX dispatcher thread.
+#endif
+#ifndef PKG_ISOTP_C_RX_THREAD_PRIORITY
+#define PKG_ISOTP_C_RX_THREAD_PRIORITY PKG_ISOTP_C_POLL_THREAD_PRIORITY ///< Priority of the RX dispatcher thread.
+#endif
+
+#if (PKG_ISOTP_C_RX_RING_SIZE & (PKG_ISOTP_C_RX_RING_SIZE - 1)) != 0
+#error "PKG_ISOTP_C_RX_RING_SIZE must be a power of two"
+#endif
+#if PKG_ISOTP_C_MAX_CAN_PORTS > 32
+#error "PKG_ISOTP_C_MAX_CAN_PORTS must not exceed 32"
+#endif
+
+#ifndef PKG_ISOTP_C_ADAPTIVE_FC_WAIT_PERCENT
+#define PKG_ISOTP_C_ADAPTIVE_FC_WAIT_PERCENT 75     ///< Adaptive FC: RX ring fill level at which the sender is told to wait.
+#endif
+#ifndef PKG_ISOTP_C_ADAPTIVE_FC_BUSY_PERCENT
+#define PKG_ISOTP_C_ADAPTIVE_FC_BUSY_PERCENT 50     ///< Adaptive FC: RX ring fill level at which STmin is raised.
+#endif
+#ifndef PKG_ISOTP_C_ADAPTIVE_FC_BUSY_ST_MIN_US
+#define PKG_ISOTP_C_ADAPTIVE_FC_BUSY_ST_MIN_US 1000 ///< Adaptive FC: minimum STmin advertised while the RX ring is busy.
+#endif
+
+#define ISOTP_RTT_FRAME_FLAG_IDE (1 << 0) ///< Frame flag: The frame uses an extended (29-bit) identifier.
+#define ISOTP_RTT_FRAME_FLAG_RTR (1 << 1) ///< Frame flag: The frame is a remote frame.
+#endif /* PKG_ISOTP_C_USING_RX_DISPATCHER */
 
 /**
- * @brief Internal structure representing a single ISO-TP link instance tailored for RT-Thread.
- *
- * This structure encapsulates the core IsoTpLink object and adds RT-Thread specific
- * resources like events for synchronization and mutexes for thread safety.
+ * @brief Header of an entry of a link's RX queue slab, followed by the PDU payload.
+ */
+struct isotp_rtt_rx_entry
+{
+    uint16_t size;                  ///< The size of the queued PDU.
+    uint8_t truncated;              ///< Non-zero if the PDU was truncated to the entry capacity.
+    uint8_t reserved;
+};
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief Compact record of a received CAN frame, as stored in a port's RX ring.
+ */
+struct isotp_rtt_frame
+{
+    uint32_t id;                    ///< The arbitration ID.
+    uint8_t len;                    ///< The payload length in bytes.
+    uint8_t flags;                  ///< ISOTP_RTT_FRAME_FLAG_* bits.
+    uint8_t data[ISO_TP_MAX_FRAME_LEN]; ///< The payload.
+};
+
+/**
+ * @brief A CAN device attached to the adapter-owned RX path.
  */
-struct isotp_rtt_link
+struct isotp_rtt_port
 {
-    IsoTpLink link;                 ///< The underlying isotp-c library link instance.
-    rt_device_t can_dev;            ///< The associated RT-Thread CAN device for this link.
-    uint32_t recv_arbitration_id;   ///< The CAN arbitration ID this link listens to for incoming messages.
-    rt_uint8_t send_ide;            ///< The CAN ID type (Standard/Extended) to use for sending frames.
-    rt_uint8_t send_rtr;            ///< The CAN frame type (Data/Remote) to use for sending frames.
+    rt_device_t can_dev;            ///< The attached device, RT_NULL if the slot is free.
+    rt_err_t (*old_rx_indicate)(rt_device_t dev, rt_size_t size); ///< The rx_indicate callback to restore on detach.
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    struct isotp_rtt_worker *worker; ///< The worker of the device, which drains the ring.
+#endif
+
+    volatile rt_uint32_t head;      ///< Free-running write index, only advanced by the rx_indicate hook.
+    volatile rt_uint32_t tail;      ///< Free-running read index, only advanced by the dispatcher thread.
+    struct isotp_rtt_port_stats stats; ///< RX path counters.
 
-    struct rt_event event;          ///< Event set for synchronizing blocking API calls with asynchronous callbacks.
-    rt_mutex_t send_mutex;          ///< Mutex to ensure thread-safe sending on this specific link.
+    struct isotp_rtt_frame ring[PKG_ISOTP_C_RX_RING_SIZE]; ///< The SPSC frame ring.
+};
+#endif /* PKG_ISOTP_C_USING_RX_DISPATCHER */
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief The thread polling the links of one CAN device, and dispatching its RX port if attached.
+ */
+struct isotp_rtt_worker
+{
+    rt_device_t can_dev;            ///< The device served, RT_NULL if the slot is free.
+    struct rt_list_node active;     ///< The device's links with work for `isotp_poll`, chained by their `active_node`.
+    struct rt_event event;          ///< POLL_EVENT_* flags waking the thread.
+    rt_thread_t thread;             ///< The worker thread.
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    struct isotp_rtt_port *volatile port; ///< The device's RX port, RT_NULL if not attached.
+#endif
+};
+#endif /* PKG_ISOTP_C_USING_DEVICE_WORKERS */
 
-    /* Receive buffer information, provided by the user during creation */
-    uint8_t *rx_buf_ptr;            ///< Pointer to the user-provided buffer for assembling incoming PDUs.
-    uint16_t rx_buf_size;           ///< The total size of the user-provided receive buffer.
-    uint16_t rx_actual_size;        ///< The actual size of the last received PDU.
-    rt_bool_t rx_truncated;         ///< Flag indicating if the last received PDU was truncated.
+#ifdef PKG_ISOTP_C_USING_TX_RING
+/**
+ * @brief The frames waiting to be written to one CAN device, and the thread writing them.
+ * @note  Producers are the threads running the links of the device, they fill the lanes with the
+ *        scheduler locked. The TX thread is the only consumer. Indices are free-running.
+ */
+struct isotp_rtt_tx_ring
+{
+    rt_device_t can_dev;            ///< The device served, RT_NULL if the slot is free.
+    struct rt_event event;          ///< TX_EVENT_KICK, posted when frames are queued.
+    rt_thread_t thread;             ///< The thread writing the queued frames to the device.
+    struct rt_list_node stalled;    ///< Links that found the ring full, chained by their `tx_stall_node`.
+    struct isotp_rtt_tx_ring_stats stats; ///< Counters, see `isotp_rtt_tx_ring_get_stats`.
+    volatile rt_uint32_t head;      ///< Write index of `frames`.
+    volatile rt_uint32_t tail;      ///< Read index of `frames`.
+    volatile rt_uint32_t fc_head;   ///< Write index of `fc`.
+    volatile rt_uint32_t fc_tail;   ///< Read index of `fc`.
+    struct rt_can_msg fc[PKG_ISOTP_C_TX_FC_RING_SIZE];  ///< Flow control lane, always written first.
+    struct rt_can_msg frames[PKG_ISOTP_C_TX_RING_SIZE]; ///< Lane of all other frames, in order.
+};
+#endif /* PKG_ISOTP_C_USING_TX_RING */
 
-    struct rt_list_node node;       ///< Node for linking this instance into the global list of links.
+#ifdef PKG_ISOTP_C_USING_TRACE
+/**
+ * @brief A record of the frame trace ring.
+ */
+struct isotp_rtt_trace_rec
+{
+    uint32_t time_us;               ///< `isotp_user_get_us()` when the frame was sent or received.
+    uint32_t id;                    ///< CAN ID, for a state transition the link's send or receive ID.
+    rt_device_t dev;                ///< The CAN device, RT_NULL if not known.
+    rt_uint8_t flags;               ///< ISOTP_RTT_TRACE_* flags.
+    rt_uint8_t len;                 ///< Length of the frame, may exceed the bytes kept in `data`.
+    rt_uint8_t data[PKG_ISOTP_C_TRACE_DATA_SIZE]; ///< Frame payload.
 };
+#endif
 
 /* Global Resources */
 /**
@@ -68,6 +383,134 @@ struct isotp_rtt_link
  */
 static struct rt_list_node g_link_list_head = RT_LIST_OBJECT_INIT(g_link_list_head);
 
+/**
+ * @brief Serializes changes to the link list and the RX dispatch table with the threads using them.
+ * @note  Taken by `isotp_rtt_init` and `isotp_rtt_detach`, by every walk of a dispatch bucket and
+ *        by every pass of a polling thread over its active list, so a link is never detached (and
+ *        then freed by `isotp_rtt_destroy`) while a dispatch or a poll pass is inside it. It is a
+ *        mutex, so completion callbacks run under it may still detach links themselves.
+ */
+static struct rt_mutex g_link_lock;
+
+#ifndef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief Links with work for `isotp_poll`, chained by their `active_node`.
+ * @note  A link is added when it starts a transfer or otherwise wakes the polling thread, and
+ *        removed by that thread once it has no deadline left, so a pass only visits the links
+ *        in flight no matter how many are registered.
+ */
+static struct rt_list_node g_active_list = RT_LIST_OBJECT_INIT(g_active_list);
+#endif
+
+/**
+ * @brief RX dispatch table, hashed by receive arbitration ID.
+ * @note  Each bucket chains every link whose `recv_arbitration_id` hashes to it, so that a frame
+ *        is only compared against a handful of links regardless of how many are registered.
+ *        Links sharing the same ID and device all stay in the chain, which keeps fan-out working.
+ */
+static struct rt_list_node g_dispatch_table[PKG_ISOTP_C_DISPATCH_HASH_SIZE];
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief Worker threads, one per CAN device, started when the first link or port of a device is set up.
+ */
+static struct isotp_rtt_worker g_workers[PKG_ISOTP_C_MAX_WORKERS];
+#else
+/**
+ * @brief Event used by the polling thread to sleep until the next protocol deadline.
+ * @note  It is posted by `isotp_rtt_send*` and by the RX dispatch path so that the thread
+ *        reacts at once to a new transfer or an incoming Flow Control frame.
+ */
+static struct rt_event g_poll_event;
+#endif
+
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+/**
+ * @brief One-shot hwtimer that posts `g_poll_event` exactly at the next near deadline (e.g. STmin).
+ * @note  RT_NULL if the device could not be opened, the polling thread then falls back to tick timeouts.
+ */
+static rt_device_t g_pace_timer;
+#endif
+
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0
+/**
+ * @brief Fixed-capacity pool `isotp_rtt_create` takes links from, so that creating and destroying
+ *        links per session neither fragments the heap nor has unbounded latency.
+ */
+static struct rt_mempool g_link_pool;
+static rt_uint8_t g_link_pool_mem[PKG_ISOTP_C_LINK_POOL_SIZE * (RT_ALIGN(sizeof(struct isotp_rtt_link), RT_ALIGN_SIZE) + sizeof(rt_uint8_t *))]
+    rt_align(RT_ALIGN_SIZE);
+#endif
+
+#ifdef PKG_ISOTP_C_USING_TX_RING
+/**
+ * @brief TX rings, one per CAN device, set up when the first link of a device is created.
+ */
+static struct isotp_rtt_tx_ring g_tx_rings[PKG_ISOTP_C_MAX_TX_RINGS];
+#endif
+
+#ifdef PKG_ISOTP_C_USING_TRACE
+/**
+ * @brief Binary trace of every frame sent and received and of link state transitions.
+ * @note  Overwrites its oldest records when full. `g_trace_head` is free-running.
+ */
+static struct isotp_rtt_trace_rec g_trace[PKG_ISOTP_C_TRACE_DEPTH];
+static rt_uint32_t g_trace_head;
+static volatile rt_uint8_t g_trace_on = RT_TRUE;
+#endif
+
+static void _isotp_rtt_poll_wakeup(struct isotp_rtt_link *rtt_link);
+#if defined(PKG_ISOTP_C_USING_DEVICE_WORKERS) && defined(PKG_ISOTP_C_USING_RX_DISPATCHER)
+static rt_bool_t _isotp_rtt_port_drain(struct isotp_rtt_port *port);
+#endif
+
+#if defined(RT_CAN_USING_CANFD) && defined(PKG_ISOTP_C_CANFD_LEN_IS_DLC)
+/**
+ * @brief  Converts a CAN data length in bytes into its DLC code.
+ * @note   Only used when the CAN driver expects `rt_can_msg.len` as a DLC code (0..15).
+ */
+rt_inline rt_uint8_t _isotp_rtt_len_to_dlc(rt_uint8_t len)
+{
+    static const rt_uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+    if (len <= 8)
+        return len;
+    for (rt_uint8_t i = 0; i < sizeof(fd_len); i++)
+    {
+        if (len <= fd_len[i])
+            return 9 + i;
+    }
+    return 15;
+}
+
+/**
+ * @brief  Converts a DLC code into a CAN data length in bytes.
+ */
+rt_inline rt_uint8_t _isotp_rtt_dlc_to_len(rt_uint8_t dlc)
+{
+    static const rt_uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+    return dlc <= 8 ? dlc : fd_len[(dlc > 15 ? 15 : dlc) - 9];
+}
+#define ISOTP_RTT_MSG_LEN(msg)          _isotp_rtt_dlc_to_len((msg)->len)
+#define ISOTP_RTT_MSG_SET_LEN(msg, n)   ((msg)->len = _isotp_rtt_len_to_dlc(n))
+#else
+#define ISOTP_RTT_MSG_LEN(msg)          ((msg)->len)
+#define ISOTP_RTT_MSG_SET_LEN(msg, n)   ((msg)->len = (n))
+#endif
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief CAN devices attached to the adapter-owned RX path.
+ */
+static struct isotp_rtt_port g_ports[PKG_ISOTP_C_MAX_CAN_PORTS];
+
+#ifndef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief Event used to wake the RX dispatcher thread. Bit N is set when port N has frames.
+ */
+static struct rt_event g_rx_event;
+#endif
+#endif
+
 /**
  * @brief Helper function to atomically print a title and hex data using ULOG.
  * @note  This function constructs a complete string in a temporary buffer before
@@ -99,453 +542,3887 @@ void print_hex_data(const char *title, const uint8_t *data, uint16_t size)
 #endif
 }
 
-
-/*************************************************************************************************/
-/** @name Shim Functions for isotp-c
- *  @{
- *  @brief These functions are the required callbacks (dependency injection) that bridge
- *         the platform-agnostic isotp-c library with the RT-Thread operating system.
- */
-/*************************************************************************************************/
-
+#ifdef PKG_ISOTP_C_USING_STATS
 /**
- * @brief  Sends a single CAN frame. This is called by the isotp-c library whenever
- *         it needs to transmit a protocol frame (FF, CF, FC).
- * @param  arbitration_id The CAN ID for the message to be sent.
- * @param  data Pointer to the 8-byte (or less) data payload.
- * @param  size The size of the data payload (0-8 bytes).
- * @param  user_send_can_arg The user-defined argument, which we use to pass our isotp_rtt_link struct.
- * @return ISOTP_RET_OK on success, ISOTP_RET_ERROR on failure.
+ * @brief Adds a duration to a latency histogram with power-of-two buckets.
+ * @param hist The histogram, PKG_ISOTP_C_STATS_HIST_BUCKETS entries.
+ * @param us   The duration in microseconds.
  */
-int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size, void *user_send_can_arg)
+static void _isotp_rtt_stats_hist_add(rt_uint32_t *hist, uint32_t us)
 {
-    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_send_can_arg;
-    struct rt_can_msg msg;
+    rt_uint8_t i = 0;
 
-    if (!rtt_link || !rtt_link->can_dev)
-        return ISOTP_RET_ERROR;
-
-    msg.id = arbitration_id;
-    msg.ide = rtt_link->send_ide;
-    msg.rtr = rtt_link->send_rtr;
-    msg.len = size;
-    rt_memcpy(msg.data, data, size);
-
-#if (DBG_LVL >= DBG_LOG)
+    us /= ISOTP_RTT_STATS_HIST_BASE_US;
+    while (us && i < PKG_ISOTP_C_STATS_HIST_BUCKETS - 1)
     {
-        char title_buf[32];
-        rt_snprintf(title_buf, sizeof(title_buf), "[TX] ID: 0x%lX", arbitration_id);
-        print_hex_data(title_buf, msg.data, size);
+        us >>= 1;
+        i++;
     }
+    hist[i]++;
+}
 #endif
 
-    return (rt_device_write(rtt_link->can_dev, 0, &msg, sizeof(msg)) == sizeof(msg)) ? ISOTP_RET_OK : ISOTP_RET_ERROR;
+#ifdef PKG_ISOTP_C_USING_TRACE
+/**
+ * @brief  Appends a record to the frame trace ring, overwriting the oldest one when it is full.
+ * @note   Safe in ISR and thread context alike: the slot is claimed and filled with interrupts
+ *         disabled, which costs a few stores and a copy of at most PKG_ISOTP_C_TRACE_DATA_SIZE bytes.
+ * @param  dev The CAN device, RT_NULL if not known.
+ * @param  id The CAN ID.
+ * @param  flags ISOTP_RTT_TRACE_* flags.
+ * @param  data The frame payload.
+ * @param  len The frame length.
+ */
+static void _isotp_rtt_trace(rt_device_t dev, uint32_t id, rt_uint8_t flags, const rt_uint8_t *data, rt_uint8_t len)
+{
+    if (!g_trace_on)
+        return;
+
+    uint32_t now = isotp_user_get_us();
+    rt_base_t level = rt_hw_interrupt_disable();
+    struct isotp_rtt_trace_rec *rec = &g_trace[g_trace_head++ & (PKG_ISOTP_C_TRACE_DEPTH - 1)];
+    rec->time_us = now;
+    rec->id = id;
+    rec->dev = dev;
+    rec->flags = flags;
+    rec->len = len;
+    rt_memcpy(rec->data, data, len > sizeof(rec->data) ? sizeof(rec->data) : len);
+    rt_hw_interrupt_enable(level);
 }
 
 /**
- * @brief  Provides a microsecond-resolution timestamp to the isotp-c library.
- * @note   This is critical for protocol timing (e.g., timeouts, STmin).
- * @return A 32-bit microsecond timestamp.
+ * @brief  Returns the ISOTP_RTT_TRACE_* flags describing the format of a CAN message.
  */
-uint32_t isotp_user_get_us(void)
+rt_inline rt_uint8_t _isotp_rtt_trace_msg_flags(const struct rt_can_msg *msg)
 {
-    //TODO: 使用更高精度的API
-    return (uint32_t)((rt_uint64_t)rt_tick_get() * 1000000 / RT_TICK_PER_SECOND);
+    rt_uint8_t flags = (msg->ide ? ISOTP_RTT_TRACE_IDE : 0) | (msg->rtr ? ISOTP_RTT_TRACE_RTR : 0);
+#ifdef RT_CAN_USING_CANFD
+    if (msg->fd_frame)
+        flags |= ISOTP_RTT_TRACE_FD | (msg->brs ? ISOTP_RTT_TRACE_BRS : 0);
+#endif
+    return flags;
 }
 
 /**
- * @brief  Acts as the logging sink for the isotp-c library's internal debug messages.
- * @param  format The format string (printf-style).
- * @param  ... Variadic arguments for the format string.
+ * @brief  Records the send and receive status changes of a link since its last call.
+ * @note   Called after every operation of the adapter that can move the core's state machines.
  */
-void isotp_user_debug(const char *format, ...)
+static void _isotp_rtt_trace_state(struct isotp_rtt_link *rtt_link)
 {
-#if defined(RT_USING_ULOG) && defined(ULOG_BACKEND_USING_CONSOLE)
-    va_list args;
-    va_start(args, format);
-    ulog_voutput(DBG_LVL, DBG_TAG, RT_TRUE, RT_NULL, 0, 0, 0, format, args);
-    va_end(args);
-#else
-    va_list args;
-    rt_kprintf("[%s/D] ", DBG_TAG);
-    va_start(args, format);
-    rt_vprintf(format, args);
-    va_end(args);
-    rt_kprintf("\n");
-#endif
+    rt_uint8_t event[3];
+
+    if (rtt_link->trace_send_status != rtt_link->link.send_status)
+    {
+        event[0] = rtt_link->trace_send_status;
+        event[1] = rtt_link->trace_send_status = rtt_link->link.send_status;
+        event[2] = (rt_uint8_t)rtt_link->link.send_protocol_result;
+        _isotp_rtt_trace(rtt_link->can_dev, rtt_link->link.send_arbitration_id, ISOTP_RTT_TRACE_STATE | ISOTP_RTT_TRACE_TX, event, 3);
+    }
+    if (rtt_link->trace_receive_status != rtt_link->link.receive_status)
+    {
+        event[0] = rtt_link->trace_receive_status;
+        event[1] = rtt_link->trace_receive_status = rtt_link->link.receive_status;
+        event[2] = (rt_uint8_t)rtt_link->link.receive_protocol_result;
+        _isotp_rtt_trace(rtt_link->can_dev, rtt_link->recv_arbitration_id, ISOTP_RTT_TRACE_STATE, event, 3);
+    }
 }
-/** @} */
+#endif
 
 
+#ifdef PKG_ISOTP_C_USING_TX_RING
 /*************************************************************************************************/
-/** @name Internal Event Callbacks
+/** @name Internal TX Ring
  *  @{
- *  @brief These static functions are called by the isotp-c library upon completion of
- *         asynchronous operations. Their primary role is to signal waiting threads.
+ *  @brief With PKG_ISOTP_C_USING_TX_RING the shim never blocks in `rt_device_write`: frames are
+ *         copied into a per-device ring and written by a TX thread, which takes the blocking
+ *         driver call (e.g. waiting for a free mailbox) on behalf of the polling and RX threads.
+ *         Flow control frames have their own lane that is always written first, so a receiver's
+ *         FC does not wait behind another link's bulk transfer. A full ring is reported to the
+ *         core as ISOTP_RET_NOSPACE and the link is woken up once the thread made room: the core
+ *         resends a consecutive or flow control frame from `isotp_poll`, and a request whose
+ *         single or first frame did not fit stays at the head of the queue and is started again.
  */
 /*************************************************************************************************/
 
 /**
- * @brief  Called by isotp-c when a complete PDU has been transmitted successfully.
- * @note   Its sole purpose is to post an event to unblock any thread waiting in `isotp_rtt_send`.
- * @param  link_ptr A pointer to the core IsoTpLink instance.
- * @param  size The size of the PDU that was sent.
- * @param  user_arg The user argument, which points to our isotp_rtt_link struct.
+ * @brief  Writes frames of a TX ring to its device, counting the frames it does not accept.
+ */
+static void _isotp_rtt_tx_ring_write(struct isotp_rtt_tx_ring *ring, const struct rt_can_msg *msgs, rt_uint32_t count)
+{
+    /* A negative error code (RT-Thread >= 5.0.1) turns into a huge unsigned value. */
+    rt_size_t written = (rt_size_t)rt_device_write(ring->can_dev, 0, msgs, count * sizeof(msgs[0]));
+    rt_uint32_t n = (written <= count * sizeof(msgs[0])) ? (rt_uint32_t)(written / sizeof(msgs[0])) : 0;
+
+    ring->stats.tx_frames += n;
+    if (n < count)
+    {
+        ring->stats.tx_dropped += count - n;
+        LOG_W("Device:%s did not accept %u queued frames.", ring->can_dev->parent.name, count - n);
+    }
+}
+
+/**
+ * @brief  The entry point of the TX thread of a CAN device.
+ * @note   Writes all pending flow control frames before each burst of up to
+ *         PKG_ISOTP_C_TX_RING_BURST other frames, and wakes the links that found the ring full
+ *         after every write.
+ * @param  parameter The `struct isotp_rtt_tx_ring` of the device.
+ */
+static void _isotp_rtt_tx_thread_entry(void *parameter)
+{
+    struct isotp_rtt_tx_ring *ring = (struct isotp_rtt_tx_ring *)parameter;
+    struct isotp_rtt_link *rtt_link;
+    rt_uint32_t recved_evt;
+    rt_uint32_t index, count;
+
+    while (1)
+    {
+        rt_event_recv(&ring->event, TX_EVENT_KICK, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, RT_WAITING_FOREVER, &recved_evt);
+
+        while (1)
+        {
+            if (ring->fc_tail != ring->fc_head)
+            {
+                _isotp_rtt_tx_ring_write(ring, &ring->fc[ring->fc_tail & (PKG_ISOTP_C_TX_FC_RING_SIZE - 1)], 1);
+                ring->fc_tail++;
+            }
+            else
+            {
+                count = ring->head - ring->tail;
+                if (count == 0)
+                    break;
+                index = ring->tail & (PKG_ISOTP_C_TX_RING_SIZE - 1);
+                if (count > PKG_ISOTP_C_TX_RING_SIZE - index)
+                    count = PKG_ISOTP_C_TX_RING_SIZE - index;
+                if (count > PKG_ISOTP_C_TX_RING_BURST)
+                    count = PKG_ISOTP_C_TX_RING_BURST;
+                _isotp_rtt_tx_ring_write(ring, &ring->frames[index], count);
+                ring->tail += count;
+            }
+
+            /* Under the scheduler lock, so that a link detached meanwhile is not woken up. */
+            rt_enter_critical();
+            while (!rt_list_isempty(&ring->stalled))
+            {
+                rtt_link = rt_list_entry(ring->stalled.next, struct isotp_rtt_link, tx_stall_node);
+                rt_list_remove(&rtt_link->tx_stall_node);
+                rtt_link->tx_stalled = RT_FALSE;
+                _isotp_rtt_poll_wakeup(rtt_link);
+            }
+            rt_exit_critical();
+        }
+    }
+}
+
+/**
+ * @brief  Returns the TX ring of a CAN device, starting its thread on first use.
+ * @return The ring, or RT_NULL if all PKG_ISOTP_C_MAX_TX_RINGS are in use or its thread could not be created.
+ */
+static struct isotp_rtt_tx_ring *_isotp_rtt_tx_ring_get(rt_device_t can_dev)
+{
+    struct isotp_rtt_tx_ring *ring = RT_NULL;
+    char name[RT_NAME_MAX];
+
+    for (int i = 0; i < PKG_ISOTP_C_MAX_TX_RINGS; i++)
+    {
+        if (g_tx_rings[i].can_dev == can_dev)
+            return &g_tx_rings[i];
+        if (!ring && !g_tx_rings[i].can_dev)
+            ring = &g_tx_rings[i];
+    }
+    if (!ring)
+    {
+        LOG_E("No free TX ring for device:%s, raise PKG_ISOTP_C_MAX_TX_RINGS.", can_dev->parent.name);
+        return RT_NULL;
+    }
+
+    rt_snprintf(name, RT_NAME_MAX, "isotp_t%d", (int)(ring - g_tx_rings));
+    rt_list_init(&ring->stalled);
+    ring->head = ring->tail = ring->fc_head = ring->fc_tail = 0;
+    rt_memset(&ring->stats, 0, sizeof(ring->stats));
+    rt_event_init(&ring->event, name, RT_IPC_FLAG_FIFO);
+    ring->thread = rt_thread_create(name, _isotp_rtt_tx_thread_entry, ring, PKG_ISOTP_C_TX_THREAD_STACK_SIZE, PKG_ISOTP_C_TX_THREAD_PRIORITY, 10);
+    if (!ring->thread)
+    {
+        rt_event_detach(&ring->event);
+        LOG_E("Failed to create the TX thread of device:%s.", can_dev->parent.name);
+        return RT_NULL;
+    }
+    ring->can_dev = can_dev;
+    rt_thread_startup(ring->thread);
+    return ring;
+}
+
+/**
+ * @brief  Tells whether a link has a queued request that did not fit into the TX ring and may
+ *         be started again, see `_isotp_rtt_tx_kick`.
+ */
+rt_inline rt_bool_t _isotp_rtt_tx_ring_retry_due(const struct isotp_rtt_link *rtt_link)
+{
+    return !rtt_link->tx_stalled && !rtt_link->tx_active && !rtt_link->tx_kicking && rtt_link->txq_head != rtt_link->txq_tail;
+}
+
+/**
+ * @brief  Queues frames of a link on the TX ring of its device without blocking.
+ * @note   Flow control frames go to their own lane. Consecutive frames leave
+ *         ISOTP_RTT_TX_RING_RESERVE slots free for the single and first frames of other links.
+ *         When the frames do not all fit, the link is marked `tx_stalled` and woken up by the
+ *         TX thread once it has written some frames.
+ * @param  rtt_link The sending link.
+ * @param  msgs The frames, all of the same PCI type.
+ * @param  count The number of frames.
+ * @return The number of frames queued, from the start of `msgs`.
+ */
+static rt_uint32_t _isotp_rtt_tx_ring_put(struct isotp_rtt_link *rtt_link, const struct rt_can_msg *msgs, rt_uint32_t count)
+{
+    struct isotp_rtt_tx_ring *ring = rtt_link->tx_ring;
+    rt_uint8_t pci_type = msgs[0].data[ISOTP_RTT_ADDR_LEN(rtt_link)] >> 4;
+    rt_uint32_t n = 0;
+
+    rt_enter_critical();
+    if (ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME == pci_type)
+    {
+        for (; n < count && ring->fc_head - ring->fc_tail < PKG_ISOTP_C_TX_FC_RING_SIZE; n++)
+            ring->fc[ring->fc_head++ & (PKG_ISOTP_C_TX_FC_RING_SIZE - 1)] = msgs[n];
+    }
+    else
+    {
+        rt_uint32_t limit = PKG_ISOTP_C_TX_RING_SIZE - (ISOTP_PCI_TYPE_CONSECUTIVE_FRAME == pci_type ? ISOTP_RTT_TX_RING_RESERVE : 0);
+
+        for (; n < count && ring->head - ring->tail < limit; n++)
+            ring->frames[ring->head++ & (PKG_ISOTP_C_TX_RING_SIZE - 1)] = msgs[n];
+    }
+    if (n < count && !rtt_link->tx_stalled)
+    {
+        rtt_link->tx_stalled = RT_TRUE;
+        rt_list_insert_before(&ring->stalled, &rtt_link->tx_stall_node);
+    }
+    rt_exit_critical();
+
+    if (n > 0)
+        rt_event_send(&ring->event, TX_EVENT_KICK);
+    return n;
+}
+/** @} */
+#endif /* PKG_ISOTP_C_USING_TX_RING */
+
+
+/*************************************************************************************************/
+/** @name Shim Functions for isotp-c
+ *  @{
+ *  @brief These functions are the required callbacks (dependency injection) that bridge
+ *         the platform-agnostic isotp-c library with the RT-Thread operating system.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Formats one outgoing protocol frame of a link as an RT-Thread CAN message.
+ * @note   `data` may already be the data field of `msg`, it is then not copied.
+ * @return RT_EOK on success, -RT_EINVAL if the frame does not fit into `msg`.
+ */
+static rt_err_t _isotp_rtt_fill_msg(const struct isotp_rtt_link *rtt_link, struct rt_can_msg *msg,
+                                    uint32_t arbitration_id, const uint8_t *data, uint8_t size)
+{
+    msg->id = arbitration_id;
+    msg->ide = rtt_link->send_ide;
+    msg->rtr = rtt_link->send_rtr;
+#ifdef RT_CAN_USING_CANFD
+    /* ISO 15765-2:2016: every frame of a link with TX_DL > 8 uses the CAN FD format */
+    msg->fd_frame = (rtt_link->send_fd || size > 8) ? 1 : 0;
+    msg->brs = (msg->fd_frame && rtt_link->send_brs) ? 1 : 0;
+#endif
+    if (size > sizeof(msg->data))
+        return -RT_EINVAL;
+    ISOTP_RTT_MSG_SET_LEN(msg, size);
+    if (data != msg->data)
+        rt_memcpy(msg->data, data, size);
+
+#if (DBG_LVL >= DBG_LOG)
+    {
+        char title_buf[32];
+        rt_snprintf(title_buf, sizeof(title_buf), "[TX] ID: 0x%lX", arbitration_id);
+        print_hex_data(title_buf, msg->data, size);
+    }
+#endif
+    return RT_EOK;
+}
+
+/**
+ * @brief  Sends a formatted CAN message of a link, on the TX ring or straight to the device.
+ * @param  rtt_link The sending link.
+ * @param  msg The message.
+ * @param  size The frame length in bytes.
+ * @return Same as `isotp_user_send_can`.
+ */
+static int _isotp_rtt_send_msg(struct isotp_rtt_link *rtt_link, struct rt_can_msg *msg, uint8_t size)
+{
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    if (_isotp_rtt_tx_ring_put(rtt_link, msg, 1) != 1)
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_nospace);
+        return ISOTP_RET_NOSPACE;
+    }
+#else
+    if (rt_device_write(rtt_link->can_dev, 0, msg, sizeof(*msg)) != sizeof(*msg))
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_write_errors);
+        return ISOTP_RET_ERROR;
+    }
+#endif
+    ISOTP_RTT_STAT_INC(rtt_link, tx_frames);
+#ifdef PKG_ISOTP_C_USING_TRACE
+    _isotp_rtt_trace(rtt_link->can_dev, msg->id, _isotp_rtt_trace_msg_flags(msg) | ISOTP_RTT_TRACE_TX, msg->data, size);
+#else
+    (void)size;
+#endif
+
+#ifdef PKG_ISOTP_C_USING_STATS
+    /* A sender waits for FC after the FF and after each CF, the one that ends a block is answered. */
+    rt_uint8_t pci_type = msg->data[ISOTP_RTT_ADDR_LEN(rtt_link)] >> 4;
+    if (pci_type == ISOTP_PCI_TYPE_FIRST_FRAME || pci_type == ISOTP_PCI_TYPE_CONSECUTIVE_FRAME)
+    {
+        rtt_link->fc_start_us = isotp_user_get_us();
+        rtt_link->stats_flags |= ISOTP_RTT_STATS_FC_TIMING;
+    }
+#endif
+    return ISOTP_RET_OK;
+}
+
+/**
+ * @brief  Sends a single CAN frame. This is called by the isotp-c library whenever
+ *         it needs to transmit a protocol frame (FF, CF, FC).
+ * @param  arbitration_id The CAN ID for the message to be sent.
+ * @param  data Pointer to the data payload.
+ * @param  size The size of the data payload (0-8 bytes, up to 64 bytes for CAN FD links).
+ * @param  user_send_can_arg The user-defined argument, which we use to pass our isotp_rtt_link struct.
+ * @return ISOTP_RET_OK on success, ISOTP_RET_ERROR on failure, ISOTP_RET_NOSPACE if the TX ring
+ *         of the device is full (PKG_ISOTP_C_USING_TX_RING).
+ */
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size, void *user_send_can_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_send_can_arg;
+    struct rt_can_msg msg;
+
+    if (!rtt_link || !rtt_link->can_dev)
+        return ISOTP_RET_ERROR;
+
+    if (_isotp_rtt_fill_msg(rtt_link, &msg, arbitration_id, data, size) != RT_EOK)
+        return ISOTP_RET_ERROR;
+
+    return _isotp_rtt_send_msg(rtt_link, &msg, size);
+}
+
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+/**
+ * @brief  Returns the data field of a CAN message of the link for the core to format the next frame
+ *         in, so that each payload byte is copied once on its way from the send buffer or streaming
+ *         source to the driver. Enabled with PKG_ISOTP_C_USING_DIRECT_TX.
+ * @note   Flow control frames have their own message: the RX path of a link may answer a First
+ *         Frame while its polling thread formats a consecutive frame of its own transmission.
+ * @param  arbitration_id The CAN ID of the frame.
+ * @param  pci_type The ISOTP_PCI_TYPE_* of the frame.
+ * @param  user_send_can_arg The isotp_rtt_link struct of the sending link.
+ * @return The data field of `fc_msg` or of `tx_msg`.
+ */
+uint8_t *isotp_user_alloc_can(const uint32_t arbitration_id, const uint8_t pci_type, void *user_send_can_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_send_can_arg;
+
+    (void)arbitration_id;
+    if (!rtt_link)
+        return RT_NULL;
+    return (pci_type == ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME) ? rtt_link->fc_msg.data : rtt_link->tx_msg.data;
+}
+
+/**
+ * @brief  Sends the frame the core formatted in a message of `isotp_user_alloc_can`.
+ * @param  arbitration_id The CAN ID of the frame.
+ * @param  data The data field returned by `isotp_user_alloc_can`.
+ * @param  size The frame length, 0 if the core dropped the frame.
+ * @param  user_send_can_arg The isotp_rtt_link struct of the sending link.
+ * @return Same as `isotp_user_send_can`.
+ */
+int isotp_user_commit_can(const uint32_t arbitration_id, uint8_t *data, const uint8_t size, void *user_send_can_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_send_can_arg;
+    struct rt_can_msg *msg;
+
+    if (!rtt_link)
+        return ISOTP_RET_ERROR;
+    if (size == 0)
+        return ISOTP_RET_OK;
+    if (!rtt_link->can_dev)
+        return ISOTP_RET_ERROR;
+
+    msg = (data == rtt_link->fc_msg.data) ? &rtt_link->fc_msg : &rtt_link->tx_msg;
+    if (_isotp_rtt_fill_msg(rtt_link, msg, arbitration_id, data, size) != RT_EOK)
+        return ISOTP_RET_ERROR;
+
+    return _isotp_rtt_send_msg(rtt_link, msg, size);
+}
+#endif
+
+#ifdef ISO_TP_USER_SEND_CAN_BATCH
+/**
+ * @brief  Sends several consecutive frames of a link with a single `rt_device_write` call, so that
+ *         the driver entry, its lock and the mailbox check are paid once per batch instead of once
+ *         per frame. Enabled with PKG_ISOTP_C_USING_TX_BATCH.
+ * @param  arbitration_id The CAN ID of all frames.
+ * @param  data The frames, frame i starts at `data + i * ISO_TP_MAX_FRAME_LEN`.
+ * @param  sizes The size of each frame.
+ * @param  count The number of frames, at most ISO_TP_MAX_CF_BATCH.
+ * @param  user_send_can_arg The isotp_rtt_link struct of the sending link.
+ * @return The number of frames the device accepted, or ISOTP_RET_ERROR if it accepted none
+ *         (ISOTP_RET_NOSPACE with PKG_ISOTP_C_USING_TX_RING, frames are then retried).
+ */
+int isotp_user_send_can_batch(const uint32_t arbitration_id, const uint8_t *data, const uint8_t *sizes, const uint8_t count, void *user_send_can_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_send_can_arg;
+    struct rt_can_msg msgs[ISO_TP_MAX_CF_BATCH];
+    rt_uint8_t n;
+
+    if (!rtt_link || !rtt_link->can_dev || count == 0 || count > ISO_TP_MAX_CF_BATCH)
+        return ISOTP_RET_ERROR;
+
+    for (n = 0; n < count; n++)
+    {
+        if (_isotp_rtt_fill_msg(rtt_link, &msgs[n], arbitration_id, data + n * ISO_TP_MAX_FRAME_LEN, sizes[n]) != RT_EOK)
+            return ISOTP_RET_ERROR;
+    }
+
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    n = (rt_uint8_t)_isotp_rtt_tx_ring_put(rtt_link, msgs, count);
+    if (n == 0)
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_nospace);
+        return ISOTP_RET_NOSPACE;
+    }
+#else
+    /* The CAN device writes the frames in order and reports how many bytes it has taken;
+     * a negative error code (RT-Thread >= 5.0.1) turns into a huge unsigned value. */
+    rt_size_t written = (rt_size_t)rt_device_write(rtt_link->can_dev, 0, msgs, count * sizeof(msgs[0]));
+    n = (written <= count * sizeof(msgs[0])) ? (rt_uint8_t)(written / sizeof(msgs[0])) : 0;
+    if (n == 0)
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_write_errors);
+        return ISOTP_RET_ERROR;
+    }
+#endif
+    ISOTP_RTT_STAT_ADD(rtt_link, tx_frames, n);
+#ifdef PKG_ISOTP_C_USING_TRACE
+    for (rt_uint8_t i = 0; i < n; i++)
+        _isotp_rtt_trace(rtt_link->can_dev, arbitration_id, _isotp_rtt_trace_msg_flags(&msgs[i]) | ISOTP_RTT_TRACE_TX,
+                         data + i * ISO_TP_MAX_FRAME_LEN, sizes[i]);
+#endif
+
+#ifdef PKG_ISOTP_C_USING_STATS
+    rtt_link->fc_start_us = isotp_user_get_us();
+    rtt_link->stats_flags |= ISOTP_RTT_STATS_FC_TIMING;
+#endif
+    return n;
+}
+#endif
+
+#if defined(PKG_ISOTP_C_TIMEBASE_CLOCK_CPU) || defined(PKG_ISOTP_C_TIMEBASE_DWT)
+static rt_uint32_t g_timebase_last; ///< Hardware counter at the previous call of `isotp_user_get_us`.
+static rt_uint64_t g_timebase_rem;  ///< Remainder of the last conversion, in counts times `num`.
+static rt_uint32_t g_timebase_us;   ///< Free-running microsecond counter derived from the hardware counter.
+#ifdef PKG_ISOTP_C_TIMEBASE_CLOCK_CPU
+static rt_uint64_t g_timebase_res;  ///< `clock_cpu_getres()`: nanoseconds per count, scaled by 1000000.
+#endif
+
+/**
+ * @brief  Advances the microsecond counter by the counts elapsed since the previous call.
+ * @note   The elapsed counts are converted as counts * num / den, carrying the remainder over to the
+ *         next call so no time is lost to rounding. The delta is taken modulo 2^32, so the hardware
+ *         counter must either wrap at 2^32 or be wider, and must not advance by 2^32 counts between
+ *         two calls.
+ * @param  now Current value of the hardware counter (its low 32 bits).
+ * @param  num Numerator of the counts-to-microseconds ratio.
+ * @param  den Denominator of the counts-to-microseconds ratio.
+ * @return The updated 32-bit microsecond timestamp.
+ */
+static rt_uint32_t _isotp_rtt_timebase_advance(rt_uint32_t now, rt_uint64_t num, rt_uint64_t den)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_uint64_t units = g_timebase_rem + (rt_uint64_t)(rt_uint32_t)(now - g_timebase_last) * num;
+    g_timebase_last = now;
+    g_timebase_us += (rt_uint32_t)(units / den);
+    g_timebase_rem = units % den;
+    rt_uint32_t us = g_timebase_us;
+    rt_hw_interrupt_enable(level);
+    return us;
+}
+#endif
+
+#if defined(PKG_ISOTP_C_TIMEBASE_CLOCK_CPU)
+/**
+ * @brief  Caches the cputime resolution and seeds the microsecond counter from the current count.
+ */
+static void _isotp_rtt_timebase_init(void)
+{
+    g_timebase_res = clock_cpu_getres();
+    g_timebase_last = (rt_uint32_t)clock_cpu_gettime();
+}
+#elif defined(PKG_ISOTP_C_TIMEBASE_DWT)
+/**
+ * @brief  Enables the DWT cycle counter.
+ * @note   The counter is shared with the cputime driver and profilers, so it is not reset: the
+ *         microsecond counter starts from its current value.
+ */
+static void _isotp_rtt_timebase_init(void)
+{
+    DWT_DEMCR |= (1UL << 24); /* TRCENA */
+    DWT_LAR = 0xC5ACCE55UL;   /* unlock, required on Cortex-M7 and ignored elsewhere */
+    DWT_CTRL |= 1UL;          /* CYCCNTENA */
+    g_timebase_last = DWT_CYCCNT;
+}
+#else
+rt_inline void _isotp_rtt_timebase_init(void)
+{
+}
+#endif
+
+/**
+ * @brief  Provides a microsecond-resolution timestamp to the isotp-c library.
+ * @note   This is critical for protocol timing (e.g., timeouts, STmin). The backend is selected with
+ *         one of the PKG_ISOTP_C_TIMEBASE_* options:
+ *         - TICK: derived from `rt_tick_get()`, resolution of one OS tick (default).
+ *         - CLOCK_CPU: RT-Thread's `clock_cpu` (cputime) driver, resolution of its hardware counter,
+ *           converted with `clock_cpu_getres()`.
+ *         - DWT: Cortex-M DWT cycle counter, converted with PKG_ISOTP_C_DWT_CPU_FREQ_HZ.
+ *         The hardware backends accumulate the counts elapsed since the previous call, so the
+ *         microsecond value keeps counting across wraps of a 32-bit counter as long as the function
+ *         is called at least once per wrap period (every link in progress is polled far more often
+ *         than that).
+ *         The result wraps at 2^32 us, which the core handles with IsoTpTimeAfter.
+ * @return A 32-bit microsecond timestamp.
+ */
+uint32_t isotp_user_get_us(void)
+{
+#if defined(PKG_ISOTP_C_TIMEBASE_CLOCK_CPU)
+    return _isotp_rtt_timebase_advance((rt_uint32_t)clock_cpu_gettime(), g_timebase_res, 1000000000ULL);
+#elif defined(PKG_ISOTP_C_TIMEBASE_DWT)
+    return _isotp_rtt_timebase_advance(DWT_CYCCNT, 1000000UL, PKG_ISOTP_C_DWT_CPU_FREQ_HZ);
+#else
+    return (uint32_t)((rt_uint64_t)rt_tick_get() * 1000000 / RT_TICK_PER_SECOND);
+#endif
+}
+
+/**
+ * @brief  Acts as the logging sink for the isotp-c library's internal debug messages.
+ * @param  format The format string (printf-style).
+ * @param  ... Variadic arguments for the format string.
+ */
+void isotp_user_debug(const char *format, ...)
+{
+#if defined(RT_USING_ULOG) && defined(ULOG_BACKEND_USING_CONSOLE)
+    va_list args;
+    va_start(args, format);
+    ulog_voutput(DBG_LVL, DBG_TAG, RT_TRUE, RT_NULL, 0, 0, 0, format, args);
+    va_end(args);
+#else
+    va_list args;
+    rt_kprintf("[%s/D] ", DBG_TAG);
+    va_start(args, format);
+    rt_vprintf(format, args);
+    va_end(args);
+    rt_kprintf("\n");
+#endif
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Internal TX Queue
+ *  @{
+ *  @brief Every PDU sent on a link passes through its bounded transmit queue. The next request
+ *         is started as soon as the previous one completes, directly from the completion path.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Tells whether the request with the given free-running queue index has been started.
+ * @note   Must be called with interrupts disabled.
+ */
+rt_inline rt_bool_t _isotp_rtt_tx_started(struct isotp_rtt_link *rtt_link, rt_uint32_t index)
+{
+    return ((rt_int32_t)(index - rtt_link->txq_tail) < 0) || (index == rtt_link->txq_tail && rtt_link->tx_active);
+}
+
+/**
+ * @brief  Returns the size of a queued request's PDU.
+ */
+rt_inline uint32_t _isotp_rtt_tx_req_size(const struct isotp_rtt_tx_req *req)
+{
+#ifdef ISO_TP_STREAMING_SEND
+    if (req->stream_size)
+        return req->stream_size;
+#endif
+    return req->size;
+}
+
+#ifdef ISO_TP_STREAMING_SEND
+/**
+ * @brief  Payload source the core calls for a streaming request; forwards to the request's `source`.
+ * @note   `isotp_rtt_send_stream` clears `source` when it gives up on a request that has already
+ *         started, which makes the core abort the transmission at its next frame.
+ */
+static int _isotp_rtt_stream_source(void *link, uint32_t offset, uint8_t *data, uint8_t size, void *arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)arg;
+    struct isotp_rtt_tx_req *req = &rtt_link->txq[rtt_link->txq_tail % PKG_ISOTP_C_TX_QUEUE_DEPTH];
+    isotp_tx_source_cb source = req->source;
+
+    if (!source)
+        return ISOTP_RET_ERROR;
+    return source(rtt_link, offset, data, size, req->source_arg);
+}
+#endif
+
+/**
+ * @brief  Finishes the request in progress and reports its final status.
+ * @param  rtt_link The link.
+ * @param  result An ISOTP_PROTOCOL_RESULT_* code.
+ */
+static void _isotp_rtt_tx_complete(struct isotp_rtt_link *rtt_link, int result)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (!rtt_link->tx_active)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    struct isotp_rtt_tx_req req = rtt_link->txq[rtt_link->txq_tail % PKG_ISOTP_C_TX_QUEUE_DEPTH];
+    rtt_link->txq_tail++;
+    rtt_link->tx_active = RT_FALSE;
+    rt_hw_interrupt_enable(level);
+
+    if (result == ISOTP_PROTOCOL_RESULT_OK)
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_pdus);
+        ISOTP_RTT_STAT_ADD(rtt_link, tx_bytes, _isotp_rtt_tx_req_size(&req));
+    }
+    else
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, tx_failed);
+        if (result == ISOTP_PROTOCOL_RESULT_TIMEOUT_BS)
+            ISOTP_RTT_STAT_INC(rtt_link, tx_timeout_bs);
+    }
+#ifdef PKG_ISOTP_C_USING_STATS
+    if (rtt_link->stats_flags & ISOTP_RTT_STATS_TX_TIMING)
+    {
+        if (result == ISOTP_PROTOCOL_RESULT_OK)
+            _isotp_rtt_stats_hist_add(rtt_link->stats.tx_time_hist, isotp_user_get_us() - rtt_link->tx_start_us);
+        rtt_link->stats_flags &= ~(ISOTP_RTT_STATS_TX_TIMING | ISOTP_RTT_STATS_FC_TIMING);
+    }
+#endif
+
+    if (req.cb)
+        req.cb(rtt_link, result, req.cb_arg);
+}
+
+/**
+ * @brief  Starts queued requests until one is in progress or the queue is empty.
+ * @note   Single frames complete synchronously inside `isotp_send`, so the completion path
+ *         may call back into this function. Only one caller at a time starts requests; a
+ *         nested or concurrent call just flags the queue for another pass.
+ * @param  rtt_link The link.
+ */
+static void _isotp_rtt_tx_kick(struct isotp_rtt_link *rtt_link)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (rtt_link->tx_kicking)
+    {
+        rtt_link->tx_kick_pending = RT_TRUE;
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    rtt_link->tx_kicking = RT_TRUE;
+
+    while (1)
+    {
+        rtt_link->tx_kick_pending = RT_FALSE;
+
+        while (!rtt_link->tx_active && rtt_link->txq_head != rtt_link->txq_tail)
+        {
+            struct isotp_rtt_tx_req *req = &rtt_link->txq[rtt_link->txq_tail % PKG_ISOTP_C_TX_QUEUE_DEPTH];
+            if (req->cancelled)
+            {
+                rtt_link->txq_tail++;
+                continue;
+            }
+            rtt_link->tx_active = RT_TRUE;
+            rt_hw_interrupt_enable(level);
+
+#ifdef PKG_ISOTP_C_USING_STATS
+            /* Only segmented transmissions are timed, a Single Frame completes inside isotp_send. */
+            rtt_link->tx_start_us = isotp_user_get_us();
+            if (_isotp_rtt_tx_req_size(req) > (rtt_link->link.send_tx_dl <= 8 ? 7u : rtt_link->link.send_tx_dl - 2u))
+                rtt_link->stats_flags |= ISOTP_RTT_STATS_TX_TIMING;
+#endif
+            int ret;
+#ifdef ISO_TP_STREAMING_SEND
+            if (req->stream_size)
+                ret = isotp_send_stream(&rtt_link->link, req->stream_size, _isotp_rtt_stream_source, rtt_link);
+            else
+#endif
+                ret = isotp_send(&rtt_link->link, req->payload, req->size);
+#ifdef PKG_ISOTP_C_USING_TRACE
+            _isotp_rtt_trace_state(rtt_link);
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+            if (ret == ISOTP_RET_NOSPACE)
+            {
+                /* The TX ring had no room for the first frame: keep the request at the head, it is
+                 * started again from the polling thread once the TX thread woke the link up. */
+                level = rt_hw_interrupt_disable();
+                rtt_link->tx_active = RT_FALSE;
+                if (rtt_link->tx_stalled)
+                    break;
+                continue;
+            }
+#endif
+            if (ret != ISOTP_RET_OK)
+            {
+                LOG_E("isotp_send failed immediately with code: %d", ret);
+                _isotp_rtt_tx_complete(rtt_link, ISOTP_PROTOCOL_RESULT_ERROR);
+            }
+
+            level = rt_hw_interrupt_disable();
+        }
+
+        if (!rtt_link->tx_kick_pending)
+            break;
+    }
+
+    rtt_link->tx_kicking = RT_FALSE;
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * @brief  Appends a prepared request to a link's transmit queue and starts it if the link is idle.
+ * @param  rtt_link The link.
+ * @param  request The request, copied into the queue.
+ * @param  index Output: the free-running queue index of the request, may be RT_NULL.
+ * @return ISOTP_RET_OK if queued, ISOTP_RET_NOSPACE if the queue is full.
+ */
+static int _isotp_rtt_tx_push(struct isotp_rtt_link *rtt_link, const struct isotp_rtt_tx_req *request, rt_uint32_t *index)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (rtt_link->txq_head - rtt_link->txq_tail >= PKG_ISOTP_C_TX_QUEUE_DEPTH)
+    {
+        rt_hw_interrupt_enable(level);
+        return ISOTP_RET_NOSPACE;
+    }
+    struct isotp_rtt_tx_req *req = &rtt_link->txq[rtt_link->txq_head % PKG_ISOTP_C_TX_QUEUE_DEPTH];
+    *req = *request;
+    req->cancelled = RT_FALSE;
+    if (index)
+        *index = rtt_link->txq_head;
+    rtt_link->txq_head++;
+    rt_hw_interrupt_enable(level);
+
+    _isotp_rtt_tx_kick(rtt_link);
+    return ISOTP_RET_OK;
+}
+
+/**
+ * @brief  Appends a request to a link's transmit queue and starts it if the link is idle.
+ * @param  rtt_link The link.
+ * @param  payload The payload, which must stay valid until the request has started.
+ * @param  size The size of the payload.
+ * @param  cb Completion callback, may be RT_NULL.
+ * @param  cb_arg Argument passed to `cb`.
+ * @param  index Output: the free-running queue index of the request, may be RT_NULL.
+ * @return ISOTP_RET_OK if queued, ISOTP_RET_OVERFLOW if the PDU exceeds the send buffer,
+ *         ISOTP_RET_NOSPACE if the queue is full.
+ */
+static int _isotp_rtt_tx_submit(struct isotp_rtt_link *rtt_link, const uint8_t *payload, uint16_t size,
+                                isotp_rtt_tx_cb_t cb, void *cb_arg, rt_uint32_t *index)
+{
+    struct isotp_rtt_tx_req req;
+
+    if (size > rtt_link->link.send_buf_size)
+        return ISOTP_RET_OVERFLOW;
+
+    rt_memset(&req, 0, sizeof(req));
+    req.payload = payload;
+    req.size = size;
+    req.cb = cb;
+    req.cb_arg = cb_arg;
+    return _isotp_rtt_tx_push(rtt_link, &req, index);
+}
+
+/**
+ * @brief  Withdraws a queued request that has not started yet.
+ * @return RT_TRUE if the request was withdrawn, RT_FALSE if it had already started.
+ */
+static rt_bool_t _isotp_rtt_tx_cancel(struct isotp_rtt_link *rtt_link, rt_uint32_t index)
+{
+    rt_bool_t cancelled = RT_FALSE;
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (!_isotp_rtt_tx_started(rtt_link, index))
+    {
+        rtt_link->txq[index % PKG_ISOTP_C_TX_QUEUE_DEPTH].cancelled = RT_TRUE;
+        cancelled = RT_TRUE;
+    }
+    rt_hw_interrupt_enable(level);
+    return cancelled;
+}
+
+/**
+ * @brief  Reports a failed multi-frame transmission detected after polling or frame handling.
+ * @note   The core only moves the sender to ISOTP_SEND_STATUS_ERROR; this turns that state
+ *         into a completion with the protocol result and starts the next queued request.
+ * @param  rtt_link The link.
+ */
+static void _isotp_rtt_tx_check_error(struct isotp_rtt_link *rtt_link)
+{
+    if (ISOTP_SEND_STATUS_ERROR != rtt_link->link.send_status)
+        return;
+
+    int result = rtt_link->link.send_protocol_result;
+    if (result == ISOTP_PROTOCOL_RESULT_OK)
+        result = ISOTP_PROTOCOL_RESULT_ERROR;
+    rtt_link->link.send_status = ISOTP_SEND_STATUS_IDLE;
+
+    LOG_W("Link[0x%p] transmission failed with protocol result %d.", rtt_link, result);
+    _isotp_rtt_tx_complete(rtt_link, result);
+    _isotp_rtt_tx_kick(rtt_link);
+}
+/** @} */
+
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+/*************************************************************************************************/
+/** @name Internal Gateway
+ *  @{
+ *  @brief Cut-through forwarding between two links. The ingress link streams its receptions into
+ *         the route's FIFO frame by frame, the egress link sends them from there as a streaming
+ *         request started as soon as its first frame is complete, and the ingress flow control
+ *         only grants what the FIFO can hold. FIFO positions are PDU offsets modulo its size.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Copies `len` bytes into the FIFO at PDU offset `offset`.
+ */
+static void _isotp_rtt_route_fifo_put(struct isotp_rtt_route *route, uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    uint32_t pos = offset % route->fifo_size;
+    uint32_t n = route->fifo_size - pos;
+
+    if (n > len)
+        n = len;
+    rt_memcpy(route->fifo + pos, data, n);
+    rt_memcpy(route->fifo, data + n, len - n);
+}
+
+/**
+ * @brief  Copies `len` bytes out of the FIFO from PDU offset `offset`.
+ */
+static void _isotp_rtt_route_fifo_get(const struct isotp_rtt_route *route, uint32_t offset, uint8_t *data, uint32_t len)
+{
+    uint32_t pos = offset % route->fifo_size;
+    uint32_t n = route->fifo_size - pos;
+
+    if (n > len)
+        n = len;
+    rt_memcpy(data, route->fifo + pos, n);
+    rt_memcpy(data + n, route->fifo, len - n);
+}
+
+/**
+ * @brief  Returns the bytes the FIFO must hold before the egress transmission can start: the
+ *         whole PDU if it goes out as a Single Frame, the payload of the First Frame otherwise.
+ */
+static uint32_t _isotp_rtt_route_start_size(const struct isotp_rtt_route *route)
+{
+    uint32_t tx_dl = route->to->link.send_tx_dl;
+
+    if (route->pdu_size <= (tx_dl <= 8 ? 7u : tx_dl - 2u))
+        return route->pdu_size;
+    return route->pdu_size <= 4095 ? tx_dl - 2u : tx_dl - 6u;
+}
+
+/**
+ * @brief  Makes the polling thread of the ingress link ask its flow control policy again for a
+ *         sender held with FC.WAIT, see `isotp_resume_receive`.
+ * @note   The egress side may run in another worker, so it only flags the ingress link and leaves
+ *         its core state to the thread running it.
+ */
+static void _isotp_rtt_route_resume(struct isotp_rtt_route *route)
+{
+    route->held = RT_FALSE;
+    route->from->rx_resume = RT_TRUE;
+    _isotp_rtt_poll_wakeup(route->from);
+}
+
+/**
+ * @brief  Handles a failure of the ingress side.
+ * @note   Once the egress transmission is queued, its source fails the next frame and the
+ *         completion resets the route; a starved transmission is woken up for that.
+ */
+static void _isotp_rtt_route_fail(struct isotp_rtt_route *route)
+{
+    if (route->state != ISOTP_RTT_ROUTE_FWD)
+    {
+        route->state = ISOTP_RTT_ROUTE_IDLE;
+        route->failed++;
+        return;
+    }
+    route->aborted = RT_TRUE;
+    if (route->to->tx_starved)
+    {
+        route->to->tx_starved = RT_FALSE;
+        _isotp_rtt_poll_wakeup(route->to);
+    }
+}
+
+/**
+ * @brief  Payload source of an egress transmission, reading the FIFO.
+ * @note   A consecutive frame whose payload has not been received yet is held back with
+ *         ISOTP_RET_NO_DATA; `tx_starved` keeps the polling thread from spinning on it until
+ *         `_isotp_rtt_route_pull` delivers the payload. Runs in the polling thread, or in the
+ *         thread starting the request for the first frame.
+ */
+static int _isotp_rtt_route_source(void *link, uint32_t offset, uint8_t *data, uint8_t size, void *arg)
+{
+    struct isotp_rtt_route *route = (struct isotp_rtt_route *)arg;
+
+    (void)link;
+    if (route->aborted)
+        return ISOTP_RET_ERROR;
+
+    /* Everything before the committed send offset has been sent and will not be asked for again. */
+    route->released = route->to->link.send_offset;
+
+    /* An ingress sender held with FC.WAIT goes on once half of the FIFO, and at least a frame, is free again. */
+    if (route->held && route->copied < route->pdu_size)
+    {
+        uint32_t free = route->fifo_size - (route->copied - route->released);
+        if (free >= route->fifo_size / 2 && free >= route->in_frame)
+            _isotp_rtt_route_resume(route);
+    }
+
+    if (offset + size > route->copied)
+    {
+        /* Flag first, then check again: the producer clears the flag after publishing new data. */
+        route->to->tx_starved = RT_TRUE;
+        if (offset + size > route->copied)
+            return ISOTP_RET_NO_DATA;
+        route->to->tx_starved = RT_FALSE;
+    }
+    _isotp_rtt_route_fifo_get(route, offset, data, size);
+    return ISOTP_RET_OK;
+}
+
+/**
+ * @brief  Completion of an egress transmission, resets the route for the next PDU.
+ */
+static void _isotp_rtt_route_tx_done(isotp_rtt_link_t link, int result, void *arg)
+{
+    struct isotp_rtt_route *route = (struct isotp_rtt_route *)arg;
+
+    link->tx_starved = RT_FALSE;
+    if (result == ISOTP_PROTOCOL_RESULT_OK)
+    {
+        route->forwarded++;
+    }
+    else
+    {
+        route->failed++;
+        LOG_W("Route[0x%p] egress transmission failed with protocol result %d.", route, result);
+    }
+
+    /* If the ingress link is still receiving the failed PDU, the rest of it is refused. */
+    if (result != ISOTP_PROTOCOL_RESULT_OK && !route->aborted && route->copied < route->pdu_size)
+        route->state = ISOTP_RTT_ROUTE_DROP;
+    else
+        route->state = ISOTP_RTT_ROUTE_IDLE;
+    route->aborted = RT_FALSE;
+
+    /* A First Frame held with FC.WAIT while this PDU was sent can now be admitted. */
+    if (route->state == ISOTP_RTT_ROUTE_IDLE && route->held)
+        _isotp_rtt_route_resume(route);
+}
+
+/**
+ * @brief  Queues the egress transmission of the PDU being forwarded.
+ */
+static void _isotp_rtt_route_start(struct isotp_rtt_route *route)
+{
+    struct isotp_rtt_tx_req req;
+
+    rt_memset(&req, 0, sizeof(req));
+    req.source = _isotp_rtt_route_source;
+    req.source_arg = route;
+    req.stream_size = route->pdu_size;
+    req.cb = _isotp_rtt_route_tx_done;
+    req.cb_arg = route;
+
+    /* A Single Frame completes inside the push, so the state must be set before. */
+    route->state = ISOTP_RTT_ROUTE_FWD;
+    if (_isotp_rtt_tx_push(route->to, &req, RT_NULL) != ISOTP_RET_OK)
+    {
+        LOG_W("Route[0x%p] egress queue is full, PDU dropped.", route);
+        route->failed++;
+        route->state = route->copied < route->pdu_size ? ISOTP_RTT_ROUTE_DROP : ISOTP_RTT_ROUTE_IDLE;
+    }
+}
+
+/**
+ * @brief  Moves the payload the ingress link has received since the last call into the FIFO,
+ *         and queues the egress transmission once its first frame is complete.
+ * @note   Called after every frame handled by the ingress link and from its sink, which runs
+ *         before the core reuses a full staging buffer. Since the last chunk handed to the sink,
+ *         the staged bytes are contiguous in the receive buffer.
+ * @return ISOTP_RET_OK, or ISOTP_RET_OVERFLOW if the ingress sender overran the FIFO.
+ */
+static int _isotp_rtt_route_pull(struct isotp_rtt_route *route)
+{
+    IsoTpLink *in = &route->from->link;
+    uint32_t copied = route->copied;
+    uint32_t end;
+
+    if ((route->state != ISOTP_RTT_ROUTE_RX && route->state != ISOTP_RTT_ROUTE_FWD) || route->aborted || copied >= route->pdu_size)
+        return ISOTP_RET_OK;
+
+    end = in->receive_offset < route->pdu_size ? in->receive_offset : route->pdu_size;
+    if (end > copied)
+    {
+        if (end - route->released > route->fifo_size)
+        {
+            LOG_W("Route[0x%p] ingress sender overran the FIFO.", route);
+            _isotp_rtt_route_fail(route);
+            return ISOTP_RET_OVERFLOW;
+        }
+        _isotp_rtt_route_fifo_put(route, copied, in->receive_buffer + copied % in->receive_buf_size, end - copied);
+        route->copied = end;
+        if (route->to->tx_starved)
+        {
+            route->to->tx_starved = RT_FALSE;
+            _isotp_rtt_poll_wakeup(route->to);
+        }
+    }
+
+    if (route->state == ISOTP_RTT_ROUTE_RX && route->copied >= _isotp_rtt_route_start_size(route))
+        _isotp_rtt_route_start(route);
+    return ISOTP_RET_OK;
+}
+
+/**
+ * @brief  Sink of the ingress link, see `_isotp_rtt_route_pull`.
+ * @note   Chunks of a PDU that was not admitted are refused, which aborts its reception.
+ */
+static int _isotp_rtt_route_sink(void *link, uint32_t offset, const uint8_t *data, uint32_t size, uint32_t total_size, void *arg)
+{
+    struct isotp_rtt_route *route = (struct isotp_rtt_route *)arg;
+    rt_bool_t admitted = (route->state == ISOTP_RTT_ROUTE_RX || route->state == ISOTP_RTT_ROUTE_FWD) && !route->aborted &&
+                         route->copied < route->pdu_size;
+
+    (void)link;
+    (void)offset;
+    (void)size;
+    (void)total_size;
+
+    if (!data)
+    {
+        /* The reception was aborted; it only matters if it is the PDU being forwarded. */
+        if (admitted)
+            _isotp_rtt_route_fail(route);
+        else if (route->state == ISOTP_RTT_ROUTE_DROP)
+            route->state = ISOTP_RTT_ROUTE_IDLE;
+        return ISOTP_RET_OK;
+    }
+    if (route->state == ISOTP_RTT_ROUTE_DROP)
+        return ISOTP_RET_ERROR;
+    if (!admitted)
+        return ISOTP_RET_OVERFLOW;
+    return _isotp_rtt_route_pull(route);
+}
+
+/**
+ * @brief  Flow control policy of the ingress link, applied on top of the policy it had before.
+ * @note   The flow control of a First Frame admits the PDU, or holds the sender with FC.WAIT
+ *         while the previous PDU is still being sent. Later ones grant a block that fits the
+ *         free part of the FIFO, or make the sender wait until the egress side has caught up.
+ *         A WAIT also sets a block size of one, so that the CONTINUE the core forces after
+ *         `max_wft_number` waits only lets one frame in. `held` and `in_frame` publish what the
+ *         egress side needs to resume the sender, it does not read the ingress core state.
+ */
+static uint8_t _isotp_rtt_route_fc_policy(void *link, uint8_t *block_size, uint32_t *st_min_us, void *arg)
+{
+    struct isotp_rtt_route *route = (struct isotp_rtt_route *)arg;
+    IsoTpLink *in = &route->from->link;
+    uint32_t frame = in->receive_rx_dl - 1u;
+    uint32_t used, frames;
+    uint8_t flow_status = PCI_FLOW_STATUS_CONTINUE;
+
+    if (route->fc_policy)
+        flow_status = route->fc_policy(link, block_size, st_min_us, route->fc_policy_arg);
+    route->in_frame = (rt_uint8_t)frame;
+    route->held = RT_FALSE;
+
+    /* Only the First Frame has been received: no consecutive frame payload yet. */
+    if (in->receive_sn == 1 && in->receive_offset <= in->receive_rx_dl - 2u)
+    {
+        if (route->state != ISOTP_RTT_ROUTE_IDLE || flow_status == PCI_FLOW_STATUS_WAIT)
+        {
+            *block_size = 1;
+            route->held = RT_TRUE;
+            return PCI_FLOW_STATUS_WAIT;
+        }
+        route->pdu_size = in->receive_size;
+        route->copied = 0;
+        route->released = 0;
+        route->aborted = RT_FALSE;
+        route->state = ISOTP_RTT_ROUTE_RX;
+    }
+    if ((route->state != ISOTP_RTT_ROUTE_RX && route->state != ISOTP_RTT_ROUTE_FWD) || route->aborted)
+        return flow_status;
+
+    used = in->receive_offset - route->released;
+    frames = used < route->fifo_size ? (route->fifo_size - used) / frame : 0;
+    if (frames == 0 || flow_status == PCI_FLOW_STATUS_WAIT)
+    {
+        *block_size = 1;
+        route->held = RT_TRUE;
+        return PCI_FLOW_STATUS_WAIT;
+    }
+    /* The configured block size stays if the rest of the PDU fits anyway. */
+    if ((in->receive_size - in->receive_offset + frame - 1) / frame > frames && (*block_size == 0 || *block_size > frames))
+        *block_size = frames > 0xFF ? 0xFF : (uint8_t)frames;
+    return PCI_FLOW_STATUS_CONTINUE;
+}
+
+/**
+ * @brief  Forwards a Single Frame received on the ingress link.
+ */
+static void _isotp_rtt_route_single(struct isotp_rtt_route *route, const uint8_t *data, uint32_t size)
+{
+    if (route->state != ISOTP_RTT_ROUTE_IDLE)
+    {
+        route->dropped++;
+        LOG_W("Route[0x%p] is busy, dropped a %d byte Single Frame.", route, size);
+        return;
+    }
+    route->pdu_size = size;
+    route->released = 0;
+    route->aborted = RT_FALSE;
+    _isotp_rtt_route_fifo_put(route, 0, data, size);
+    route->copied = size;
+    _isotp_rtt_route_start(route);
+}
+/** @} */
+#endif /* PKG_ISOTP_C_USING_GATEWAY */
+
+
+/*************************************************************************************************/
+/** @name Internal Transactions
+ *  @{
+ *  @brief A transaction owns the link's receptions from the moment it is started, so its response
+ *         is taken over in `_isotp_rtt_rx_done_cb` however early it arrives. The completion is
+ *         claimed under interrupt lock by whichever of the response, the request failure or the
+ *         timeout in the polling thread comes first.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Takes the transaction in progress off the link.
+ * @return The transaction, now owned by the caller, or RT_NULL if none is in progress.
+ */
+static struct isotp_rtt_txn *_isotp_rtt_txn_claim(struct isotp_rtt_link *rtt_link)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    struct isotp_rtt_txn *txn = rtt_link->txn;
+    rtt_link->txn = RT_NULL;
+    rtt_link->txn_state = ISOTP_RTT_TXN_IDLE;
+    rt_hw_interrupt_enable(level);
+    return txn;
+}
+
+/**
+ * @brief  Reports the outcome of a claimed transaction.
+ */
+static void _isotp_rtt_txn_finish(struct isotp_rtt_link *rtt_link, struct isotp_rtt_txn *txn, rt_err_t result)
+{
+    txn->result = result;
+    txn->elapsed_us = isotp_user_get_us() - rtt_link->txn_start_us;
+    if (txn->cb)
+        txn->cb(rtt_link, txn, txn->cb_arg);
+}
+
+/**
+ * @brief  Completion of a transaction's request: starts the P2 timer, or fails the transaction.
+ */
+static void _isotp_rtt_txn_tx_cb(isotp_rtt_link_t link, int result, void *arg)
+{
+    struct isotp_rtt_txn *txn = (struct isotp_rtt_txn *)arg;
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    /* The response may already have completed the transaction. */
+    if (link->txn != txn)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    if (result == ISOTP_PROTOCOL_RESULT_OK)
+    {
+        /* A response pending NRC that arrived first has already set a P2* deadline. */
+        if (link->txn_state == ISOTP_RTT_TXN_SEND)
+        {
+            link->txn_deadline_us = isotp_user_get_us() + txn->p2_us;
+            link->txn_state = ISOTP_RTT_TXN_WAIT;
+        }
+        rt_hw_interrupt_enable(level);
+        _isotp_rtt_poll_wakeup(link);
+        return;
+    }
+    rt_hw_interrupt_enable(level);
+
+    LOG_W("Link[0x%p] transaction request failed with protocol result %d.", link, result);
+    txn = _isotp_rtt_txn_claim(link);
+    if (txn)
+        _isotp_rtt_txn_finish(link, txn, -RT_ERROR);
+}
+
+/**
+ * @brief  Hands a received PDU to the transaction in progress.
+ * @note   A response pending NRC for the request's service only extends the deadline by P2*.
+ * @return RT_TRUE if the PDU was taken by a transaction.
+ */
+static rt_bool_t _isotp_rtt_txn_response(struct isotp_rtt_link *rtt_link, const uint8_t *data, uint16_t size, rt_bool_t truncated)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    struct isotp_rtt_txn *txn = rtt_link->txn;
+
+    if (!txn)
+    {
+        rt_hw_interrupt_enable(level);
+        return RT_FALSE;
+    }
+    if (txn->p2_ext_us && size >= 3 && data[0] == 0x7F && data[1] == txn->request[0] && data[2] == UDS_NRC_RESPONSE_PENDING)
+    {
+        txn->pending++;
+        rtt_link->txn_deadline_us = isotp_user_get_us() + txn->p2_ext_us;
+        rtt_link->txn_state = ISOTP_RTT_TXN_WAIT;
+        rt_hw_interrupt_enable(level);
+        _isotp_rtt_poll_wakeup(rtt_link);
+        return RT_TRUE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    txn = _isotp_rtt_txn_claim(rtt_link);
+    if (!txn)
+        return RT_FALSE;
+    if (size > txn->response_buf_size)
+    {
+        LOG_E("Transaction response buffer is too small! Required: %d, Provided: %d", size, txn->response_buf_size);
+        txn->response_size = 0;
+        _isotp_rtt_txn_finish(rtt_link, txn, -RT_ENOMEM);
+        return RT_TRUE;
+    }
+    rt_memcpy(txn->response, data, size);
+    txn->response_size = size;
+    _isotp_rtt_txn_finish(rtt_link, txn, truncated ? -RT_EFULL : RT_EOK);
+    return RT_TRUE;
+}
+
+/**
+ * @brief  Fails the transaction of a link whose response is overdue; called by the polling thread.
+ * @note   Once a segmented response has started, its reception is left to the N_Cr timeout.
+ */
+static void _isotp_rtt_txn_check_timeout(struct isotp_rtt_link *rtt_link, uint32_t now)
+{
+    struct isotp_rtt_txn *txn;
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if (rtt_link->txn_state != ISOTP_RTT_TXN_WAIT || ISOTP_RECEIVE_STATUS_INPROGRESS == rtt_link->link.receive_status ||
+        !IsoTpTimeAfter(now, rtt_link->txn_deadline_us))
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    txn = rtt_link->txn;
+    rtt_link->txn = RT_NULL;
+    rtt_link->txn_state = ISOTP_RTT_TXN_IDLE;
+    rt_hw_interrupt_enable(level);
+
+    LOG_W("Link[0x%p] transaction timed out after %d response pending NRCs.", rtt_link, txn->pending);
+    _isotp_rtt_txn_finish(rtt_link, txn, -RT_ETIMEOUT);
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Internal Event Callbacks
+ *  @{
+ *  @brief These static functions are called by the isotp-c library upon completion of
+ *         asynchronous operations. Their primary role is to signal waiting threads.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Called by isotp-c when a complete PDU has been transmitted successfully.
+ * @note   It reports the completion of the request in progress and directly starts the next
+ *         queued one, so back-to-back PDUs go out without a round-trip through the caller.
+ * @param  link_ptr A pointer to the core IsoTpLink instance.
+ * @param  size The size of the PDU that was sent.
+ * @param  user_arg The user argument, which points to our isotp_rtt_link struct.
+ */
+static void _isotp_rtt_tx_done_cb(void *link_ptr, uint32_t size, void *user_arg);
+
+/**
+ * @brief  Called by isotp-c when a link starts a segmented transmission or reception.
+ * @note   Puts the link on the active list of its polling thread, which needs to run its timers now.
+ * @param  link_ptr A pointer to the core IsoTpLink instance.
+ * @param  user_arg The user argument, which points to our isotp_rtt_link struct.
+ */
+static void _isotp_rtt_active_cb(void *link_ptr, void *user_arg)
+{
+    _isotp_rtt_poll_wakeup((struct isotp_rtt_link *)user_arg);
+}
+
+static void _isotp_rtt_tx_done_cb(void *link_ptr, uint32_t size, void *user_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
+    _isotp_rtt_tx_complete(rtt_link, ISOTP_PROTOCOL_RESULT_OK);
+    _isotp_rtt_tx_kick(rtt_link);
+}
+
+/**
+ * @brief  Completion callback used by the blocking `isotp_rtt_send` to wake the waiting thread.
+ * @note   `arg` is the sequence number of the request. The completion of a request whose sender
+ *         has timed out and returned is ignored, so it cannot wake a later call instead.
+ */
+static void _isotp_rtt_blocking_tx_cb(isotp_rtt_link_t rtt_link, int result, void *arg)
+{
+    rt_enter_critical();
+    if ((rt_uint32_t)(rt_ubase_t)arg == rtt_link->tx_wait_seq)
+    {
+        rtt_link->tx_result = result;
+        rt_event_send(&rtt_link->event, result == ISOTP_PROTOCOL_RESULT_OK ? EVENT_FLAG_TX_DONE : EVENT_FLAG_TX_ERROR);
+    }
+    rt_exit_critical();
+}
+
+/**
+ * @brief  Starts waiting for a blocking send, called with the send mutex held.
+ * @return The sequence number to pass as `cb_arg` of `_isotp_rtt_blocking_tx_cb`.
+ */
+static rt_uint32_t _isotp_rtt_blocking_tx_begin(struct isotp_rtt_link *rtt_link)
+{
+    rt_uint32_t recved_evt;
+
+    /* Clear stale TX events before starting a new operation; RX_DONE belongs to the receiver. */
+    rt_event_recv(&rtt_link->event, EVENT_FLAGS_TX, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, 0, &recved_evt);
+    if (++rtt_link->tx_seq == 0)
+        rtt_link->tx_seq = 1;
+    rtt_link->tx_wait_seq = rtt_link->tx_seq;
+    return rtt_link->tx_seq;
+}
+
+/**
+ * @brief  Stops waiting for a blocking send, a later completion of its request is ignored.
+ */
+static void _isotp_rtt_blocking_tx_end(struct isotp_rtt_link *rtt_link)
+{
+    rt_enter_critical();
+    rtt_link->tx_wait_seq = 0;
+    rt_exit_critical();
+}
+
+/**
+ * @brief  Completion callback used by the blocking `isotp_rtt_transact` to wake the waiting thread.
+ */
+static void _isotp_rtt_blocking_txn_cb(isotp_rtt_link_t rtt_link, struct isotp_rtt_txn *txn, void *arg)
+{
+    rt_event_send(&rtt_link->event, EVENT_FLAG_TXN_DONE);
+}
+
+/**
+ * @brief  Returns the RX queue slab entry for a free-running queue index.
+ */
+rt_inline struct isotp_rtt_rx_entry *_isotp_rtt_rxq_entry(struct isotp_rtt_link *rtt_link, rt_uint32_t index)
+{
+    return (struct isotp_rtt_rx_entry *)(rtt_link->rxq_slab + (index % rtt_link->rxq_depth) * rtt_link->rxq_entry_size);
+}
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+/**
+ * @brief  Sink the core calls for every chunk of a streamed reception; forwards to the link's `rx_sink`.
+ * @note   The last chunk completes the PDU, so it is accounted like `_isotp_rtt_rx_done_cb` does.
+ */
+static int _isotp_rtt_rx_sink(void *link_ptr, uint32_t offset, const uint8_t *data, uint32_t size, uint32_t total_size, void *user_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
+    isotp_rx_sink_cb sink = rtt_link->rx_sink;
+    int ret;
+
+    (void)link_ptr;
+    if (!sink)
+        return ISOTP_RET_ERROR;
+
+    ret = sink(rtt_link, offset, data, size, total_size, rtt_link->rx_sink_arg);
+    if (ret == ISOTP_RET_OK && data && offset + size == total_size)
+    {
+        ISOTP_RTT_STAT_INC(rtt_link, rx_pdus);
+        ISOTP_RTT_STAT_ADD(rtt_link, rx_bytes, total_size);
+#ifdef PKG_ISOTP_C_USING_STATS
+        if (rtt_link->stats_flags & ISOTP_RTT_STATS_RX_TIMING)
+        {
+            _isotp_rtt_stats_hist_add(rtt_link->stats.rx_time_hist, isotp_user_get_us() - rtt_link->rx_start_us);
+            rtt_link->stats_flags &= ~ISOTP_RTT_STATS_RX_TIMING;
+        }
+#endif
+    }
+    return ret;
+}
+#endif
+
+/**
+ * @brief  Called by isotp-c when a complete PDU has been received and assembled.
+ * @note   Without an RX queue, this function only needs to record the final size and post an
+ *         event to unblock any thread waiting in `isotp_rtt_receive`; the PDU stays in the core's
+ *         receive buffer. With an RX queue, the PDU is copied into the next free slab entry
+ *         so that the core can start assembling the next one straight away.
+ * @param  link_ptr A pointer to the core IsoTpLink instance.
+ * @param  data Pointer to the start of the received data.
+ * @param  size The size of the fully assembled PDU.
+ * @param  user_arg The user argument, which points to our isotp_rtt_link struct.
+ */
+static void _isotp_rtt_rx_done_cb(void *link_ptr, const uint8_t *data, uint32_t size, void *user_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
+
+    uint16_t final_size = size;
+    rt_bool_t truncated = RT_FALSE;
+
+    ISOTP_RTT_STAT_INC(rtt_link, rx_pdus);
+    ISOTP_RTT_STAT_ADD(rtt_link, rx_bytes, size);
+#ifdef PKG_ISOTP_C_USING_STATS
+    if (rtt_link->stats_flags & ISOTP_RTT_STATS_RX_TIMING)
+    {
+        _isotp_rtt_stats_hist_add(rtt_link->stats.rx_time_hist, isotp_user_get_us() - rtt_link->rx_start_us);
+        rtt_link->stats_flags &= ~ISOTP_RTT_STATS_RX_TIMING;
+    }
+#endif
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    /* Segmented PDUs of a routed link are streamed, only Single Frames complete here. */
+    if (rtt_link->route)
+    {
+        _isotp_rtt_route_single(rtt_link->route, data, size);
+        return;
+    }
+#endif
+
+    if (size > rtt_link->rx_buf_size)
+    {
+        final_size = rtt_link->rx_buf_size;
+        truncated = RT_TRUE;
+        ISOTP_RTT_STAT_INC(rtt_link, rx_truncated);
+        LOG_W("RX buffer truncated! Link[0x%p] received %d bytes, but buffer size is %d.", rtt_link, size, rtt_link->rx_buf_size);
+    }
+
+    if (rtt_link->txn && _isotp_rtt_txn_response(rtt_link, data, final_size, truncated))
+        return;
+
+    if (rtt_link->rxq_slab)
+    {
+        rt_uint32_t head = rtt_link->rxq_head;
+        if (head - rtt_link->rxq_tail >= rtt_link->rxq_depth)
+        {
+            rtt_link->rx_dropped++;
+            ISOTP_RTT_STAT_INC(rtt_link, rx_dropped);
+            LOG_W("RX queue full! Link[0x%p] dropped a %d byte PDU.", rtt_link, size);
+            return;
+        }
+
+        struct isotp_rtt_rx_entry *entry = _isotp_rtt_rxq_entry(rtt_link, head);
+        entry->size = final_size;
+        entry->truncated = truncated;
+        rt_memcpy(entry + 1, data, final_size);
+        rtt_link->rxq_head = head + 1;
+    }
+    else
+    {
+        rtt_link->rx_truncated = truncated;
+        rtt_link->rx_actual_size = final_size;
+    }
+    rt_event_send(&rtt_link->event, EVENT_FLAG_RX_DONE);
+}
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Internal Polling Thread
+ *  @{
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Puts a link on the active list of its polling thread and wakes the thread up, so that
+ *         it recomputes its next deadline.
+ * @note   The thread takes the link off again once `_isotp_rtt_link_deadline` reports it idle.
+ *         Both sides update the list with interrupts disabled, and the thread re-checks the
+ *         deadline there, so a link that becomes busy while it is being removed is re-added.
+ * @param  rtt_link The link, or RT_NULL to only wake up the single polling thread (from the pacing timer).
+ */
+static void _isotp_rtt_poll_wakeup(struct isotp_rtt_link *rtt_link)
+{
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    rt_list_t *active = &rtt_link->worker->active;
+    rt_event_t event = &rtt_link->worker->event;
+#else
+    rt_list_t *active = &g_active_list;
+    rt_event_t event = &g_poll_event;
+#endif
+
+    if (rtt_link)
+    {
+        rt_base_t level = rt_hw_interrupt_disable();
+        if (rt_list_isempty(&rtt_link->active_node))
+            rt_list_insert_before(active, &rtt_link->active_node);
+        rt_hw_interrupt_enable(level);
+    }
+    rt_event_send(event, POLL_EVENT_WAKEUP);
+}
+
+/**
+ * @brief  Computes how long a link can be left alone before `isotp_poll()` has work to do.
+ * @note   The due time is derived from the same timers that `isotp_poll()` checks:
+ *         `send_timer_st` for the next consecutive frame (only while block-size credit is left),
+ *         `send_timer_bs` for the Flow Control timeout and `receive_timer_cr` for the
+ *         consecutive frame timeout, plus the response deadline of a transaction.
+ * @param  rtt_link The link.
+ * @param  now The current timestamp in microseconds.
+ * @param  remaining_us Output: microseconds until the earliest deadline, 0 if it is already due.
+ * @return RT_TRUE if the link has a pending deadline, RT_FALSE if it is idle.
+ */
+static rt_bool_t _isotp_rtt_link_deadline(const struct isotp_rtt_link *rtt_link, uint32_t now, uint32_t *remaining_us)
+{
+    const IsoTpLink *link = &rtt_link->link;
+    rt_bool_t has_deadline = RT_FALSE;
+    uint32_t timers[5];
+    int count = 0;
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    /* A route freed FIFO space for the sender its flow control holds with FC.WAIT. */
+    if (rtt_link->rx_resume)
+    {
+        *remaining_us = 0;
+        return RT_TRUE;
+    }
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    /* A request or flow control frame that found the TX ring full, once the TX thread made room. */
+    if (_isotp_rtt_tx_ring_retry_due(rtt_link) ||
+        (!rtt_link->tx_stalled && link->receive_fc_pending && ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status))
+    {
+        *remaining_us = 0;
+        return RT_TRUE;
+    }
+#endif
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status)
+    {
+        if ((ISOTP_INVALID_BS == link->send_bs_remain || link->send_bs_remain > 0)
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+            /* A route egress waiting for its payload is woken up when the payload arrives. */
+            && !rtt_link->tx_starved
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+            /* A link that found the TX ring full is woken up by the TX thread. */
+            && !rtt_link->tx_stalled
+#endif
+        )
+        {
+            if (0 == link->send_st_min_us)
+            {
+                *remaining_us = 0;
+                return RT_TRUE;
+            }
+            timers[count++] = link->send_timer_st;
+        }
+        timers[count++] = link->send_timer_bs;
+    }
+
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status && link->receive_timer_cr > 0)
+    {
+        timers[count++] = link->receive_timer_cr;
+        if (link->receive_fc_wait)
+            timers[count++] = link->receive_timer_wait;
+    }
+
+    /* A transaction waiting for its response, see `_isotp_rtt_txn_check_timeout`. */
+    if (ISOTP_RTT_TXN_WAIT == rtt_link->txn_state && ISOTP_RECEIVE_STATUS_INPROGRESS != link->receive_status)
+        timers[count++] = rtt_link->txn_deadline_us;
+
+    for (int i = 0; i < count; i++)
+    {
+        /* isotp_poll() fires a timer once 'now' is strictly after it. */
+        uint32_t remaining = IsoTpTimeAfter(now, timers[i]) ? 0 : (timers[i] - now + 1);
+        if (!has_deadline || remaining < *remaining_us)
+        {
+            *remaining_us = remaining;
+            has_deadline = RT_TRUE;
+        }
+    }
+
+    return has_deadline;
+}
+
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+/**
+ * @brief  hwtimer timeout callback, runs in interrupt context.
+ * @note   Only wakes the polling thread: the CAN device write and the link state machines are
+ *         not interrupt-safe, so the consecutive frame itself is sent from the thread.
+ */
+static rt_err_t _isotp_rtt_pace_timeout(rt_device_t dev, rt_size_t size)
+{
+    _isotp_rtt_poll_wakeup(RT_NULL);
+    return RT_EOK;
+}
+
+/**
+ * @brief  Opens and configures the pacing hwtimer as a 1 MHz one-shot timer.
+ */
+static void _isotp_rtt_pace_timer_init(void)
+{
+    rt_device_t dev = rt_device_find(PKG_ISOTP_C_HWTIMER_DEVICE_NAME);
+    rt_uint32_t freq = 1000000;
+    rt_hwtimer_mode_t mode = HWTIMER_MODE_ONESHOT;
+
+    if (!dev || rt_device_open(dev, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+    {
+        LOG_W("hwtimer '%s' not available, STmin pacing falls back to OS ticks.", PKG_ISOTP_C_HWTIMER_DEVICE_NAME);
+        return;
+    }
+    rt_device_set_rx_indicate(dev, _isotp_rtt_pace_timeout);
+    /* Not every driver supports 1 MHz, the timer then runs at its default frequency. */
+    rt_device_control(dev, HWTIMER_CTRL_FREQ_SET, &freq);
+    if (rt_device_control(dev, HWTIMER_CTRL_MODE_SET, &mode) != RT_EOK)
+    {
+        LOG_W("hwtimer '%s' does not support one-shot mode.", PKG_ISOTP_C_HWTIMER_DEVICE_NAME);
+        rt_device_close(dev);
+        return;
+    }
+    g_pace_timer = dev;
+}
+
+/**
+ * @brief  Arms the pacing hwtimer to fire in `us` microseconds.
+ * @note   Re-arming restarts the timer, so only the latest deadline is kept. A stale expiry
+ *         merely causes one spurious wake-up of the polling thread.
+ */
+static void _isotp_rtt_pace_timer_arm(uint32_t us)
+{
+    rt_hwtimerval_t tv;
+    tv.sec = us / 1000000;
+    tv.usec = us % 1000000;
+    rt_device_write(g_pace_timer, 0, &tv, sizeof(tv));
+}
+#endif
+
+/**
+ * @brief  Converts a microsecond delay to a tick timeout for the polling thread.
+ * @note   The result is rounded up so that the thread never wakes before the deadline.
+ */
+static rt_int32_t _isotp_rtt_us_to_tick(uint32_t us)
+{
+    if (us == 0)
+        return 0;
+    return (rt_int32_t)(((rt_uint64_t)us * RT_TICK_PER_SECOND + 999999) / 1000000);
+}
+
+/**
+ * @brief  The entry point for the background polling thread.
+ * @note   This thread is crucial. It calls `isotp_poll_with_time()` for every active link, which
+ *         is responsible for handling all time-dependent aspects of the protocol, such as
+ *         message timeouts and separation time delays (STmin).
+ *         Only the links on the active list are visited, and the clock is read once per pass,
+ *         so a pass costs in proportion to the transfers in flight, not to the registered links.
+ *         Instead of waking up at a fixed interval, the thread sleeps until the earliest
+ *         deadline of those links, or until new work is signalled via `g_poll_event`.
+ *         When no transfer is in progress, it blocks forever and costs no CPU time.
+ *         With PKG_ISOTP_C_USING_DEVICE_WORKERS, every CAN device runs its own instance over
+ *         its own active list and event, which also dispatches the frames of the device's RX port.
+ * @param  parameter The `struct isotp_rtt_worker` with PKG_ISOTP_C_USING_DEVICE_WORKERS, unused otherwise.
+ */
+static void _poll_thread_entry(void *parameter)
+{
+    struct isotp_rtt_link *rtt_link, *next_rtt_link;
+    rt_uint32_t recved_evt;
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    struct isotp_rtt_worker *worker = (struct isotp_rtt_worker *)parameter;
+    rt_list_t *active = &worker->active;
+    rt_event_t event = &worker->event;
+#else
+    rt_list_t *active = &g_active_list;
+    rt_event_t event = &g_poll_event;
+#endif
+
+    while (1)
+    {
+        rt_bool_t has_deadline = RT_FALSE;
+        rt_bool_t rx_pending = RT_FALSE;
+        uint32_t next_due = 0;
+        uint32_t next_us = 0;
+        uint32_t remaining_us;
+        uint32_t now;
+
+#if defined(PKG_ISOTP_C_USING_DEVICE_WORKERS) && defined(PKG_ISOTP_C_USING_RX_DISPATCHER)
+        /* One batch of received frames per pass, so that a flooded bus cannot starve the timers. */
+        struct isotp_rtt_port *port = worker->port;
+        if (port && _isotp_rtt_port_drain(port))
+            rx_pending = RT_TRUE;
+#endif
+
+        now = isotp_user_get_us();
+        rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+        rt_list_for_each_entry_safe(rtt_link, next_rtt_link, active, active_node)
+        {
+            rt_base_t level;
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+            if (rtt_link->rx_resume)
+            {
+                rtt_link->rx_resume = RT_FALSE;
+                isotp_resume_receive(&rtt_link->link);
+            }
+#endif
+#ifdef PKG_ISOTP_C_USING_STATS
+            uint8_t old_receive_status = rtt_link->link.receive_status;
+            isotp_poll_with_time(&rtt_link->link, now);
+            if (old_receive_status == ISOTP_RECEIVE_STATUS_INPROGRESS && rtt_link->link.receive_status == ISOTP_RECEIVE_STATUS_IDLE &&
+                rtt_link->link.receive_protocol_result == ISOTP_PROTOCOL_RESULT_TIMEOUT_CR)
+            {
+                ISOTP_RTT_STAT_INC(rtt_link, rx_timeout_cr);
+            }
+#else
+            isotp_poll_with_time(&rtt_link->link, now);
+#endif
+#ifdef PKG_ISOTP_C_USING_TRACE
+            _isotp_rtt_trace_state(rtt_link);
+#endif
+            _isotp_rtt_tx_check_error(rtt_link);
+#ifdef PKG_ISOTP_C_USING_TX_RING
+            if (_isotp_rtt_tx_ring_retry_due(rtt_link))
+                _isotp_rtt_tx_kick(rtt_link);
+#endif
+            _isotp_rtt_txn_check_timeout(rtt_link, now);
+
+            /* Deadlines are kept as absolute times, so a pass that takes long does not delay them. */
+            level = rt_hw_interrupt_disable();
+            if (_isotp_rtt_link_deadline(rtt_link, now, &remaining_us))
+            {
+                if (!has_deadline || IsoTpTimeAfter(next_due, now + remaining_us))
+                {
+                    next_due = now + remaining_us;
+                    has_deadline = RT_TRUE;
+                }
+            }
+            else
+            {
+                rt_list_remove(&rtt_link->active_node);
+            }
+            rt_hw_interrupt_enable(level);
+        }
+        rt_mutex_release(&g_link_lock);
+
+        if (has_deadline)
+        {
+            now = isotp_user_get_us();
+            next_us = IsoTpTimeAfter(next_due, now) ? next_due - now : 0;
+        }
+        if (rx_pending)
+        {
+            next_us = 0;
+            has_deadline = RT_TRUE;
+        }
+
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+        /* Near deadlines are hit with the hwtimer, the tick timeout below only backs it up. */
+        if (has_deadline && g_pace_timer && next_us > 0 && next_us <= PKG_ISOTP_C_HWTIMER_MAX_US)
+            _isotp_rtt_pace_timer_arm(next_us);
+#endif
+
+        rt_event_recv(event, POLL_EVENT_WAKEUP | POLL_EVENT_RX, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                      has_deadline ? _isotp_rtt_us_to_tick(next_us) : RT_WAITING_FOREVER, &recved_evt);
+    }
+}
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief  Returns the worker of a CAN device, starting it on first use.
+ * @return The worker, or RT_NULL if all PKG_ISOTP_C_MAX_WORKERS are in use or its thread could not be created.
+ */
+static struct isotp_rtt_worker *_isotp_rtt_worker_get(rt_device_t can_dev)
+{
+    struct isotp_rtt_worker *worker = RT_NULL;
+    char name[RT_NAME_MAX];
+
+    for (int i = 0; i < PKG_ISOTP_C_MAX_WORKERS; i++)
+    {
+        if (g_workers[i].can_dev == can_dev)
+            return &g_workers[i];
+        if (!worker && !g_workers[i].can_dev)
+            worker = &g_workers[i];
+    }
+    if (!worker)
+    {
+        LOG_E("No free worker for device:%s, raise PKG_ISOTP_C_MAX_WORKERS.", can_dev->parent.name);
+        return RT_NULL;
+    }
+
+    rt_snprintf(name, RT_NAME_MAX, "isotp_w%d", (int)(worker - g_workers));
+    rt_list_init(&worker->active);
+    rt_event_init(&worker->event, name, RT_IPC_FLAG_FIFO);
+    worker->thread = rt_thread_create(name, _poll_thread_entry, worker, PKG_ISOTP_C_WORKER_STACK_SIZE, PKG_ISOTP_C_WORKER_PRIORITY, 10);
+    if (!worker->thread)
+    {
+        rt_event_detach(&worker->event);
+        LOG_E("Failed to create the worker thread of device:%s.", can_dev->parent.name);
+        return RT_NULL;
+    }
+    worker->can_dev = can_dev;
+    rt_thread_startup(worker->thread);
+
+    LOG_I("Worker %s started for device:%s", name, can_dev->parent.name);
+    return worker;
+}
+#endif /* PKG_ISOTP_C_USING_DEVICE_WORKERS */
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Internal RX Dispatch
+ *  @{
+ *  @brief Routing of received frames to links, and the optional adapter-owned RX path
+ *         (per-device ring filled from rx_indicate, drained by one dispatcher thread).
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Maps a receive arbitration ID onto its RX dispatch table bucket.
+ * @param  id The receive arbitration ID.
+ * @param  addr_key 0 for normal addressing, 0x100 | the receive address byte for extended and mixed addressing.
+ */
+rt_inline struct rt_list_node *_isotp_rtt_dispatch_bucket(uint32_t id, rt_uint32_t addr_key)
+{
+    return &g_dispatch_table[(id ^ (id >> 11) ^ (id >> 22) ^ addr_key) & (PKG_ISOTP_C_DISPATCH_HASH_SIZE - 1)];
+}
+
+#ifdef PKG_ISOTP_C_USING_STATS
+/**
+ * @brief  Updates the timing statistics of a link for a frame about to be handled by the core.
+ * @note   A First Frame starts the reception timer, a Single Frame cancels it. A Flow Control
+ *         frame on a sending link ends the FC round trip started by the last FF or CF.
+ */
+static void _isotp_rtt_stats_on_frame(struct isotp_rtt_link *rtt_link, const uint8_t *data, uint8_t len)
+{
+    if (len <= ISOTP_RTT_ADDR_LEN(rtt_link))
+        return;
+    data += ISOTP_RTT_ADDR_LEN(rtt_link);
+
+    switch (data[0] >> 4)
+    {
+    case ISOTP_PCI_TYPE_FIRST_FRAME:
+        rtt_link->rx_start_us = isotp_user_get_us();
+        rtt_link->stats_flags |= ISOTP_RTT_STATS_RX_TIMING;
+        break;
+    case ISOTP_PCI_TYPE_SINGLE:
+        rtt_link->stats_flags &= ~ISOTP_RTT_STATS_RX_TIMING;
+        break;
+    case ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME:
+        if (ISOTP_SEND_STATUS_INPROGRESS != rtt_link->link.send_status)
+            break;
+        if (rtt_link->stats_flags & ISOTP_RTT_STATS_FC_TIMING)
+        {
+            _isotp_rtt_stats_hist_add(rtt_link->stats.fc_rtt_hist, isotp_user_get_us() - rtt_link->fc_start_us);
+            rtt_link->stats_flags &= ~ISOTP_RTT_STATS_FC_TIMING;
+        }
+        if ((data[0] & 0x0F) == PCI_FLOW_STATUS_WAIT)
+            rtt_link->stats.fc_wait++;
+        break;
+    default:
+        break;
+    }
+}
+#endif
+
+/**
+ * @brief  Feeds one CAN frame into every link of a dispatch table bucket registered for its arbitration ID.
+ * @param  bucket The bucket to walk.
+ * @param  can_dev The device the frame was received on, or RT_NULL to match links on any device.
+ * @param  id The arbitration ID of the frame.
+ * @param  data The frame payload.
+ * @param  len The payload length in bytes.
+ */
+static void _isotp_rtt_dispatch_bucket_frame(struct rt_list_node *bucket, rt_device_t can_dev, uint32_t id, const uint8_t *data, uint8_t len)
+{
+    struct isotp_rtt_link *rtt_link, *next_rtt_link;
+
+    rt_list_for_each_entry_safe(rtt_link, next_rtt_link, bucket, hash_node)
+    {
+        if (rtt_link->recv_arbitration_id != id || (can_dev && rtt_link->can_dev != can_dev))
+            continue;
+#ifdef ISO_TP_ADDRESSING
+        /* Extended and mixed links only take frames carrying their address byte. */
+        if (ISOTP_RTT_ADDR_LEN(rtt_link) && (len <= 1 || data[0] != rtt_link->link.receive_addr))
+            continue;
+#endif
+
+        /*
+         * While the core's receive buffer is lent to the user, a new Single or First Frame would
+         * overwrite it. Keep such frames away from the core until the buffer is released.
+         */
+        rt_uint8_t pci_type = len > 0 ? data[ISOTP_RTT_ADDR_LEN(rtt_link)] >> 4 : ISOTP_PCI_TYPE_CONSECUTIVE_FRAME;
+        if (rtt_link->rx_lent && !rtt_link->rxq_slab &&
+            (pci_type == ISOTP_PCI_TYPE_SINGLE || pci_type == ISOTP_PCI_TYPE_FIRST_FRAME))
+        {
+            rtt_link->rx_dropped++;
+            ISOTP_RTT_STAT_INC(rtt_link, rx_dropped);
+            continue;
+        }
+
+        uint8_t old_receive_status = rtt_link->link.receive_status;
+        ISOTP_RTT_STAT_INC(rtt_link, rx_frames);
+#ifdef PKG_ISOTP_C_USING_STATS
+        _isotp_rtt_stats_on_frame(rtt_link, data, len);
+#endif
+
+        isotp_on_can_message(&rtt_link->link, data, len);
+#ifdef PKG_ISOTP_C_USING_TRACE
+        _isotp_rtt_trace_state(rtt_link);
+#endif
+        _isotp_rtt_tx_check_error(rtt_link);
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+        if (rtt_link->route)
+            _isotp_rtt_route_pull(rtt_link->route);
+#endif
+
+        if (old_receive_status == ISOTP_RECEIVE_STATUS_INPROGRESS && rtt_link->link.receive_status == ISOTP_RECEIVE_STATUS_IDLE &&
+            rtt_link->link.receive_protocol_result == ISOTP_PROTOCOL_RESULT_WRONG_SN)
+        {
+            ISOTP_RTT_STAT_INC(rtt_link, rx_wrong_sn);
+        }
+
+        /*
+         * A frame on a sending link is a Flow Control that may grant new block credit, which
+         * changes the next deadline. A reception that has just started was already put on the
+         * active list by `_isotp_rtt_active_cb`.
+         */
+        if (ISOTP_SEND_STATUS_INPROGRESS == rtt_link->link.send_status)
+        {
+            _isotp_rtt_poll_wakeup(rtt_link);
+        }
+        /* Do not break; multiple links might be listening to the same ID. */
+    }
+}
+
+/**
+ * @brief  Feeds one CAN frame into every link registered for its arbitration ID.
+ * @note   Links with extended or mixed addressing are hashed by their receive address byte as
+ *         well, so a frame on an ID shared by many peers only visits the links of its own peer.
+ *         The caller holds `g_link_lock`.
+ * @param  can_dev The device the frame was received on, or RT_NULL to match links on any device.
+ * @param  id The arbitration ID of the frame.
+ * @param  data The frame payload.
+ * @param  len The payload length in bytes.
+ */
+static void _isotp_rtt_dispatch(rt_device_t can_dev, uint32_t id, const uint8_t *data, uint8_t len)
+{
+    struct rt_list_node *bucket = _isotp_rtt_dispatch_bucket(id, 0);
+
+    _isotp_rtt_dispatch_bucket_frame(bucket, can_dev, id, data, len);
+#ifdef ISO_TP_ADDRESSING
+    if (len > 1 && _isotp_rtt_dispatch_bucket(id, 0x100u | data[0]) != bucket)
+        _isotp_rtt_dispatch_bucket_frame(_isotp_rtt_dispatch_bucket(id, 0x100u | data[0]), can_dev, id, data, len);
+#endif
+}
+
+#ifdef PKG_ISOTP_C_USING_HW_FILTER
+/*
+ * Hardware acceptance filters: every distinct receive ID of a CAN device gets one filter bank that
+ * accepts exactly that ID, so unrelated bus traffic is rejected by the controller. Links listening
+ * to the same ID share their bank. When a device runs out of banks, its top bank is reprogrammed
+ * to accept everything and the links without a bank rely on the software filtering of
+ * `_isotp_rtt_dispatch`; destroying links moves them back into the freed banks.
+ */
+
+/**
+ * @brief  Returns the ID type of a link's receive ID.
+ * @note   Links only store the type used for sending. IDs above 0x7FF must be extended ones,
+ *         the others are assumed to use the same type as the link sends with.
+ */
+rt_inline rt_uint8_t _isotp_rtt_recv_ide(const struct isotp_rtt_link *link)
+{
+    return link->recv_arbitration_id > 0x7FF ? RT_CAN_EXTID : link->send_ide;
+}
+
+/**
+ * @brief  Tells whether two links on the same device receive the same frames.
+ */
+rt_inline rt_bool_t _isotp_rtt_same_recv_id(const struct isotp_rtt_link *a, const struct isotp_rtt_link *b)
+{
+    return a->can_dev == b->can_dev && a->recv_arbitration_id == b->recv_arbitration_id &&
+           _isotp_rtt_recv_ide(a) == _isotp_rtt_recv_ide(b);
+}
+
+/**
+ * @brief  Programs one acceptance filter bank of a CAN device through RT_CAN_CMD_SET_FILTER.
+ * @param  can_dev The CAN device.
+ * @param  bank The bank, relative to PKG_ISOTP_C_HW_FILTER_BANK_BASE.
+ * @param  link The link whose receive ID the bank accepts, or RT_NULL to accept every frame.
+ * @param  active RT_FALSE to release the bank instead.
+ * @return The result of `rt_device_control`.
+ */
+static rt_err_t _isotp_rtt_hw_filter_set(rt_device_t can_dev, rt_int8_t bank, const struct isotp_rtt_link *link, rt_bool_t active)
+{
+    struct rt_can_filter_item item;
+    struct rt_can_filter_config cfg;
+
+    rt_memset(&item, 0, sizeof(item));
+    if (link)
+    {
+        item.ide = _isotp_rtt_recv_ide(link);
+        item.id = link->recv_arbitration_id;
+        item.mask = item.ide == RT_CAN_EXTID ? 0x1FFFFFFF : 0x7FF;
+    }
+    item.rtr = RT_CAN_DTR;
+    item.mode = RT_CAN_MODE_MASK;
+    item.hdr_bank = PKG_ISOTP_C_HW_FILTER_BANK_BASE + bank;
+
+    cfg.count = 1;
+    cfg.actived = active;
+    cfg.items = &item;
+    return rt_device_control(can_dev, RT_CAN_CMD_SET_FILTER, &cfg);
+}
+
+/**
+ * @brief  Returns the first link of a device that has no filter bank, or RT_NULL if there is none.
+ */
+static struct isotp_rtt_link *_isotp_rtt_hw_filter_unbanked(rt_device_t can_dev)
+{
+    struct isotp_rtt_link *other;
+
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (other->can_dev == can_dev && other->hw_filter_bank == ISOTP_RTT_HW_FILTER_NONE)
+            return other;
+    }
+    return RT_NULL;
+}
+
+/**
+ * @brief  Programs a bank for the receive ID of `link` and assigns it to every unbanked link with that ID.
+ * @return RT_TRUE if the bank was programmed.
+ */
+static rt_bool_t _isotp_rtt_hw_filter_promote(struct isotp_rtt_link *link, rt_int8_t bank)
+{
+    struct isotp_rtt_link *other;
+
+    if (_isotp_rtt_hw_filter_set(link->can_dev, bank, link, RT_TRUE) != RT_EOK)
+        return RT_FALSE;
+
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (other->hw_filter_bank == ISOTP_RTT_HW_FILTER_NONE && _isotp_rtt_same_recv_id(other, link))
+            other->hw_filter_bank = bank;
+    }
+    return RT_TRUE;
+}
+
+/**
+ * @brief  Gives a link that is about to be listed a filter bank for its receive ID.
+ * @note   Only the bank of a new receive ID is programmed. If no bank is free, the device falls
+ *         back to software filtering: its top bank accepts every frame from then on.
+ * @param  link The link, not yet in the link list.
+ */
+static void _isotp_rtt_hw_filter_add(struct isotp_rtt_link *link)
+{
+    struct isotp_rtt_link *other;
+    rt_uint32_t used = 0;
+    rt_bool_t fallback = RT_FALSE;
+
+    link->hw_filter_bank = ISOTP_RTT_HW_FILTER_NONE;
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (other->can_dev != link->can_dev)
+            continue;
+        if (_isotp_rtt_same_recv_id(other, link))
+        {
+            link->hw_filter_bank = other->hw_filter_bank;
+            return;
+        }
+        if (other->hw_filter_bank == ISOTP_RTT_HW_FILTER_NONE)
+            fallback = RT_TRUE;
+        else
+            used |= 1UL << other->hw_filter_bank;
+    }
+    if (fallback)
+        return;
+
+    for (rt_int8_t bank = 0; bank < PKG_ISOTP_C_HW_FILTER_BANKS; bank++)
+    {
+        if (used & (1UL << bank))
+            continue;
+        if (_isotp_rtt_hw_filter_set(link->can_dev, bank, link, RT_TRUE) == RT_EOK)
+        {
+            link->hw_filter_bank = bank;
+            return;
+        }
+        break;
+    }
+
+    LOG_W("No filter bank for RID:0x%X on device:%s, falling back to software filtering.", link->recv_arbitration_id,
+          link->can_dev->parent.name);
+    _isotp_rtt_hw_filter_set(link->can_dev, ISOTP_RTT_HW_FILTER_TOP, RT_NULL, RT_TRUE);
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (other->can_dev == link->can_dev && other->hw_filter_bank == ISOTP_RTT_HW_FILTER_TOP)
+            other->hw_filter_bank = ISOTP_RTT_HW_FILTER_NONE;
+    }
+}
+
+/**
+ * @brief  Releases the filter bank of a link that has just been removed from the link list.
+ * @note   A bank still used by a link with the same receive ID is kept. While the device is in
+ *         fallback, a freed bank goes to an unbanked receive ID instead, and once the unbanked
+ *         links all share one ID the accept-all top bank is narrowed down to it again.
+ * @param  link The removed link.
+ */
+static void _isotp_rtt_hw_filter_remove(struct isotp_rtt_link *link)
+{
+    rt_device_t can_dev = link->can_dev;
+    rt_int8_t bank = link->hw_filter_bank;
+    struct isotp_rtt_link *other, *spare;
+
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (_isotp_rtt_same_recv_id(other, link))
+            return;
+    }
+
+    spare = _isotp_rtt_hw_filter_unbanked(can_dev);
+    if (bank != ISOTP_RTT_HW_FILTER_NONE)
+    {
+        /* Without fallback the bank is simply released. */
+        if (!spare)
+        {
+            _isotp_rtt_hw_filter_set(can_dev, bank, link, RT_FALSE);
+            return;
+        }
+        if (_isotp_rtt_hw_filter_promote(spare, bank))
+            spare = _isotp_rtt_hw_filter_unbanked(can_dev);
+    }
+
+    /* The last unbanked link is gone, the accept-all bank is no longer needed. */
+    if (!spare)
+    {
+        _isotp_rtt_hw_filter_set(can_dev, ISOTP_RTT_HW_FILTER_TOP, RT_NULL, RT_FALSE);
+        return;
+    }
+
+    rt_list_for_each_entry(other, &g_link_list_head, node)
+    {
+        if (other->can_dev == can_dev && other->hw_filter_bank == ISOTP_RTT_HW_FILTER_NONE && !_isotp_rtt_same_recv_id(other, spare))
+            return;
+    }
+    if (_isotp_rtt_hw_filter_promote(spare, ISOTP_RTT_HW_FILTER_TOP))
+        LOG_I("Device:%s left software filtering fallback.", can_dev->parent.name);
+}
+#endif /* PKG_ISOTP_C_USING_HW_FILTER */
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief  Finds the port attached to a CAN device.
+ * @return The port, or RT_NULL if the device is not attached.
+ */
+static struct isotp_rtt_port *_isotp_rtt_port_find(rt_device_t can_dev)
+{
+    for (int i = 0; i < PKG_ISOTP_C_MAX_CAN_PORTS; i++)
+    {
+        if (g_ports[i].can_dev == can_dev)
+            return &g_ports[i];
+    }
+    return RT_NULL;
+}
+
+/**
+ * @brief  The rx_indicate hook installed on attached CAN devices (producer, ISR context).
+ * @note   Every frame the driver has buffered is read and stored as a compact record in the
+ *         port's ring. The ring is single-producer/single-consumer: only this hook advances
+ *         `head` and only the dispatcher thread advances `tail`, so no lock is needed.
+ *         Frames are counted as dropped when the ring is full.
+ * @param  dev The device that triggered the interrupt.
+ * @param  size Unused.
+ * @return RT_EOK.
+ */
+static rt_err_t _isotp_rtt_port_rx_indicate(rt_device_t dev, rt_size_t size)
+{
+    struct isotp_rtt_port *port = _isotp_rtt_port_find(dev);
+    struct rt_can_msg msg;
+    rt_bool_t queued = RT_FALSE;
+
+    if (!port)
+        return RT_EOK;
+
+    while (1)
+    {
+        /* Initialize hdr_index to -1 to receive from any hardware filter bank. */
+        msg.hdr_index = -1;
+        if (rt_device_read(dev, 0, &msg, sizeof(msg)) != sizeof(msg))
+            break;
+#ifdef PKG_ISOTP_C_USING_TRACE
+        _isotp_rtt_trace(dev, msg.id, _isotp_rtt_trace_msg_flags(&msg), msg.data, ISOTP_RTT_MSG_LEN(&msg));
+#endif
+
+        rt_uint32_t fill = port->head - port->tail;
+        if (fill >= PKG_ISOTP_C_RX_RING_SIZE)
+        {
+            port->stats.rx_dropped++;
+            continue;
+        }
+
+        struct isotp_rtt_frame *frame = &port->ring[port->head & (PKG_ISOTP_C_RX_RING_SIZE - 1)];
+        frame->id = msg.id;
+        rt_uint8_t len = ISOTP_RTT_MSG_LEN(&msg);
+        frame->len = len > sizeof(frame->data) ? sizeof(frame->data) : len;
+        frame->flags = (msg.ide ? ISOTP_RTT_FRAME_FLAG_IDE : 0) | (msg.rtr ? ISOTP_RTT_FRAME_FLAG_RTR : 0);
+        rt_memcpy(frame->data, msg.data, frame->len);
+        port->head++;
+
+        port->stats.rx_frames++;
+        if (fill + 1 > port->stats.rx_high_watermark)
+            port->stats.rx_high_watermark = fill + 1;
+        queued = RT_TRUE;
+    }
+
+    if (queued)
+    {
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+        rt_event_send(&port->worker->event, POLL_EVENT_RX);
+#else
+        rt_event_send(&g_rx_event, 1UL << (port - g_ports));
+#endif
+    }
+
+    return RT_EOK;
+}
+
+/**
+ * @brief  Feeds up to PKG_ISOTP_C_RX_BATCH_SIZE frames of a port's ring into the links.
+ * @note   The frames are dispatched directly from the ring slots. `tail` is only advanced once
+ *         the batch has been processed, so the producer cannot overwrite a slot that is still
+ *         being dispatched.
+ * @param  port The port.
+ * @return RT_TRUE if frames are left in the ring.
+ */
+static rt_bool_t _isotp_rtt_port_drain(struct isotp_rtt_port *port)
+{
+    rt_uint32_t tail = port->tail;
+    rt_uint32_t count = port->head - tail;
+    rt_bool_t pending = RT_FALSE;
+
+    if (!port->can_dev || count == 0)
+        return RT_FALSE;
+    if (count > PKG_ISOTP_C_RX_BATCH_SIZE)
+    {
+        count = PKG_ISOTP_C_RX_BATCH_SIZE;
+        pending = RT_TRUE;
+    }
+
+    rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+    for (rt_uint32_t n = 0; n < count; n++)
+    {
+        struct isotp_rtt_frame *frame = &port->ring[(tail + n) & (PKG_ISOTP_C_RX_RING_SIZE - 1)];
+        if (!(frame->flags & ISOTP_RTT_FRAME_FLAG_RTR))
+            _isotp_rtt_dispatch(port->can_dev, frame->id, frame->data, frame->len);
+    }
+    rt_mutex_release(&g_link_lock);
+    port->tail = tail + count;
+    return pending;
+}
+
+#ifndef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief  The entry point for the RX dispatcher thread (consumer, thread context).
+ * @note   The thread sleeps until an rx_indicate hook signals that a port has frames, then
+ *         drains the ports in turn, one batch each, until all rings are empty. With
+ *         PKG_ISOTP_C_USING_DEVICE_WORKERS each port is drained by its device's worker instead.
+ * @param  parameter Unused.
+ */
+static void _rx_dispatcher_thread_entry(void *parameter)
+{
+    rt_uint32_t recved_evt;
+
+    while (1)
+    {
+        if (rt_event_recv(&g_rx_event, (1UL << PKG_ISOTP_C_MAX_CAN_PORTS) - 1, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                          RT_WAITING_FOREVER, &recved_evt) != RT_EOK)
+            continue;
+
+        rt_bool_t pending;
+        do
+        {
+            pending = RT_FALSE;
+            for (int i = 0; i < PKG_ISOTP_C_MAX_CAN_PORTS; i++)
+            {
+                if (_isotp_rtt_port_drain(&g_ports[i]))
+                    pending = RT_TRUE;
+            }
+        } while (pending);
+    }
+}
+#endif
+#endif /* PKG_ISOTP_C_USING_RX_DISPATCHER */
+
+/**
+ * @brief  Auto-initialization function for the adapter layer.
+ * @note   This function is called automatically by the RT-Thread INIT_APP_EXPORT mechanism.
+ *         It creates the scheduler event and starts the background polling thread, plus the
+ *         RX dispatcher thread when PKG_ISOTP_C_USING_RX_DISPATCHER is enabled. With
+ *         PKG_ISOTP_C_USING_DEVICE_WORKERS neither exists, every device gets its own worker.
+ * @return RT_EOK on success, -RT_ERROR on failure.
+ */
+static int _isotp_rtt_init(void)
+{
+    _isotp_rtt_timebase_init();
+
+    rt_mutex_init(&g_link_lock, "isotp_lk", RT_IPC_FLAG_PRIO);
+    for (int i = 0; i < PKG_ISOTP_C_DISPATCH_HASH_SIZE; i++)
+    {
+        rt_list_init(&g_dispatch_table[i]);
+    }
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0
+    rt_mp_init(&g_link_pool, "isotp_lnk", g_link_pool_mem, sizeof(g_link_pool_mem), sizeof(struct isotp_rtt_link));
+#endif
+#ifdef PKG_ISOTP_C_USING_HWTIMER_PACING
+    _isotp_rtt_pace_timer_init();
+#endif
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    /* The worker threads are started by the first link or RX port of each device. */
+#else
+    rt_event_init(&g_poll_event, "isotp_poll", RT_IPC_FLAG_FIFO);
+    rt_thread_t tid = rt_thread_create("isotp_poll",
+                                       _poll_thread_entry,
+                                       RT_NULL,
+                                       PKG_ISOTP_C_POLL_THREAD_STACK_SIZE,
+                                       PKG_ISOTP_C_POLL_THREAD_PRIORITY,
+                                       10);
+    if (tid)
+    {
+        rt_thread_startup(tid);
+    }
+    else
+    {
+        LOG_E("Failed to create isotp_poll thread.");
+        return -RT_ERROR;
+    }
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+    rt_event_init(&g_rx_event, "isotp_rx", RT_IPC_FLAG_FIFO);
+    tid = rt_thread_create("isotp_rx",
+                           _rx_dispatcher_thread_entry,
+                           RT_NULL,
+                           PKG_ISOTP_C_RX_THREAD_STACK_SIZE,
+                           PKG_ISOTP_C_RX_THREAD_PRIORITY,
+                           10);
+    if (tid)
+    {
+        rt_thread_startup(tid);
+    }
+    else
+    {
+        LOG_E("Failed to create isotp_rx thread.");
+        return -RT_ERROR;
+    }
+#endif
+#endif /* PKG_ISOTP_C_USING_DEVICE_WORKERS */
+    return RT_EOK;
+}
+INIT_APP_EXPORT(_isotp_rtt_init);
+/** @} */
+
+
+/*************************************************************************************************/
+/** @name Public API Implementation
+ *  @{
+ *  @brief The public functions exposed to the user application.
+ */
+/*************************************************************************************************/
+
+/**
+ * @brief  Processes a received CAN message.
+ * @warning This function MUST be called from a thread context (e.g., a workqueue or a dedicated
+ *          consumer thread), NOT from a CAN ISR. This is because `isotp_on_can_message` may
+ *          trigger an immediate transmission (e.g., a Flow Control frame), which is a
+ *          blocking operation unsuitable for an ISR.
+ * @param  msg A pointer to the received `rt_can_msg` structure.
+ */
+void isotp_rtt_on_can_msg_received(struct rt_can_msg *msg)
+{
+    isotp_rtt_on_can_msg_received_from(RT_NULL, msg);
+}
+
+/**
+ * @brief  Processes a CAN message received on a specific CAN device.
+ * @note   Only links created on `can_dev` are considered. Passing RT_NULL matches links
+ *         on any device, which is what `isotp_rtt_on_can_msg_received` does.
+ * @param  can_dev The device the message was received on.
+ * @param  msg A pointer to the received `rt_can_msg` structure.
+ */
+void isotp_rtt_on_can_msg_received_from(rt_device_t can_dev, struct rt_can_msg *msg)
+{
+#if (DBG_LVL >= DBG_LOG)
+    {
+        char title_buf[32];
+        rt_snprintf(title_buf, sizeof(title_buf), "[RX] ID: 0x%X", msg->id);
+        print_hex_data(title_buf, msg->data, ISOTP_RTT_MSG_LEN(msg));
+    }
+#endif
+
+#ifdef PKG_ISOTP_C_USING_TRACE
+    _isotp_rtt_trace(can_dev, msg->id, _isotp_rtt_trace_msg_flags(msg), msg->data, ISOTP_RTT_MSG_LEN(msg));
+#endif
+    rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+    _isotp_rtt_dispatch(can_dev, msg->id, msg->data, ISOTP_RTT_MSG_LEN(msg));
+    rt_mutex_release(&g_link_lock);
+}
+
+/**
+ * @brief  Creates and initializes a new ISO-TP link instance with the default protocol parameters.
+ * @param  can_dev The user-opened RT-Thread CAN device handle.
+ * @param  send_arbitration_id The CAN ID to use for sending.
+ * @param  recv_arbitration_id The CAN ID to listen for.
+ * @param  send_ide CAN ID type (RT_CAN_STDID or RT_CAN_EXTID).
+ * @param  send_rtr CAN frame type (RT_CAN_DTR or RT_CAN_RTR).
+ * @param  send_buf User-provided buffer for outgoing PDUs.
+ * @param  send_buf_size Size of the send buffer.
+ * @param  recv_buf User-provided buffer for incoming PDUs.
+ * @param  recv_buf_size Size of the receive buffer.
+ * @return A handle to the new link, or RT_NULL on failure.
+ */
+isotp_rtt_link_t isotp_rtt_create(rt_device_t can_dev,
+                                  uint32_t send_arbitration_id,
+                                  uint32_t recv_arbitration_id,
+                                  rt_uint8_t send_ide,
+                                  rt_uint8_t send_rtr,
+                                  uint8_t *send_buf,
+                                  uint16_t send_buf_size,
+                                  uint8_t *recv_buf,
+                                  uint16_t recv_buf_size)
+{
+    return isotp_rtt_create_ex(can_dev, send_arbitration_id, recv_arbitration_id, send_ide, send_rtr,
+                               send_buf, send_buf_size, recv_buf, recv_buf_size, RT_NULL);
+}
+
+/**
+ * @brief  Creates and initializes a new ISO-TP link instance with its own protocol parameters.
+ * @param  can_dev The user-opened RT-Thread CAN device handle.
+ * @param  send_arbitration_id The CAN ID to use for sending.
+ * @param  recv_arbitration_id The CAN ID to listen for.
+ * @param  send_ide CAN ID type (RT_CAN_STDID or RT_CAN_EXTID).
+ * @param  send_rtr CAN frame type (RT_CAN_DTR or RT_CAN_RTR).
+ * @param  send_buf User-provided buffer for outgoing PDUs.
+ * @param  send_buf_size Size of the send buffer.
+ * @param  recv_buf User-provided buffer for incoming PDUs.
+ * @param  recv_buf_size Size of the receive buffer.
+ * @param  config Timeouts, BS/STmin, FC.WAIT limit, padding and TX_DL of the link, or RT_NULL for the defaults.
+ * @return A handle to the new link, or RT_NULL on failure.
+ */
+isotp_rtt_link_t isotp_rtt_create_ex(rt_device_t can_dev,
+                                     uint32_t send_arbitration_id,
+                                     uint32_t recv_arbitration_id,
+                                     rt_uint8_t send_ide,
+                                     rt_uint8_t send_rtr,
+                                     uint8_t *send_buf,
+                                     uint16_t send_buf_size,
+                                     uint8_t *recv_buf,
+                                     uint16_t recv_buf_size,
+                                     const IsoTpLinkConfig *config)
+{
+    if (!can_dev)
+    {
+        LOG_E("CAN device handle cannot be NULL.");
+        return RT_NULL;
+    }
+
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0
+    struct isotp_rtt_link *rtt_link = rt_mp_alloc(&g_link_pool, 0);
+    rt_uint8_t alloc = ISOTP_RTT_LINK_ALLOC_POOL;
+#else
+    struct isotp_rtt_link *rtt_link = rt_malloc(sizeof(struct isotp_rtt_link));
+    rt_uint8_t alloc = ISOTP_RTT_LINK_ALLOC_HEAP;
+#endif
+    if (!rtt_link)
+    {
+        LOG_E("Failed to allocate memory for rtt_link.");
+        return RT_NULL;
+    }
+
+    if (isotp_rtt_init(rtt_link, can_dev, send_arbitration_id, recv_arbitration_id, send_ide, send_rtr,
+                       send_buf, send_buf_size, recv_buf, recv_buf_size, config) != RT_EOK)
+    {
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0
+        rt_mp_free(rtt_link);
+#else
+        rt_free(rtt_link);
+#endif
+        return RT_NULL;
+    }
+    rtt_link->alloc = alloc;
+    return rtt_link;
+}
+
+/**
+ * @brief  Initializes an ISO-TP link instance in caller-provided storage.
+ * @note   No memory is allocated: the event and mutex are embedded in the link object.
+ * @param  link The storage for the link, e.g. a static variable.
+ * @param  can_dev The user-opened RT-Thread CAN device handle.
+ * @param  send_arbitration_id The CAN ID to use for sending.
+ * @param  recv_arbitration_id The CAN ID to listen for.
+ * @param  send_ide CAN ID type (RT_CAN_STDID or RT_CAN_EXTID).
+ * @param  send_rtr CAN frame type (RT_CAN_DTR or RT_CAN_RTR).
+ * @param  send_buf User-provided buffer for outgoing PDUs.
+ * @param  send_buf_size Size of the send buffer.
+ * @param  recv_buf User-provided buffer for incoming PDUs.
+ * @param  recv_buf_size Size of the receive buffer.
+ * @param  config Protocol parameters of the link, or RT_NULL for the defaults.
+ * @return RT_EOK on success, -RT_EINVAL if `link` or `can_dev` is NULL, -RT_EFULL if no worker or TX ring is left for `can_dev`.
+ */
+rt_err_t isotp_rtt_init(struct isotp_rtt_link *link,
+                        rt_device_t can_dev,
+                        uint32_t send_arbitration_id,
+                        uint32_t recv_arbitration_id,
+                        rt_uint8_t send_ide,
+                        rt_uint8_t send_rtr,
+                        uint8_t *send_buf,
+                        uint16_t send_buf_size,
+                        uint8_t *recv_buf,
+                        uint16_t recv_buf_size,
+                        const IsoTpLinkConfig *config)
+{
+    if (!link || !can_dev)
+    {
+        LOG_E("Link storage and CAN device handle cannot be NULL.");
+        return -RT_EINVAL;
+    }
+    rt_memset(link, 0, sizeof(struct isotp_rtt_link));
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    link->worker = _isotp_rtt_worker_get(can_dev);
+    if (!link->worker)
+        return -RT_EFULL;
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    link->tx_ring = _isotp_rtt_tx_ring_get(can_dev);
+    if (!link->tx_ring)
+        return -RT_EFULL;
+    rt_list_init(&link->tx_stall_node);
+#endif
+    link->can_dev = can_dev;
+    link->recv_arbitration_id = recv_arbitration_id;
+    link->send_ide = send_ide;
+    link->send_rtr = send_rtr;
+    link->rx_buf_ptr = recv_buf;
+    link->rx_buf_size = recv_buf_size;
+    link->alloc = ISOTP_RTT_LINK_ALLOC_STATIC;
+
+    char event_name[RT_NAME_MAX];
+    char mutex_name[RT_NAME_MAX];
+    rt_snprintf(event_name, RT_NAME_MAX, "isotp_evt_%lx", recv_arbitration_id);
+    rt_snprintf(mutex_name, RT_NAME_MAX, "isotp_tx_mtx_%lx", send_arbitration_id);
+
+    rt_event_init(&link->event, event_name, RT_IPC_FLAG_FIFO);
+    rt_mutex_init(&link->send_mutex, mutex_name, RT_IPC_FLAG_FIFO);
+
+    isotp_init_link_with_config(&link->link, send_arbitration_id, send_buf, send_buf_size, recv_buf, recv_buf_size, config);
+    link->link.user_send_can_arg = link;
+    link->send_fd = link->link.send_tx_dl > 8;
+
+    isotp_set_tx_done_cb(&link->link, _isotp_rtt_tx_done_cb, link);
+    isotp_set_rx_done_cb(&link->link, _isotp_rtt_rx_done_cb, link);
+    isotp_set_active_cb(&link->link, _isotp_rtt_active_cb, link);
+    rt_list_init(&link->active_node);
+
+    rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+#ifdef PKG_ISOTP_C_USING_HW_FILTER
+    _isotp_rtt_hw_filter_add(link);
+#endif
+    rt_list_insert_after(&g_link_list_head, &link->node);
+    rt_list_insert_after(_isotp_rtt_dispatch_bucket(recv_arbitration_id, ISOTP_RTT_ADDR_KEY(link)), &link->hash_node);
+    rt_mutex_release(&g_link_lock);
+
+    LOG_I("ISO-TP link created for device:%s, SID:0x%X, RID:0x%X", can_dev->parent.name, send_arbitration_id, recv_arbitration_id);
+    return RT_EOK;
+}
+
+/**
+ * @brief  Detaches an ISO-TP link from the adapter and releases its RTOS objects.
+ * @note   The link's storage itself is not freed, it may be reused with `isotp_rtt_init`.
+ * @param  link The link to detach.
+ * @return RT_EOK on success, -RT_EINVAL if the link is NULL, -RT_EBUSY if it is the ingress or egress of a route.
+ */
+rt_err_t isotp_rtt_detach(isotp_rtt_link_t link)
+{
+    rt_base_t level;
+
+    if (!link)
+        return -RT_EINVAL;
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    if (link->route || link->route_refs)
+    {
+        LOG_E("Link[0x%p] is routed, detach its route first.", link);
+        return -RT_EBUSY;
+    }
+#endif
+    /* Waits for a dispatch or poll pass that is inside the link to leave it. */
+    rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+    rt_list_remove(&link->node);
+    rt_list_remove(&link->hash_node);
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    rt_enter_critical();
+    rt_list_remove(&link->tx_stall_node);
+    link->tx_stalled = RT_FALSE;
+    rt_exit_critical();
+#endif
+    level = rt_hw_interrupt_disable();
+    rt_list_remove(&link->active_node);
+    rt_hw_interrupt_enable(level);
+#ifdef PKG_ISOTP_C_USING_HW_FILTER
+    _isotp_rtt_hw_filter_remove(link);
+#endif
+    rt_mutex_release(&g_link_lock);
+
+    /* Report every PDU still queued so that no completion callback is lost. */
+    while (link->txq_head != link->txq_tail)
+    {
+        if (link->txq[link->txq_tail % PKG_ISOTP_C_TX_QUEUE_DEPTH].cancelled)
+        {
+            link->txq_tail++;
+            continue;
+        }
+        link->tx_active = RT_TRUE;
+        _isotp_rtt_tx_complete(link, ISOTP_PROTOCOL_RESULT_ERROR);
+    }
+
+    struct isotp_rtt_txn *txn = _isotp_rtt_txn_claim(link);
+    if (txn)
+        _isotp_rtt_txn_finish(link, txn, -RT_ERROR);
+
+    rt_event_detach(&link->event);
+    rt_mutex_detach(&link->send_mutex);
+    LOG_I("ISO-TP link detached.");
+    return RT_EOK;
+}
+
+/**
+ * @brief  Destroys an ISO-TP link created with `isotp_rtt_create` and releases its resources.
+ * @note   Links set up with `isotp_rtt_init` are only detached, their storage belongs to the caller.
+ * @param  link The link handle to destroy.
+ */
+void isotp_rtt_destroy(isotp_rtt_link_t link)
+{
+    if (!link)
+        return;
+
+    rt_uint8_t alloc = link->alloc;
+    if (isotp_rtt_detach(link) != RT_EOK)
+        return;
+
+    if (alloc == ISOTP_RTT_LINK_ALLOC_HEAP)
+    {
+        rt_free(link);
+    }
+#if PKG_ISOTP_C_LINK_POOL_SIZE > 0
+    else if (alloc == ISOTP_RTT_LINK_ALLOC_POOL)
+    {
+        rt_mp_free(link);
+    }
+#endif
+    else
+    {
+        LOG_W("Link[0x%p] uses caller storage, use isotp_rtt_detach instead.", link);
+    }
+}
+
+/**
+ * @brief Sends an ISO-TP message in a blocking manner.
+ * @note  This function queues the message for transmission and then blocks the calling thread
+ *        until the entire message is successfully sent or an error/timeout occurs.
+ *        If the timeout expires before the message has even started, it is withdrawn from the queue;
+ *        a message already in progress is finished in the background and its result discarded.
+ * @param  link The link handle.
+ * @param  payload Pointer to the data to send.
+ * @param  size Size of the data.
+ * @param  timeout Timeout in system ticks.
+ * @return Returns ISOTP_RET_OK on success.
+ * @retval ISOTP_RET_TIMEOUT_RTT on timeout.
+ * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
+ * @retval ISOTP_RET_ERROR_RTT if the transmission failed (e.g. N_Bs timeout, FC overflow).
+ * @retval Other ISOTP_RET_* codes if the message could not be queued.
+ */
+int isotp_rtt_send(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size, rt_int32_t timeout)
+{
+    int ret = ISOTP_RET_OK;
+    if (!link)
+        return ISOTP_RET_INVAL_ARGS;
+
+    rt_uint32_t recved_evt;
+    rt_uint32_t index;
+    rt_uint32_t seq;
+
+    rt_mutex_take(&link->send_mutex, RT_WAITING_FOREVER);
+
+    seq = _isotp_rtt_blocking_tx_begin(link);
+    ret = _isotp_rtt_tx_submit(link, payload, size, _isotp_rtt_blocking_tx_cb, (void *)(rt_ubase_t)seq, &index);
+    if (ret != ISOTP_RET_OK)
+    {
+        LOG_E("isotp_rtt_send could not queue the message, code: %d", ret);
+    }
+    else
+    {
+        if (rt_event_recv(&link->event, EVENT_FLAGS_TX, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, timeout, &recved_evt) != RT_EOK)
+        {
+            LOG_W("isotp_rtt_send timeout.");
+            _isotp_rtt_tx_cancel(link, index);
+            ret = ISOTP_RET_TIMEOUT_RTT;
+        }
+        else if (recved_evt & EVENT_FLAG_TX_ERROR)
+        {
+            LOG_E("isotp_rtt_send failed with protocol result %d.", link->tx_result);
+            ret = ISOTP_RET_ERROR_RTT;
+        }
+    }
+
+    _isotp_rtt_blocking_tx_end(link);
+    rt_mutex_release(&link->send_mutex);
+    return ret;
+}
+
+#ifdef ISO_TP_STREAMING_SEND
+/**
+ * @brief Sends an ISO-TP message whose payload is pulled from a callback while it is being sent.
+ * @note  Only one streaming request can be queued per link at a time, which the send mutex
+ *        guarantees. On timeout, a request that has already started is abandoned: the source is
+ *        detached so the core aborts at its next frame, and the function waits for that
+ *        completion so that `source` is never called after it has returned.
+ * @param  link The link handle.
+ * @param  size Size of the PDU.
+ * @param  source The payload source.
+ * @param  arg User argument passed to `source`.
+ * @param  timeout Timeout in system ticks.
+ * @return Returns ISOTP_RET_OK on success.
+ * @retval ISOTP_RET_TIMEOUT_RTT on timeout.
+ * @retval ISOTP_RET_INVAL_ARGS if the link handle, size or source is invalid.
+ * @retval ISOTP_RET_ERROR_RTT if the transmission failed, including a failing source.
+ * @retval Other ISOTP_RET_* codes if the message could not be queued.
+ */
+int isotp_rtt_send_stream(isotp_rtt_link_t link, uint32_t size, isotp_tx_source_cb source, void *arg, rt_int32_t timeout)
+{
+    struct isotp_rtt_tx_req req;
+    rt_uint32_t recved_evt;
+    rt_uint32_t index;
+    int ret;
+
+    if (!link || !source || size == 0 || size > ISOTP_SIZE_MAX)
+        return ISOTP_RET_INVAL_ARGS;
+
+    rt_mutex_take(&link->send_mutex, RT_WAITING_FOREVER);
+
+    rt_memset(&req, 0, sizeof(req));
+    req.source = source;
+    req.source_arg = arg;
+    req.stream_size = size;
+    req.cb = _isotp_rtt_blocking_tx_cb;
+    req.cb_arg = (void *)(rt_ubase_t)_isotp_rtt_blocking_tx_begin(link);
+
+    ret = _isotp_rtt_tx_push(link, &req, &index);
+    if (ret != ISOTP_RET_OK)
+    {
+        LOG_E("isotp_rtt_send_stream could not queue the message, code: %d", ret);
+    }
+    else
+    {
+        if (rt_event_recv(&link->event, EVENT_FLAGS_TX, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, timeout, &recved_evt) != RT_EOK)
+        {
+            LOG_W("isotp_rtt_send_stream timeout.");
+            if (!_isotp_rtt_tx_cancel(link, index))
+            {
+                /* The request is in progress, or has just completed and its slot may be reused. */
+                rt_base_t level = rt_hw_interrupt_disable();
+                if (link->tx_active && link->txq_tail == index)
+                    link->txq[index % PKG_ISOTP_C_TX_QUEUE_DEPTH].source = RT_NULL;
+                rt_hw_interrupt_enable(level);
+                rt_event_recv(&link->event, EVENT_FLAGS_TX, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, RT_WAITING_FOREVER, &recved_evt);
+            }
+            ret = ISOTP_RET_TIMEOUT_RTT;
+        }
+        else if (recved_evt & EVENT_FLAG_TX_ERROR)
+        {
+            LOG_E("isotp_rtt_send_stream failed with protocol result %d.", link->tx_result);
+            ret = ISOTP_RET_ERROR_RTT;
+        }
+    }
+
+    _isotp_rtt_blocking_tx_end(link);
+    rt_mutex_release(&link->send_mutex);
+    return ret;
+}
+#endif
+
+/**
+ * @brief Sends an ISO-TP message in a non-blocking manner ("fire and forget").
+ * @note  This function starts the transmission and returns immediately. It does not wait for
+ *        the transmission to complete, and the user cannot know its final status; use
+ *        `isotp_rtt_send_async` for that. The payload is copied before returning, so it is only
+ *        accepted when the link is idle.
+ * @param  link The link handle.
+ * @param  payload Pointer to the data to send.
+ * @param  size Size of the data.
+ * @return Returns ISOTP_RET_OK if the message was successfully started.
+ * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
+ * @retval ISOTP_RET_INPROGRESS if another send is already in progress or queued.
+ * @retval Other ISOTP_RET_* codes if the message could not be started.
+ */
+int isotp_rtt_send_nonblocking(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size)
+{
+    int ret = ISOTP_RET_OK;
+    if (!link)
+        return ISOTP_RET_INVAL_ARGS;
+
+    /*
+     * To ensure non-blocking behavior, we use a non-blocking mutex take (`timeout = 0`).
+     * This attempts to acquire the lock. If another blocking send is in progress, it will
+     * fail immediately instead of waiting.
+     */
+    if (rt_mutex_take(&link->send_mutex, 0) != RT_EOK)
+    {
+        /*
+         * Another send is already in progress on this link. Return a specific error
+         * to indicate that the resource is busy.
+         */
+        return ISOTP_RET_INPROGRESS;
+    }
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_bool_t busy = link->tx_active || link->txq_head != link->txq_tail;
+    rt_hw_interrupt_enable(level);
+
+    rt_uint32_t index;
+    if (busy)
+    {
+        ret = ISOTP_RET_INPROGRESS;
+    }
+    else
+    {
+        ret = _isotp_rtt_tx_submit(link, payload, size, RT_NULL, RT_NULL, &index);
+
+        /*
+         * IMPORTANT: The caller may reuse `payload` as soon as we return, so the request must
+         * have been copied into the send buffer by now. If a concurrent completion path was
+         * starting requests at the same time, ours may still be waiting: withdraw it.
+         */
+        if (ret == ISOTP_RET_OK && _isotp_rtt_tx_cancel(link, index))
+            ret = ISOTP_RET_INPROGRESS;
+    }
+
+    rt_mutex_release(&link->send_mutex);
+    return ret;
+}
+
+/**
+ * @brief  Queues an ISO-TP message for transmission and reports its final status through a callback.
+ * @param  link The link handle.
+ * @param  payload Pointer to the data to send, valid until `cb` is called.
+ * @param  size Size of the data.
+ * @param  cb Completion callback, may be RT_NULL.
+ * @param  arg User argument passed to `cb`.
+ * @return ISOTP_RET_OK if queued, ISOTP_RET_INVAL_ARGS, ISOTP_RET_OVERFLOW or ISOTP_RET_NOSPACE otherwise.
+ */
+int isotp_rtt_send_async(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size, isotp_rtt_tx_cb_t cb, void *arg)
+{
+    if (!link || (!payload && size))
+        return ISOTP_RET_INVAL_ARGS;
+
+    return _isotp_rtt_tx_submit(link, payload, size, cb, arg, RT_NULL);
+}
+
+/**
+ * @brief  Waits until a received PDU is available on a link.
+ * @note   Without an RX queue, this waits for one `EVENT_FLAG_RX_DONE`. With an RX queue, the
+ *         event only tells that the queue has changed: the wait ends as soon as the queue is
+ *         non-empty, and a stale event left over from an entry that was already consumed is
+ *         ignored while the remaining timeout is honoured.
+ * @param  link The link handle.
+ * @param  timeout Timeout in system ticks.
+ * @return RT_EOK when a PDU is available, -RT_ETIMEOUT on timeout.
+ */
+static rt_err_t _isotp_rtt_rx_wait(isotp_rtt_link_t link, rt_int32_t timeout)
+{
+    rt_uint32_t recved_evt;
+    rt_tick_t start = rt_tick_get();
+
+    while (!link->rxq_slab || link->rxq_head == link->rxq_tail)
+    {
+        rt_int32_t remaining = timeout;
+        if (timeout != RT_WAITING_FOREVER)
+        {
+            rt_tick_t elapsed = rt_tick_get() - start;
+            remaining = (elapsed >= (rt_tick_t)timeout) ? 0 : (rt_int32_t)(timeout - elapsed);
+        }
+
+        if (rt_event_recv(&link->event, EVENT_FLAG_RX_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, remaining, &recved_evt) != RT_EOK)
+            return -RT_ETIMEOUT;
+        if (!link->rxq_slab)
+            break;
+    }
+    return RT_EOK;
+}
+
+/**
+ * @brief  Receives an ISO-TP message in a blocking manner.
+ * @note   This function blocks the calling thread by waiting for the `EVENT_FLAG_RX_DONE` event,
+ *         which is posted by the `_isotp_rtt_rx_done_cb` callback when a complete PDU
+ *         has been assembled. It then copies the data from the link's internal buffer, or from
+ *         the oldest RX queue entry, to the user-provided `payload_buf`.
+ * @param  link The link handle.
+ * @param  payload_buf Buffer to store the received data.
+ * @param  buf_size Size of the `payload_buf`.
+ * @param  out_size Pointer to store the actual size of the received data.
+ * @param  timeout Timeout in system ticks.
+ * @return RT_EOK on success, -RT_EFULL if the PDU was truncated, -RT_ENOMEM if `payload_buf` is too small,
+ *         -RT_ETIMEOUT on timeout, -RT_EBUSY if a PDU is still borrowed, -RT_ERROR on other failures.
+ */
+rt_err_t isotp_rtt_receive(isotp_rtt_link_t link, uint8_t *payload_buf, uint16_t buf_size, uint16_t *out_size, rt_int32_t timeout)
+{
+    if (!link || !payload_buf || !out_size)
+        return -RT_EINVAL;
+    if (link->rx_lent)
+        return -RT_EBUSY;
+
+    rt_err_t result = _isotp_rtt_rx_wait(link, timeout);
+    if (result != RT_EOK)
+    {
+        *out_size = 0;
+        return result;
+    }
+
+    const uint8_t *pdu = link->rx_buf_ptr;
+    uint16_t copy_size = link->rx_actual_size;
+    rt_bool_t truncated = link->rx_truncated;
+
+    if (link->rxq_slab)
+    {
+        struct isotp_rtt_rx_entry *entry = _isotp_rtt_rxq_entry(link, link->rxq_tail);
+        pdu = (const uint8_t *)(entry + 1);
+        copy_size = entry->size;
+        truncated = entry->truncated;
+    }
+
+    if (copy_size > buf_size)
+    {
+        LOG_E("User receive buffer is too small! Required: %d, Provided: %d", copy_size, buf_size);
+        *out_size = 0;
+        result = -RT_ENOMEM;
+    }
+    else
+    {
+        rt_memcpy(payload_buf, pdu, copy_size);
+        *out_size = copy_size;
+        result = truncated ? -RT_EFULL : RT_EOK;
+    }
+
+    /* The entry is consumed even on -RT_ENOMEM, as the PDU in the internal buffer would be. */
+    if (link->rxq_slab)
+        link->rxq_tail++;
+
+    return result;
+}
+
+/**
+ * @brief  Receives an ISO-TP message without copying it.
+ * @note   Instead of copying the PDU, a view into the link's receive buffer or into the oldest
+ *         RX queue entry is returned. The memory stays reserved until `isotp_rtt_receive_release`
+ *         is called: the queue entry is not reused, and without a queue, new Single and First
+ *         Frames for the link are dropped (and counted) so that the core cannot overwrite it.
+ * @param  link The link handle.
+ * @param  payload Output: pointer to the PDU.
+ * @param  size Output: size of the PDU.
+ * @param  timeout Timeout in system ticks.
+ * @return RT_EOK on success, -RT_EFULL if the PDU was truncated, -RT_ETIMEOUT on timeout,
+ *         -RT_EBUSY if a PDU is already borrowed, -RT_ERROR on other failures.
+ */
+rt_err_t isotp_rtt_receive_borrow(isotp_rtt_link_t link, const uint8_t **payload, uint16_t *size, rt_int32_t timeout)
+{
+    if (!link || !payload || !size)
+        return -RT_EINVAL;
+    if (link->rx_lent)
+        return -RT_EBUSY;
+
+    rt_err_t result = _isotp_rtt_rx_wait(link, timeout);
+    if (result != RT_EOK)
+    {
+        *payload = RT_NULL;
+        *size = 0;
+        return result;
+    }
+
+    if (link->rxq_slab)
+    {
+        struct isotp_rtt_rx_entry *entry = _isotp_rtt_rxq_entry(link, link->rxq_tail);
+        *payload = (const uint8_t *)(entry + 1);
+        *size = entry->size;
+        result = entry->truncated ? -RT_EFULL : RT_EOK;
+    }
+    else
+    {
+        *payload = link->rx_buf_ptr;
+        *size = link->rx_actual_size;
+        result = link->rx_truncated ? -RT_EFULL : RT_EOK;
+    }
+    link->rx_lent = RT_TRUE;
+
+    return result;
+}
+
+/**
+ * @brief  Returns a PDU obtained with `isotp_rtt_receive_borrow` to the link.
+ * @param  link The link handle.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid or nothing is borrowed.
+ */
+rt_err_t isotp_rtt_receive_release(isotp_rtt_link_t link)
+{
+    if (!link || !link->rx_lent)
+        return -RT_EINVAL;
+
+    if (link->rxq_slab)
+        link->rxq_tail++;
+    link->rx_lent = RT_FALSE;
+
+    return RT_EOK;
+}
+
+/**
+ * @brief  Prepares a transaction with the default P2 and P2* timeouts.
+ */
+void isotp_rtt_txn_init(struct isotp_rtt_txn *txn, const uint8_t *request, uint16_t request_size,
+                        uint8_t *response, uint16_t response_buf_size)
+{
+    if (!txn)
+        return;
+
+    rt_memset(txn, 0, sizeof(*txn));
+    txn->request = request;
+    txn->request_size = request_size;
+    txn->response = response;
+    txn->response_buf_size = response_buf_size;
+    txn->p2_us = PKG_ISOTP_C_TXN_P2_MS * 1000UL;
+    txn->p2_ext_us = PKG_ISOTP_C_TXN_P2_EXT_MS * 1000UL;
+}
+
+/**
+ * @brief  Starts a request/response transaction.
+ * @note   The transaction is attached to the link before the request is queued; a Single Frame
+ *         request is sent from this call, so the response may complete it before it returns.
+ * @param  link The link handle.
+ * @param  txn The transaction, prepared with `isotp_rtt_txn_init`.
+ * @param  cb Completion callback, may be RT_NULL.
+ * @param  arg User argument passed to `cb`.
+ * @return RT_EOK if started, -RT_EINVAL, -RT_EBUSY, -RT_EFULL or -RT_ENOMEM otherwise.
+ */
+rt_err_t isotp_rtt_transact_async(isotp_rtt_link_t link, struct isotp_rtt_txn *txn, isotp_rtt_txn_cb_t cb, void *arg)
+{
+    rt_base_t level;
+    int ret;
+
+    if (!link || !txn || !txn->request || txn->request_size == 0 || (!txn->response && txn->response_buf_size))
+        return -RT_EINVAL;
+    if (link->rx_lent)
+        return -RT_EBUSY;
+#ifdef ISO_TP_STREAMING_RECEIVE
+    if (link->rx_sink)
+        return -RT_EBUSY;
+#endif
+
+    txn->cb = cb;
+    txn->cb_arg = arg;
+    txn->result = RT_EOK;
+    txn->response_size = 0;
+    txn->pending = 0;
+    txn->elapsed_us = 0;
+
+    level = rt_hw_interrupt_disable();
+    if (link->txn)
+    {
+        rt_hw_interrupt_enable(level);
+        return -RT_EBUSY;
+    }
+    link->txn = txn;
+    link->txn_state = ISOTP_RTT_TXN_SEND;
+    link->txn_start_us = isotp_user_get_us();
+    rt_hw_interrupt_enable(level);
+
+    ret = _isotp_rtt_tx_submit(link, txn->request, txn->request_size, _isotp_rtt_txn_tx_cb, txn, RT_NULL);
+    if (ret != ISOTP_RET_OK)
+    {
+        /* Nothing was queued, so nothing else can have completed the transaction. */
+        _isotp_rtt_txn_claim(link);
+        LOG_E("Link[0x%p] could not queue the transaction request, code: %d", link, ret);
+        return ret == ISOTP_RET_NOSPACE ? -RT_EFULL : -RT_ENOMEM;
+    }
+    return RT_EOK;
+}
+
+/**
+ * @brief  Sends a request and blocks until its transaction has completed.
+ * @note   The wait itself has no timeout: the transaction always completes, through its
+ *         response, its P2/P2* timeout in the polling thread or the failure of its request.
+ * @param  link The link handle.
+ * @param  txn The transaction, prepared with `isotp_rtt_txn_init`.
+ * @return `txn->result`, or the error `isotp_rtt_transact_async` did not start it with.
+ */
+rt_err_t isotp_rtt_transact(isotp_rtt_link_t link, struct isotp_rtt_txn *txn)
+{
+    rt_uint32_t recved_evt;
+    rt_err_t result;
+
+    if (!link)
+        return -RT_EINVAL;
+
+    /* Clear a completion left over from a transaction that was not waited for. */
+    rt_event_recv(&link->event, EVENT_FLAG_TXN_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, 0, &recved_evt);
+
+    result = isotp_rtt_transact_async(link, txn, _isotp_rtt_blocking_txn_cb, RT_NULL);
+    if (result != RT_EOK)
+        return result;
+
+    rt_event_recv(&link->event, EVENT_FLAG_TXN_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, RT_WAITING_FOREVER, &recved_evt);
+    return txn->result;
+}
+
+/**
+ * @brief  Enables a queue of completed PDUs on a link, backed by a user-provided slab.
+ * @note   The slab is split into entries that each hold one PDU of up to `recv_buf_size` bytes
+ *         (see ISOTP_RTT_RX_QUEUE_SLAB_SIZE). No memory is allocated on the receive path.
+ *         This should be called right after `isotp_rtt_create`, before traffic is received.
+ * @param  link The link handle.
+ * @param  slab The slab memory, or RT_NULL to disable the queue again.
+ * @param  slab_size The size of the slab in bytes.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid or the slab cannot hold one entry.
+ */
+rt_err_t isotp_rtt_set_rx_queue(isotp_rtt_link_t link, void *slab, rt_size_t slab_size)
+{
+    if (!link)
+        return -RT_EINVAL;
+
+    uint16_t entry_size = ISOTP_RTT_RX_QUEUE_ENTRY_SIZE(link->rx_buf_size);
+    rt_size_t depth = slab ? slab_size / entry_size : 0;
+    if (slab && (depth == 0 || depth > 0xFFFF))
+        return -RT_EINVAL;
+
+    RT_ASSERT(sizeof(struct isotp_rtt_rx_entry) == ISOTP_RTT_RX_QUEUE_ENTRY_HDR_SIZE);
+
+    rt_enter_critical();
+    link->rxq_slab = (uint8_t *)slab;
+    link->rxq_entry_size = entry_size;
+    link->rxq_depth = (uint16_t)depth;
+    link->rxq_head = 0;
+    link->rxq_tail = 0;
+    link->rx_dropped = 0;
+    link->rx_lent = RT_FALSE;
+    rt_exit_critical();
+
+    return RT_EOK;
+}
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+/**
+ * @brief  Streams segmented receptions of a link to a callback chunk by chunk.
+ * @note   The sink is installed in the core through `_isotp_rtt_rx_sink`, which hands the
+ *         `isotp_rtt_link_t` to the user instead of the core link.
+ * @param  link The link handle.
+ * @param  sink The sink, or RT_NULL to assemble segmented PDUs in the receive buffer again.
+ * @param  arg User argument passed to `sink`.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid, -RT_EBUSY while a reception is streamed or a transaction is in progress.
+ */
+rt_err_t isotp_rtt_set_rx_sink(isotp_rtt_link_t link, isotp_rx_sink_cb sink, void *arg)
+{
+    rt_err_t ret = RT_EOK;
+
+    if (!link)
+        return -RT_EINVAL;
+
+    rt_enter_critical();
+    if ((link->link.receive_streaming && ISOTP_RECEIVE_STATUS_INPROGRESS == link->link.receive_status) || (sink && link->txn)
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+        || link->route
+#endif
+    )
+    {
+        ret = -RT_EBUSY;
+    }
+    else
+    {
+        link->rx_sink = sink;
+        link->rx_sink_arg = arg;
+        isotp_set_rx_sink_cb(&link->link, sink ? _isotp_rtt_rx_sink : RT_NULL, link);
+    }
+    rt_exit_critical();
+
+    return ret;
+}
+#endif
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+/**
+ * @brief  Forwards every PDU received on one link to another, cut-through.
+ * @note   The ingress link gets the route's sink and flow control policy; the egress link is
+ *         only used through its transmit queue.
+ * @param  route Storage for the route.
+ * @param  from The ingress link.
+ * @param  to The egress link.
+ * @param  fifo The buffer the payload passes through.
+ * @param  fifo_size Size of `fifo`.
+ * @return RT_EOK on success, -RT_EINVAL if an argument is invalid, -RT_EBUSY if `from` is routed, has a sink or is receiving.
+ */
+rt_err_t isotp_rtt_route_init(struct isotp_rtt_route *route, isotp_rtt_link_t from, isotp_rtt_link_t to, uint8_t *fifo, uint32_t fifo_size)
+{
+    rt_err_t ret = RT_EOK;
+
+    if (!route || !from || !to || from == to || !fifo)
+        return -RT_EINVAL;
+    /* A Single Frame is received into the staging buffer and forwarded from the FIFO in one piece. */
+    if (fifo_size < ISO_TP_MAX_FRAME_LEN || from->rx_buf_size < ISO_TP_MAX_FRAME_LEN - 1)
+    {
+        LOG_E("Route FIFO (%d bytes) or ingress receive buffer (%d bytes) too small.", fifo_size, from->rx_buf_size);
+        return -RT_EINVAL;
+    }
+
+    rt_enter_critical();
+    if (from->route || from->rx_sink || from->txn || ISOTP_RECEIVE_STATUS_INPROGRESS == from->link.receive_status)
+    {
+        ret = -RT_EBUSY;
+    }
+    else
+    {
+        rt_memset(route, 0, sizeof(*route));
+        route->from = from;
+        route->to = to;
+        route->fifo = fifo;
+        route->fifo_size = fifo_size;
+        route->state = ISOTP_RTT_ROUTE_IDLE;
+        route->fc_policy = from->link.fc_policy_cb;
+        route->fc_policy_arg = from->link.fc_policy_cb_arg;
+
+        to->route_refs++;
+        from->route = route;
+        from->rx_sink = _isotp_rtt_route_sink;
+        from->rx_sink_arg = route;
+        isotp_set_rx_sink_cb(&from->link, _isotp_rtt_rx_sink, from);
+        isotp_set_fc_policy_cb(&from->link, _isotp_rtt_route_fc_policy, route);
+    }
+    rt_exit_critical();
+
+    return ret;
+}
+
+/**
+ * @brief  Removes a route and gives the ingress link back to the application.
+ * @param  route The route.
+ * @return RT_EOK on success, -RT_EINVAL if the route is invalid, -RT_EBUSY while a PDU is being forwarded.
+ */
+rt_err_t isotp_rtt_route_detach(struct isotp_rtt_route *route)
+{
+    rt_err_t ret = RT_EOK;
+
+    if (!route || !route->from || route->from->route != route)
+        return -RT_EINVAL;
+
+    rt_enter_critical();
+    if (route->state != ISOTP_RTT_ROUTE_IDLE || ISOTP_RECEIVE_STATUS_INPROGRESS == route->from->link.receive_status)
+    {
+        ret = -RT_EBUSY;
+    }
+    else
+    {
+        isotp_set_fc_policy_cb(&route->from->link, route->fc_policy, route->fc_policy_arg);
+        isotp_set_rx_sink_cb(&route->from->link, RT_NULL, RT_NULL);
+        route->from->rx_sink = RT_NULL;
+        route->from->rx_sink_arg = RT_NULL;
+        route->from->route = RT_NULL;
+        route->to->route_refs--;
+    }
+    rt_exit_critical();
+
+    return ret;
+}
+#endif
+
+/**
+ * @brief  Sets the block size and STmin a link advertises in its flow control frames.
+ * @param  link The link handle.
+ * @param  block_size Consecutive frames per block, 0 for a single FC per PDU.
+ * @param  st_min_us STmin in microseconds, encoded as 100..900 us or whole milliseconds up to 127 ms.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid.
+ */
+rt_err_t isotp_rtt_set_rx_flow_control(isotp_rtt_link_t link, uint8_t block_size, uint32_t st_min_us)
+{
+    if (!link)
+        return -RT_EINVAL;
+
+    rt_enter_critical();
+    isotp_set_rx_flow_control(&link->link, block_size, st_min_us);
+    rt_exit_critical();
+    return RT_EOK;
+}
+
+/**
+ * @brief  Sets the transmit data length (TX_DL) of a link and its CAN FD frame options.
+ * @note   With TX_DL > 8 every frame of the link is sent in CAN FD format, and `brs` selects
+ *         bit rate switching. TX_DL 8 keeps classic CAN frames. The receive side follows the
+ *         peer's RX_DL automatically. This must not be called while a transmission is in progress.
+ * @param  link The link handle.
+ * @param  tx_dl 8, or one of 12, 16, 20, 24, 32, 48, 64 with PKG_ISOTP_C_USING_CANFD.
+ * @param  brs RT_TRUE to use bit rate switching in CAN FD frames.
+ * @return RT_EOK on success, -RT_EINVAL if the link or TX_DL is invalid, -RT_EBUSY if a transmission is in progress.
+ */
+rt_err_t isotp_rtt_set_tx_dl(isotp_rtt_link_t link, uint8_t tx_dl, rt_bool_t brs)
+{
+    if (!link)
+        return -RT_EINVAL;
+
+    rt_mutex_take(&link->send_mutex, RT_WAITING_FOREVER);
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_bool_t busy = link->tx_active || link->txq_head != link->txq_tail;
+    rt_hw_interrupt_enable(level);
+
+    int ret = busy ? ISOTP_RET_INPROGRESS : isotp_set_tx_dl(&link->link, tx_dl);
+    if (ret == ISOTP_RET_OK)
+    {
+        link->send_fd = tx_dl > 8;
+        link->send_brs = brs ? 1 : 0;
+    }
+    rt_mutex_release(&link->send_mutex);
+
+    if (ret == ISOTP_RET_INPROGRESS)
+        return -RT_EBUSY;
+    return ret == ISOTP_RET_OK ? RT_EOK : -RT_EINVAL;
+}
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief  Adaptive receiver flow control policy, installed by `isotp_rtt_set_adaptive_fc`.
+ * @note   Called before every FC frame of a reception. The next block is sized to fit into half of
+ *         the free RX ring space of the link's device, so one block can never overflow the ring while
+ *         an idle ring gets large blocks and few FC round trips. When the ring is half full STmin is
+ *         raised, at PKG_ISOTP_C_ADAPTIVE_FC_WAIT_PERCENT, or when the link's RX queue is full, the
+ *         sender is told to wait. Once the allowed FC.WAIT are used up the core sends CTS with BS 1.
+ */
+static uint8_t _isotp_rtt_adaptive_fc_policy(void *link, uint8_t *block_size, uint32_t *st_min_us, void *user_arg)
+{
+    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
+    struct isotp_rtt_port *port = _isotp_rtt_port_find(rtt_link->can_dev);
+
+    if (rtt_link->rxq_depth && rtt_link->rxq_head - rtt_link->rxq_tail >= rtt_link->rxq_depth)
+    {
+        *block_size = 1;
+        return PCI_FLOW_STATUS_WAIT;
+    }
+
+    /* Not attached, keep the configured values. */
+    if (!port)
+        return PCI_FLOW_STATUS_CONTINUE;
+
+    rt_uint32_t fill = port->head - port->tail;
+    rt_uint32_t bs = (PKG_ISOTP_C_RX_RING_SIZE - fill) / 2;
+
+    if (fill * 100 >= PKG_ISOTP_C_RX_RING_SIZE * PKG_ISOTP_C_ADAPTIVE_FC_WAIT_PERCENT)
+    {
+        *block_size = 1;
+        return PCI_FLOW_STATUS_WAIT;
+    }
+    if (fill * 100 >= PKG_ISOTP_C_RX_RING_SIZE * PKG_ISOTP_C_ADAPTIVE_FC_BUSY_PERCENT &&
+        *st_min_us < PKG_ISOTP_C_ADAPTIVE_FC_BUSY_ST_MIN_US)
+    {
+        *st_min_us = PKG_ISOTP_C_ADAPTIVE_FC_BUSY_ST_MIN_US;
+    }
+
+    *block_size = (uint8_t)(bs == 0 ? 1 : (bs > 0xFF ? 0xFF : bs));
+    return PCI_FLOW_STATUS_CONTINUE;
+}
+
+/**
+ * @brief  Attaches a CAN device to the adapter-owned RX path.
+ * @note   The device's current rx_indicate callback is saved and replaced by the adapter's
+ *         hook. The device must already be opened with RT_DEVICE_FLAG_INT_RX.
+ * @param  can_dev The CAN device to attach.
+ * @return RT_EOK on success, -RT_EINVAL for a NULL device, -RT_EBUSY if it is already
+ *         attached, -RT_EFULL if all PKG_ISOTP_C_MAX_CAN_PORTS slots (or all workers) are in use.
+ */
+rt_err_t isotp_rtt_port_attach(rt_device_t can_dev)
+{
+    if (!can_dev)
+        return -RT_EINVAL;
+    if (_isotp_rtt_port_find(can_dev))
+        return -RT_EBUSY;
+
+    struct isotp_rtt_port *port = _isotp_rtt_port_find(RT_NULL);
+    if (!port)
+    {
+        LOG_E("No free RX port for device:%s.", can_dev->parent.name);
+        return -RT_EFULL;
+    }
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    struct isotp_rtt_worker *worker = _isotp_rtt_worker_get(can_dev);
+    if (!worker)
+        return -RT_EFULL;
+#endif
+
+    rt_memset(port, 0, sizeof(struct isotp_rtt_port));
+    port->old_rx_indicate = can_dev->rx_indicate;
+    port->can_dev = can_dev;
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    port->worker = worker;
+    worker->port = port;
+#endif
+    rt_device_set_rx_indicate(can_dev, _isotp_rtt_port_rx_indicate);
+
+    LOG_I("RX port attached to device:%s", can_dev->parent.name);
+    return RT_EOK;
+}
+
+/**
+ * @brief  Detaches a CAN device from the adapter-owned RX path.
+ * @note   The rx_indicate callback saved by `isotp_rtt_port_attach` is restored.
+ *         Frames still in the ring are discarded.
+ * @param  can_dev The CAN device to detach.
+ * @return RT_EOK on success, -RT_EINVAL if the device is not attached.
+ */
+rt_err_t isotp_rtt_port_detach(rt_device_t can_dev)
+{
+    struct isotp_rtt_port *port = can_dev ? _isotp_rtt_port_find(can_dev) : RT_NULL;
+    if (!port)
+        return -RT_EINVAL;
+
+    rt_device_set_rx_indicate(can_dev, port->old_rx_indicate);
+
+    rt_enter_critical();
+    port->can_dev = RT_NULL;
+    port->tail = port->head;
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    port->worker->port = RT_NULL;
+#endif
+    rt_exit_critical();
+
+    LOG_I("RX port detached from device:%s", can_dev->parent.name);
+    return RT_EOK;
+}
+
+/**
+ * @brief  Reads the RX path counters of an attached CAN device.
+ * @param  can_dev The attached CAN device.
+ * @param  stats Output: a snapshot of the counters.
+ * @return RT_EOK on success, -RT_EINVAL if the device is not attached or `stats` is NULL.
+ */
+rt_err_t isotp_rtt_port_get_stats(rt_device_t can_dev, struct isotp_rtt_port_stats *stats)
+{
+    struct isotp_rtt_port *port = can_dev ? _isotp_rtt_port_find(can_dev) : RT_NULL;
+    if (!port || !stats)
+        return -RT_EINVAL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    *stats = port->stats;
+    rt_hw_interrupt_enable(level);
+    return RT_EOK;
+}
+
+/**
+ * @brief  Enables or disables the adaptive receiver flow control policy on a link.
+ * @param  link The link handle.
+ * @param  enable RT_TRUE to derive BS/STmin from the RX ring fill level, RT_FALSE to always
+ *         advertise the values set with `isotp_rtt_set_rx_flow_control`.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid, -RT_EBUSY if it is routed.
+ */
+rt_err_t isotp_rtt_set_adaptive_fc(isotp_rtt_link_t link, rt_bool_t enable)
+{
+    if (!link)
+        return -RT_EINVAL;
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    if (link->route)
+        return -RT_EBUSY;
+#endif
+
+    rt_enter_critical();
+    isotp_set_fc_policy_cb(&link->link, enable ? _isotp_rtt_adaptive_fc_policy : RT_NULL, link);
+    rt_exit_critical();
+    return RT_EOK;
+}
+#endif /* PKG_ISOTP_C_USING_RX_DISPATCHER */
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief  Sets the priority and CPU affinity of the worker thread of a CAN device, starting it if needed.
+ * @param  can_dev The CAN device.
+ * @param  priority The thread priority.
+ * @param  cpu The CPU to bind the worker to, -1 for none.
+ * @return RT_EOK on success, -RT_EINVAL for invalid arguments, -RT_EFULL if no worker is left.
  */
-static void _isotp_rtt_tx_done_cb(void *link_ptr, uint32_t size, void *user_arg)
+rt_err_t isotp_rtt_worker_config(rt_device_t can_dev, rt_uint8_t priority, rt_int8_t cpu)
 {
-    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
-    rt_event_send(&rtt_link->event, EVENT_FLAG_TX_DONE);
+    struct isotp_rtt_worker *worker;
+
+    if (!can_dev || priority >= RT_THREAD_PRIORITY_MAX)
+        return -RT_EINVAL;
+#ifdef RT_USING_SMP
+    if (cpu >= RT_CPUS_NR)
+        return -RT_EINVAL;
+#else
+    if (cpu > 0)
+        return -RT_EINVAL;
+#endif
+
+    worker = _isotp_rtt_worker_get(can_dev);
+    if (!worker)
+        return -RT_EFULL;
+
+    rt_thread_control(worker->thread, RT_THREAD_CTRL_CHANGE_PRIORITY, &priority);
+#ifdef RT_USING_SMP
+    /* Binding to RT_CPUS_NR removes the binding. */
+    rt_thread_control(worker->thread, RT_THREAD_CTRL_BIND_CPU, (void *)(rt_ubase_t)(cpu < 0 ? RT_CPUS_NR : cpu));
+#endif
+    return RT_EOK;
 }
+#endif /* PKG_ISOTP_C_USING_DEVICE_WORKERS */
 
+#ifdef PKG_ISOTP_C_USING_TX_RING
 /**
- * @brief  Called by isotp-c when a complete PDU has been received and assembled.
- * @note   This function only needs to record the final size and post an event to unblock
- *         any thread waiting in `isotp_rtt_receive`.
- * @param  link_ptr A pointer to the core IsoTpLink instance.
- * @param  data Pointer to the start of the received data.
- * @param  size The size of the fully assembled PDU.
- * @param  user_arg The user argument, which points to our isotp_rtt_link struct.
+ * @brief  Reads the TX ring counters of a CAN device.
+ * @param  can_dev The CAN device.
+ * @param  stats Output: a snapshot of the counters.
+ * @return RT_EOK on success, -RT_EINVAL if the device has no TX ring or `stats` is NULL.
  */
-static void _isotp_rtt_rx_done_cb(void *link_ptr, const uint8_t *data, uint32_t size, void *user_arg)
+rt_err_t isotp_rtt_tx_ring_get_stats(rt_device_t can_dev, struct isotp_rtt_tx_ring_stats *stats)
 {
-    struct isotp_rtt_link *rtt_link = (struct isotp_rtt_link *)user_arg;
-
-    uint16_t final_size = size;
-    rtt_link->rx_truncated = RT_FALSE;
+    if (!can_dev || !stats)
+        return -RT_EINVAL;
 
-    if (size > rtt_link->rx_buf_size)
+    for (int i = 0; i < PKG_ISOTP_C_MAX_TX_RINGS; i++)
     {
-        final_size = rtt_link->rx_buf_size;
-        rtt_link->rx_truncated = RT_TRUE;
-        LOG_W("RX buffer truncated! Link[0x%p] received %d bytes, but buffer size is %d.", rtt_link, size, rtt_link->rx_buf_size);
+        if (g_tx_rings[i].can_dev == can_dev)
+        {
+            rt_enter_critical();
+            *stats = g_tx_rings[i].stats;
+            rt_exit_critical();
+            return RT_EOK;
+        }
     }
-    rtt_link->rx_actual_size = final_size;
-    rt_event_send(&rtt_link->event, EVENT_FLAG_RX_DONE);
+    return -RT_EINVAL;
 }
-/** @} */
+#endif /* PKG_ISOTP_C_USING_TX_RING */
+
+#ifdef PKG_ISOTP_C_USING_STATS
+/**
+ * @brief  Reads the counters and latency histograms of a link.
+ * @param  link The link handle.
+ * @param  stats Output: a snapshot of the counters.
+ * @return RT_EOK on success, -RT_EINVAL if the link or `stats` is invalid.
+ */
+rt_err_t isotp_rtt_get_stats(isotp_rtt_link_t link, struct isotp_rtt_link_stats *stats)
+{
+    if (!link || !stats)
+        return -RT_EINVAL;
 
+    rt_enter_critical();
+    *stats = link->stats;
+    rt_exit_critical();
+    return RT_EOK;
+}
 
-/*************************************************************************************************/
-/** @name Internal Polling Thread
- *  @{
+/**
+ * @brief  Clears the counters and latency histograms of a link.
+ * @param  link The link handle.
+ * @return RT_EOK on success, -RT_EINVAL if the link is invalid.
  */
-/*************************************************************************************************/
+rt_err_t isotp_rtt_reset_stats(isotp_rtt_link_t link)
+{
+    if (!link)
+        return -RT_EINVAL;
 
+    rt_enter_critical();
+    rt_memset(&link->stats, 0, sizeof(link->stats));
+    rt_exit_critical();
+    return RT_EOK;
+}
+#endif /* PKG_ISOTP_C_USING_STATS */
+
+#ifdef PKG_ISOTP_C_USING_TRACE
 /**
- * @brief  The entry point for the background polling thread.
- * @note   This thread is crucial. It periodically calls `isotp_poll()` for every active
- *         link. `isotp_poll()` is responsible for handling all time-dependent aspects
- *         of the protocol, such as message timeouts and separation time delays (STmin).
- * @param  parameter Unused.
+ * @brief  Starts or stops recording into the frame trace ring.
+ * @param  enable RT_TRUE to record, RT_FALSE to freeze the current content.
  */
-static void _poll_thread_entry(void *parameter)
+void isotp_rtt_trace_enable(rt_bool_t enable)
 {
-    struct isotp_rtt_link *rtt_link, *next_rtt_link;
-    while (1)
-    {
-        rt_list_for_each_entry_safe(rtt_link, next_rtt_link, &g_link_list_head, node)
-        {
-            isotp_poll(&rtt_link->link);
-        }
-        rt_thread_mdelay(PKG_ISOTP_C_POLL_INTERVAL_MS);
-    }
+    g_trace_on = enable ? RT_TRUE : RT_FALSE;
 }
 
 /**
- * @brief  Auto-initialization function for the adapter layer.
- * @note   This function is called automatically by the RT-Thread INIT_APP_EXPORT mechanism.
- *         Its only job is to create and start the background polling thread.
- * @return RT_EOK on success, -RT_ERROR on failure.
+ * @brief  Discards every record of the frame trace ring.
  */
-static int _isotp_rtt_init(void)
+void isotp_rtt_trace_clear(void)
 {
-    rt_thread_t tid = rt_thread_create("isotp_poll",
-                                       _poll_thread_entry,
-                                       RT_NULL,
-                                       PKG_ISOTP_C_POLL_THREAD_STACK_SIZE,
-                                       PKG_ISOTP_C_POLL_THREAD_PRIORITY,
-                                       10);
-    if (tid)
-    {
-        rt_thread_startup(tid);
-    }
-    else
-    {
-        LOG_E("Failed to create isotp_poll thread.");
-        return -RT_ERROR;
-    }
-    return RT_EOK;
+    rt_base_t level = rt_hw_interrupt_disable();
+    g_trace_head = 0;
+    rt_hw_interrupt_enable(level);
 }
-INIT_APP_EXPORT(_isotp_rtt_init);
+#endif /* PKG_ISOTP_C_USING_TRACE */
 /** @} */
 
 
+#if defined(RT_USING_FINSH) && defined(PKG_ISOTP_C_USING_STATS)
 /*************************************************************************************************/
-/** @name Public API Implementation
+/** @name Shell Commands
  *  @{
- *  @brief The public functions exposed to the user application.
  */
 /*************************************************************************************************/
 
 /**
- * @brief  Processes a received CAN message.
- * @warning This function MUST be called from a thread context (e.g., a workqueue or a dedicated
- *          consumer thread), NOT from a CAN ISR. This is because `isotp_on_can_message` may
- *          trigger an immediate transmission (e.g., a Flow Control frame), which is a
- *          blocking operation unsuitable for an ISR.
- * @param  msg A pointer to the received `rt_can_msg` structure.
+ * @brief  Prints the non-empty buckets of a latency histogram on one line.
  */
-void isotp_rtt_on_can_msg_received(struct rt_can_msg *msg)
+static void _isotp_stat_print_hist(const char *title, const rt_uint32_t *hist)
 {
-    struct isotp_rtt_link *rtt_link, *next_rtt_link;
-
-#if (DBG_LVL >= DBG_LOG)
-    {
-        char title_buf[32];
-        rt_snprintf(title_buf, sizeof(title_buf), "[RX] ID: 0x%X", msg->id);
-        print_hex_data(title_buf, msg->data, msg->len);
-    }
-#endif
-
-    /* Iterate through all active links and dispatch the message to any link listening on this ID. */
-    rt_list_for_each_entry_safe(rtt_link, next_rtt_link, &g_link_list_head, node)
+    rt_kprintf("  %-8s", title);
+    for (int i = 0; i < PKG_ISOTP_C_STATS_HIST_BUCKETS; i++)
     {
-        if (rtt_link->recv_arbitration_id == msg->id)
-        {
-            isotp_on_can_message(&rtt_link->link, msg->data, msg->len);
-            /* Do not break; multiple links might be listening to the same ID. */
-        }
+        if (!hist[i])
+            continue;
+        if (i < PKG_ISOTP_C_STATS_HIST_BUCKETS - 1)
+            rt_kprintf(" <%uus:%u", (rt_uint32_t)ISOTP_RTT_STATS_HIST_BASE_US << i, hist[i]);
+        else
+            rt_kprintf(" >=%uus:%u", (rt_uint32_t)ISOTP_RTT_STATS_HIST_BASE_US << (i - 1), hist[i]);
     }
+    rt_kprintf("\n");
 }
 
 /**
- * @brief  Creates and initializes a new ISO-TP link instance.
- * @param  can_dev The user-opened RT-Thread CAN device handle.
- * @param  send_arbitration_id The CAN ID to use for sending.
- * @param  recv_arbitration_id The CAN ID to listen for.
- * @param  send_ide CAN ID type (RT_CAN_STDID or RT_CAN_EXTID).
- * @param  send_rtr CAN frame type (RT_CAN_DTR or RT_CAN_RTR).
- * @param  send_buf User-provided buffer for outgoing PDUs.
- * @param  send_buf_size Size of the send buffer.
- * @param  recv_buf User-provided buffer for incoming PDUs.
- * @param  recv_buf_size Size of the receive buffer.
- * @return A handle to the new link, or RT_NULL on failure.
+ * @brief  Shell command printing the statistics of every link, `isotp_stat reset` clears them.
  */
-isotp_rtt_link_t isotp_rtt_create(rt_device_t can_dev,
-                                  uint32_t send_arbitration_id,
-                                  uint32_t recv_arbitration_id,
-                                  rt_uint8_t send_ide,
-                                  rt_uint8_t send_rtr,
-                                  uint8_t *send_buf,
-                                  uint16_t send_buf_size,
-                                  uint8_t *recv_buf,
-                                  uint16_t recv_buf_size)
+static int isotp_stat(int argc, char **argv)
 {
-    if (!can_dev)
+    struct isotp_rtt_link *rtt_link;
+    struct isotp_rtt_link_stats st;
+    rt_bool_t reset = (argc > 1 && rt_strcmp(argv[1], "reset") == 0);
+    int index = 0;
+
+    if (argc > 1 && !reset)
     {
-        LOG_E("CAN device handle cannot be NULL.");
-        return RT_NULL;
+        rt_kprintf("Usage: isotp_stat [reset]\n");
+        return -RT_EINVAL;
     }
 
-    struct isotp_rtt_link *rtt_link = rt_malloc(sizeof(struct isotp_rtt_link));
-    if (!rtt_link)
+    rt_mutex_take(&g_link_lock, RT_WAITING_FOREVER);
+    rt_list_for_each_entry(rtt_link, &g_link_list_head, node)
     {
-        LOG_E("Failed to allocate memory for rtt_link.");
-        return RT_NULL;
-    }
-    rt_memset(rtt_link, 0, sizeof(struct isotp_rtt_link));
+        if (reset)
+        {
+            isotp_rtt_reset_stats(rtt_link);
+            continue;
+        }
 
-    rtt_link->can_dev = can_dev;
-    rtt_link->recv_arbitration_id = recv_arbitration_id;
-    rtt_link->send_ide = send_ide;
-    rtt_link->send_rtr = send_rtr;
-    rtt_link->rx_buf_ptr = recv_buf;
-    rtt_link->rx_buf_size = recv_buf_size;
+        isotp_rtt_get_stats(rtt_link, &st);
+        rt_kprintf("link %d [%.*s] tx 0x%X rx 0x%X\n", index++, RT_NAME_MAX, rtt_link->can_dev->parent.name,
+                   rtt_link->link.send_arbitration_id, rtt_link->recv_arbitration_id);
+        rt_kprintf("  tx      frames %u nospace %u write_errors %u pdus %u bytes %u failed %u timeout_bs %u fc_wait %u\n",
+                   st.tx_frames, st.tx_nospace, st.tx_write_errors, st.tx_pdus, st.tx_bytes, st.tx_failed, st.tx_timeout_bs, st.fc_wait);
+        rt_kprintf("  rx      frames %u pdus %u bytes %u timeout_cr %u wrong_sn %u truncated %u dropped %u\n",
+                   st.rx_frames, st.rx_pdus, st.rx_bytes, st.rx_timeout_cr, st.rx_wrong_sn, st.rx_truncated, st.rx_dropped);
+        _isotp_stat_print_hist("tx time", st.tx_time_hist);
+        _isotp_stat_print_hist("rx time", st.rx_time_hist);
+        _isotp_stat_print_hist("fc rtt", st.fc_rtt_hist);
+    }
+    rt_mutex_release(&g_link_lock);
 
-    char event_name[RT_NAME_MAX];
-    char mutex_name[RT_NAME_MAX];
-    rt_snprintf(event_name, RT_NAME_MAX, "isotp_evt_%lx", recv_arbitration_id);
-    rt_snprintf(mutex_name, RT_NAME_MAX, "isotp_tx_mtx_%lx", send_arbitration_id);
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    for (int i = 0; i < PKG_ISOTP_C_MAX_TX_RINGS; i++)
+    {
+        struct isotp_rtt_tx_ring *ring = &g_tx_rings[i];
+        if (!ring->can_dev)
+            continue;
+        if (reset)
+        {
+            rt_enter_critical();
+            rt_memset(&ring->stats, 0, sizeof(ring->stats));
+            rt_exit_critical();
+            continue;
+        }
+        rt_kprintf("tx ring [%.*s] frames %u dropped %u\n", RT_NAME_MAX, ring->can_dev->parent.name,
+                   ring->stats.tx_frames, ring->stats.tx_dropped);
+    }
+#endif
 
-    rt_event_init(&rtt_link->event, event_name, RT_IPC_FLAG_FIFO);
-    rtt_link->send_mutex = rt_mutex_create(mutex_name, RT_IPC_FLAG_FIFO);
+    if (reset)
+        rt_kprintf("ISO-TP link statistics cleared.\n");
+    else if (index == 0)
+        rt_kprintf("No ISO-TP links.\n");
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(isotp_stat, Show ISO-TP link statistics: isotp_stat [reset]);
+/** @} */
+#endif /* RT_USING_FINSH && PKG_ISOTP_C_USING_STATS */
 
-    isotp_init_link(&rtt_link->link, send_arbitration_id, send_buf, send_buf_size, recv_buf, recv_buf_size);
-    rtt_link->link.user_send_can_arg = rtt_link;
 
-    isotp_set_tx_done_cb(&rtt_link->link, _isotp_rtt_tx_done_cb, rtt_link);
-    isotp_set_rx_done_cb(&rtt_link->link, _isotp_rtt_rx_done_cb, rtt_link);
+#if defined(RT_USING_FINSH) && defined(PKG_ISOTP_C_USING_TRACE)
+/*************************************************************************************************/
+/** @name Trace Export
+ *  @{
+ *  @brief Printing of the frame trace ring as a candump log or a Vector ASC file.
+ */
+/*************************************************************************************************/
 
-    rt_list_insert_after(&g_link_list_head, &rtt_link->node);
+/**
+ * @brief  Returns the name of a core send or receive status for trace comments.
+ */
+static const char *_isotp_trace_status_name(rt_uint8_t tx, rt_uint8_t status)
+{
+    static const char *const send_names[] = {"IDLE", "INPROGRESS", "ERROR"};
+    static const char *const receive_names[] = {"IDLE", "INPROGRESS", "FULL"};
 
-    LOG_I("ISO-TP link created for device:%s, SID:0x%X, RID:0x%X", can_dev->parent.name, send_arbitration_id, recv_arbitration_id);
-    return rtt_link;
+    if (status > 2)
+        return "?";
+    return tx ? send_names[status] : receive_names[status];
 }
 
 /**
- * @brief  Destroys an ISO-TP link and releases its resources.
- * @param  link The link handle to destroy.
+ * @brief  Returns the DLC code of a CAN FD frame length.
  */
-void isotp_rtt_destroy(isotp_rtt_link_t link)
+static rt_uint8_t _isotp_trace_dlc(rt_uint8_t len)
 {
-    if (!link)
-        return;
-    rt_list_remove(&link->node);
-    rt_event_detach(&link->event);
-    rt_mutex_delete(link->send_mutex);
-    rt_free(link);
-    LOG_I("ISO-TP link destroyed.");
+    static const rt_uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+    rt_uint8_t dlc = 9;
+
+    if (len <= 8)
+        return len;
+    for (int i = 0; i < 6 && len > fd_len[i]; i++)
+        dlc++;
+    return dlc;
 }
 
 /**
- * @brief Sends an ISO-TP message in a blocking manner.
- * @note  This function initiates a transmission and then blocks the calling thread
- *        until the entire message is successfully sent or an error/timeout occurs.
- * @param  link The link handle.
- * @param  payload Pointer to the data to send.
- * @param  size Size of the data.
- * @param  timeout Timeout in system ticks.
- * @return Returns ISOTP_RET_OK on success.
- * @retval ISOTP_RET_TIMEOUT_RTT on timeout.
- * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
- * @retval Other ISOTP_RET_* codes for protocol-level errors.
+ * @brief  Prints one trace record, as a candump log line or as an ASC line on channel `channel`.
+ * @note   State transitions have no representation in either format and are written as comments.
  */
-int isotp_rtt_send(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size, rt_int32_t timeout)
+static void _isotp_trace_print(const struct isotp_rtt_trace_rec *rec, rt_bool_t asc, int channel)
 {
-    int ret = ISOTP_RET_OK;
-    if (!link)
-        return ISOTP_RET_INVAL_ARGS;
-
-    rt_uint32_t recved_evt;
-
-    rt_mutex_take(link->send_mutex, RT_WAITING_FOREVER);
+    const char *dev_name = rec->dev ? rec->dev->parent.name : "can";
+    rt_uint8_t n = rec->len > sizeof(rec->data) ? sizeof(rec->data) : rec->len;
+    rt_uint32_t sec = rec->time_us / 1000000, usec = rec->time_us % 1000000;
 
-    /* Clear any stale events before starting a new operation. */
-    rt_event_recv(&link->event, EVENT_FLAG_TX_DONE | EVENT_FLAG_ERROR | EVENT_FLAG_RX_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, 0, &recved_evt);
+    if (rec->flags & ISOTP_RTT_TRACE_STATE)
+    {
+        rt_kprintf("%s %u.%06u %.*s 0x%X %s %s -> %s result %d\n",
+                   asc ? "//" : "#", sec, usec, RT_NAME_MAX, dev_name,
+                   rec->id, (rec->flags & ISOTP_RTT_TRACE_TX) ? "tx" : "rx",
+                   _isotp_trace_status_name(rec->flags & ISOTP_RTT_TRACE_TX, rec->data[0]),
+                   _isotp_trace_status_name(rec->flags & ISOTP_RTT_TRACE_TX, rec->data[1]), (rt_int8_t)rec->data[2]);
+        return;
+    }
 
-    ret = isotp_send(&link->link, payload, size);
-    if (ret != ISOTP_RET_OK)
+    if (!asc)
+    {
+        /* (time) dev ID#DATA, ID##<flags>DATA for CAN FD, ID#R for remote frames */
+        rt_kprintf((rec->flags & ISOTP_RTT_TRACE_IDE) ? "(%u.%06u) %.*s %08X#" : "(%u.%06u) %.*s %03X#", sec, usec, RT_NAME_MAX,
+                   dev_name, rec->id);
+        if (rec->flags & ISOTP_RTT_TRACE_FD)
+            rt_kprintf("#%X", (rec->flags & ISOTP_RTT_TRACE_BRS) ? 1 : 0);
+        else if (rec->flags & ISOTP_RTT_TRACE_RTR)
+            rt_kprintf("R");
+    }
+    else if (rec->flags & ISOTP_RTT_TRACE_FD)
     {
-        LOG_E("isotp_send failed immediately with code: %d", ret);
+        rt_kprintf("%11u.%06u CANFD %3d %s %8X%s %d 0 %x %2d", sec, usec, channel, (rec->flags & ISOTP_RTT_TRACE_TX) ? "Tx" : "Rx",
+                   rec->id, (rec->flags & ISOTP_RTT_TRACE_IDE) ? "x" : " ", (rec->flags & ISOTP_RTT_TRACE_BRS) ? 1 : 0,
+                   _isotp_trace_dlc(rec->len), rec->len);
     }
     else
     {
-        if (rt_event_recv(&link->event, EVENT_FLAG_TX_DONE | EVENT_FLAG_ERROR, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, timeout, &recved_evt) != RT_EOK)
-        {
-            LOG_W("isotp_rtt_send timeout.");
-            ret = ISOTP_RET_TIMEOUT_RTT;
-        }
-        else if (recved_evt & EVENT_FLAG_ERROR)
-        {
-            LOG_E("isotp_rtt_send failed with an internal error event.");
-            ret = ISOTP_RET_ERROR_RTT;
-        }
+        rt_kprintf("%11u.%06u %d  %X%s %s %s %d", sec, usec, channel, rec->id, (rec->flags & ISOTP_RTT_TRACE_IDE) ? "x" : "",
+                   (rec->flags & ISOTP_RTT_TRACE_TX) ? "Tx" : "Rx", (rec->flags & ISOTP_RTT_TRACE_RTR) ? "r" : "d", rec->len);
     }
 
-    rt_mutex_release(link->send_mutex);
-    return ret;
+    for (rt_uint8_t i = 0; i < n; i++)
+        rt_kprintf(asc ? " %02X" : "%02X", rec->data[i]);
+    rt_kprintf("\n");
 }
 
 /**
- * @brief Sends an ISO-TP message in a non-blocking manner ("fire and forget").
- * @note  This function queues the message for transmission and returns immediately.
- *        It does not wait for the transmission to complete. The user cannot know
- *        the final status of the transmission when using this function.
- *        It is suitable for applications that send data periodically without needing
- *        an immediate acknowledgment of transmission completion.
- * @param  link The link handle.
- * @param  payload Pointer to the data to send.
- * @param  size Size of the data.
- * @return Returns ISOTP_RET_OK if the message was successfully queued for sending.
- * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
- * @retval Other ISOTP_RET_* codes if the message could not be queued (e.g., another send is already in progress).
+ * @brief  Shell command dumping the frame trace ring, oldest record first.
+ * @note   Recording is paused while dumping, so that the printed records are not overwritten.
+ *         `isotp_trace` writes a candump log (`canplayer`/`can-utils` compatible), `isotp_trace asc`
+ *         a Vector ASC file; `on`, `off` and `clear` control the recording.
  */
-int isotp_rtt_send_nonblocking(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size)
+static int isotp_trace(int argc, char **argv)
 {
-    int ret = ISOTP_RET_OK;
-    if (!link)
-        return ISOTP_RET_INVAL_ARGS;
+    rt_device_t channels[8] = {RT_NULL};
+    rt_bool_t asc = RT_FALSE;
 
-    /*
-     * To ensure non-blocking behavior, we use a non-blocking mutex take (`timeout = 0`).
-     * This attempts to acquire the lock. If another send operation (blocking or non-blocking)
-     * is already in progress, it will fail immediately instead of waiting.
-     */
-    if (rt_mutex_take(link->send_mutex, 0) != RT_EOK)
+    if (argc > 1)
     {
-        /*
-         * Another send is already in progress on this link. Return a specific error
-         * to indicate that the resource is busy.
-         */
-        return ISOTP_RET_INPROGRESS;
+        if (rt_strcmp(argv[1], "on") == 0 || rt_strcmp(argv[1], "off") == 0)
+        {
+            isotp_rtt_trace_enable(rt_strcmp(argv[1], "on") == 0);
+            return RT_EOK;
+        }
+        if (rt_strcmp(argv[1], "clear") == 0)
+        {
+            isotp_rtt_trace_clear();
+            return RT_EOK;
+        }
+        if (rt_strcmp(argv[1], "asc") != 0)
+        {
+            rt_kprintf("Usage: isotp_trace [asc|on|off|clear]\n");
+            return -RT_EINVAL;
+        }
+        asc = RT_TRUE;
     }
 
-    /* Clear stale events. */
-    rt_uint32_t recved_evt;
-    rt_event_recv(&link->event, EVENT_FLAG_TX_DONE | EVENT_FLAG_ERROR | EVENT_FLAG_RX_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, 0, &recved_evt);
-    
-    /*
-     * Call the core library's send function.
-     */
-    ret = isotp_send(&link->link, payload, size);
-    
-    /*
-     * IMPORTANT: We immediately release the mutex. The actual CAN frames will be sent
-     * in the background by the isotp_poll thread. This function returns now,
-     * without waiting for the TX_DONE event. If isotp_send() fails immediately
-     * (e.g., wrong length), that error code will be returned. Otherwise, it will
-     * return ISOTP_RET_OK, meaning the message is *queued*.
-     */
-    rt_mutex_release(link->send_mutex);
-    return ret;
-}
-
-/**
- * @brief  Receives an ISO-TP message in a blocking manner.
- * @note   This function blocks the calling thread by waiting for the `EVENT_FLAG_RX_DONE` event,
- *         which is posted by the `_isotp_rtt_rx_done_cb` callback when a complete PDU
- *         has been assembled into the link's internal buffer. It then copies the data
- *         from the internal buffer to the user-provided `payload_buf`.
- * @param  link The link handle.
- * @param  payload_buf Buffer to store the received data.
- * @param  buf_size Size of the `payload_buf`.
- * @param  out_size Pointer to store the actual size of the received data.
- * @param  timeout Timeout in system ticks.
- * @return RT_EOK on success, -RT_EFULL if the PDU was truncated, -RT_ENOMEM if `payload_buf` is too small,
- *         -RT_ETIMEOUT on timeout, -RT_ERROR on other failures.
- */
-rt_err_t isotp_rtt_receive(isotp_rtt_link_t link, uint8_t *payload_buf, uint16_t buf_size, uint16_t *out_size, rt_int32_t timeout)
-{
-    if (!link || !payload_buf || !out_size)
-        return -RT_EINVAL;
+    rt_uint8_t was_on = g_trace_on;
+    g_trace_on = RT_FALSE;
 
-    rt_uint32_t recved_evt;
-    if (rt_event_recv(&link->event, EVENT_FLAG_RX_DONE | EVENT_FLAG_ERROR, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, timeout, &recved_evt) != RT_EOK)
-    {
-        *out_size = 0;
-        return -RT_ETIMEOUT;
-    }
+    rt_uint32_t head = g_trace_head;
+    rt_uint32_t count = head > PKG_ISOTP_C_TRACE_DEPTH ? PKG_ISOTP_C_TRACE_DEPTH : head;
 
-    if (recved_evt & EVENT_FLAG_RX_DONE)
+    if (asc)
+        rt_kprintf("base hex  timestamps absolute\n");
+    for (rt_uint32_t i = head - count; i != head; i++)
     {
-        uint16_t copy_size = link->rx_actual_size;
+        const struct isotp_rtt_trace_rec *rec = &g_trace[i & (PKG_ISOTP_C_TRACE_DEPTH - 1)];
+        int channel = 1;
 
-        if (copy_size > buf_size)
+        /* ASC channels are numbered from 1 in the order the devices first appear */
+        if (asc)
         {
-            LOG_E("User receive buffer is too small! Required: %d, Provided: %d", copy_size, buf_size);
-            *out_size = 0;
-            return -RT_ENOMEM;
+            while (channel < 8 && channels[channel - 1] && channels[channel - 1] != rec->dev)
+                channel++;
+            channels[channel - 1] = rec->dev;
         }
-
-        rt_memcpy(payload_buf, link->rx_buf_ptr, copy_size);
-        *out_size = copy_size;
-        return link->rx_truncated ? -RT_EFULL : RT_EOK;
-    }
-    else /* (recved_evt & EVENT_FLAG_ERROR) */
-    {
-        *out_size = 0;
-        return -RT_ERROR;
+        _isotp_trace_print(rec, asc, channel);
     }
+    if (asc)
+        rt_kprintf("// %u records\n", count);
+    else
+        rt_kprintf("# %u records\n", count);
+
+    g_trace_on = was_on;
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(isotp_trace, Dump the ISO-TP frame trace: isotp_trace [asc|on|off|clear]);
 /** @} */
+#endif /* RT_USING_FINSH && PKG_ISOTP_C_USING_TRACE */
@@ -29,31 +29,296 @@
  * @name RT-Thread Adapter Specific Return Codes
  * @{
  * @brief These codes are returned by the adapter layer functions and supplement
- *        the standard ISOTP_RET_* codes from the core library.
+ *        the standard ISOTP_RET_* codes from the core library. They are numbered below
+ *        the core codes so that e.g. ISOTP_RET_NOSPACE (queue full) stays distinguishable.
  */
-#define ISOTP_RET_INVAL_ARGS   -8  ///< Invalid arguments passed to the function (e.g., NULL link).
-#define ISOTP_RET_TIMEOUT_RTT  -9  ///< Operation timed out (RT-Thread specific timeout).
-#define ISOTP_RET_ERROR_RTT    -10 ///< An internal adapter-level error occurred.
+#define ISOTP_RET_INVAL_ARGS   -11 ///< Invalid arguments passed to the function (e.g., NULL link).
+#define ISOTP_RET_TIMEOUT_RTT  -12 ///< Operation timed out (RT-Thread specific timeout).
+#define ISOTP_RET_ERROR_RTT    -13 ///< An internal adapter-level error occurred.
 /** @} */
 
 
 /**
  * @brief Handle to an ISO-TP link instance.
- * @note  This is an opaque pointer; users should not attempt to access its members directly.
+ * @note  Users should not attempt to access its members directly.
  */
 typedef struct isotp_rtt_link* isotp_rtt_link_t;
 
+/**
+ * @brief Completion callback of `isotp_rtt_send_async`.
+ *
+ * Called exactly once per queued PDU, from the adapter's polling or RX thread (or from the
+ * calling thread for a Single Frame sent straight away). It must not block.
+ *
+ * @param link   The link the PDU was sent on.
+ * @param result The final status, one of the ISOTP_PROTOCOL_RESULT_* codes:
+ *               ISOTP_PROTOCOL_RESULT_OK, ISOTP_PROTOCOL_RESULT_TIMEOUT_BS, ISOTP_PROTOCOL_RESULT_WFT_OVRN,
+ *               ISOTP_PROTOCOL_RESULT_INVALID_FS, ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW or ISOTP_PROTOCOL_RESULT_ERROR.
+ * @param arg    The user argument given to `isotp_rtt_send_async`.
+ */
+typedef void (*isotp_rtt_tx_cb_t)(isotp_rtt_link_t link, int result, void* arg);
+
+struct isotp_rtt_txn;
+struct isotp_rtt_worker;
+struct isotp_rtt_tx_ring;
+
+/**
+ * @brief Completion callback of `isotp_rtt_transact_async`.
+ *
+ * Called exactly once per started transaction, from the adapter's polling or RX thread (or from
+ * the calling thread if the request fails straight away). It must not block, but it may start
+ * the next transaction on the link.
+ *
+ * @param link The link the transaction ran on.
+ * @param txn  The transaction, with `result`, `response_size`, `pending` and `elapsed_us` set.
+ * @param arg  The user argument given to `isotp_rtt_transact_async`.
+ */
+typedef void (*isotp_rtt_txn_cb_t)(isotp_rtt_link_t link, struct isotp_rtt_txn* txn, void* arg);
+
+#if defined(ISO_TP_DISABLE_TRANSMIT) || defined(ISO_TP_DISABLE_RECEIVE)
+#error "The RT-Thread adapter needs both directions of the isotp-c core, use PKG_ISOTP_C_COMPACT_LINK to save RAM instead"
+#endif
+
+#ifndef PKG_ISOTP_C_TX_QUEUE_DEPTH
+#define PKG_ISOTP_C_TX_QUEUE_DEPTH 4    ///< Number of PDUs that can be queued for transmission per link.
+#endif
+
+/**
+ * @name Link Storage Types
+ * @{
+ */
+#define ISOTP_RTT_LINK_ALLOC_STATIC 0   ///< Caller-provided storage, set up by `isotp_rtt_init`.
+#define ISOTP_RTT_LINK_ALLOC_HEAP   1   ///< Allocated by `isotp_rtt_create` with rt_malloc.
+#define ISOTP_RTT_LINK_ALLOC_POOL   2   ///< Taken by `isotp_rtt_create` from the static link pool.
+/** @} */
+
+/**
+ * @name Fixed Addressing CAN IDs
+ * @{
+ * @brief 29-bit CAN IDs of normal fixed and mixed addressing (ISO 15765-2, priority 6), built from
+ *        the target address `ta` (N_TA) and the source address `sa` (N_SA) of a frame.
+ */
+#define ISOTP_RTT_NORMAL_FIXED_PHYS_ID(ta, sa) (0x18DA0000UL | ((uint32_t)(uint8_t)(ta) << 8) | (uint8_t)(sa)) ///< Normal fixed, physical.
+#define ISOTP_RTT_NORMAL_FIXED_FUNC_ID(ta, sa) (0x18DB0000UL | ((uint32_t)(uint8_t)(ta) << 8) | (uint8_t)(sa)) ///< Normal fixed, functional.
+#define ISOTP_RTT_MIXED_PHYS_ID(ta, sa)        (0x18CE0000UL | ((uint32_t)(uint8_t)(ta) << 8) | (uint8_t)(sa)) ///< Mixed, physical.
+#define ISOTP_RTT_MIXED_FUNC_ID(ta, sa)        (0x18CD0000UL | ((uint32_t)(uint8_t)(ta) << 8) | (uint8_t)(sa)) ///< Mixed, functional.
+/** @} */
+
+#ifdef PKG_ISOTP_C_USING_STATS
+#ifndef PKG_ISOTP_C_STATS_HIST_BUCKETS
+#define PKG_ISOTP_C_STATS_HIST_BUCKETS 14   ///< Number of buckets of each latency histogram.
+#endif
+#define ISOTP_RTT_STATS_HIST_BASE_US 256    ///< Upper bound of histogram bucket 0, each further bucket doubles it.
+
+/**
+ * @brief Per-link counters and latency histograms, see `isotp_rtt_get_stats`.
+ *
+ * Histogram bucket 0 counts samples below ISOTP_RTT_STATS_HIST_BASE_US, bucket i samples below
+ * ISOTP_RTT_STATS_HIST_BASE_US << i, and the last bucket everything longer.
+ */
+struct isotp_rtt_link_stats
+{
+    rt_uint32_t tx_frames;          ///< CAN frames (SF, FF, CF, FC) accepted by the CAN device.
+    rt_uint32_t tx_nospace;         ///< CAN frames the TX ring had no room for (ISOTP_RET_NOSPACE), sent again later.
+    rt_uint32_t tx_write_errors;    ///< CAN frames `rt_device_write` refused, their transmission is aborted.
+    rt_uint32_t tx_pdus;            ///< PDUs sent successfully.
+    rt_uint32_t tx_bytes;           ///< Payload bytes of `tx_pdus`.
+    rt_uint32_t tx_failed;          ///< PDUs that completed with an error.
+    rt_uint32_t tx_timeout_bs;      ///< Transmissions aborted by ISOTP_PROTOCOL_RESULT_TIMEOUT_BS.
+    rt_uint32_t fc_wait;            ///< FC.WAIT frames received while sending.
+    rt_uint32_t rx_frames;          ///< CAN frames delivered to the link.
+    rt_uint32_t rx_pdus;            ///< PDUs received completely.
+    rt_uint32_t rx_bytes;           ///< Payload bytes of `rx_pdus`.
+    rt_uint32_t rx_timeout_cr;      ///< Receptions aborted by ISOTP_PROTOCOL_RESULT_TIMEOUT_CR.
+    rt_uint32_t rx_wrong_sn;        ///< Receptions aborted by ISOTP_PROTOCOL_RESULT_WRONG_SN.
+    rt_uint32_t rx_truncated;       ///< PDUs truncated to the receive buffer size.
+    rt_uint32_t rx_dropped;         ///< PDUs dropped because no receive buffer was free.
+    rt_uint32_t tx_time_hist[PKG_ISOTP_C_STATS_HIST_BUCKETS]; ///< Duration of segmented transmissions, FF to last CF.
+    rt_uint32_t rx_time_hist[PKG_ISOTP_C_STATS_HIST_BUCKETS]; ///< Duration of segmented receptions, FF to last CF.
+    rt_uint32_t fc_rtt_hist[PKG_ISOTP_C_STATS_HIST_BUCKETS];  ///< Time from the FF or last CF of a block to the peer's FC.
+};
+#endif /* PKG_ISOTP_C_USING_STATS */
+
+/**
+ * @brief A PDU waiting in a link's transmit queue.
+ */
+struct isotp_rtt_tx_req
+{
+    const uint8_t* payload;         ///< The caller's payload, copied into the send buffer when the request starts.
+    isotp_rtt_tx_cb_t cb;           ///< Completion callback, may be RT_NULL.
+    void* cb_arg;                   ///< Argument passed to `cb`.
+#ifdef ISO_TP_STREAMING_SEND
+    isotp_tx_source_cb source;      ///< Payload source of a streaming request, RT_NULL once it was abandoned.
+    void* source_arg;               ///< Argument passed to `source`.
+    uint32_t stream_size;           ///< The size of a streaming request (payload from `source`), 0 otherwise.
+#endif
+    uint16_t size;                  ///< The size of the payload.
+    rt_uint8_t cancelled;           ///< Set if the request was withdrawn before it started.
+};
+
+/**
+ * @brief Structure representing a single ISO-TP link instance tailored for RT-Thread.
+ *
+ * This structure encapsulates the core IsoTpLink object and adds RT-Thread specific
+ * resources like events for synchronization and mutexes for thread safety.
+ * It is only public so that links can live in caller-provided storage (see `isotp_rtt_init`);
+ * its members are private to the adapter.
+ *
+ * Members are ordered by size so that no padding is needed between them, with the list nodes
+ * the polling and RX threads walk next to the core link. Flags are single bytes.
+ */
+struct isotp_rtt_link
+{
+    IsoTpLink link;                 ///< The underlying isotp-c library link instance.
+    struct rt_list_node node;       ///< Node for linking this instance into the global list of links.
+    struct rt_list_node hash_node;  ///< Node for linking this instance into its RX dispatch table bucket.
+    struct rt_list_node active_node; ///< Node in the active list of its polling thread, self-linked while the link is idle.
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+    struct isotp_rtt_worker* worker; ///< The worker of `can_dev`.
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    struct isotp_rtt_tx_ring* tx_ring; ///< The TX ring of `can_dev`.
+    struct rt_list_node tx_stall_node; ///< Node in the stalled list of `tx_ring` while `tx_stalled` is set.
+#endif
+#ifdef ISO_TP_USER_SEND_CAN_ALLOC
+    struct rt_can_msg tx_msg;       ///< Message the core formats single, first and consecutive frames in.
+    struct rt_can_msg fc_msg;       ///< Message the core formats flow control frames in.
+#endif
+    rt_device_t can_dev;            ///< The associated RT-Thread CAN device for this link.
+    uint32_t recv_arbitration_id;   ///< The CAN arbitration ID this link listens to for incoming messages.
+
+    /* Transmit queue, the request at `txq_tail` is the one in progress while `tx_active` is set */
+    struct isotp_rtt_tx_req txq[PKG_ISOTP_C_TX_QUEUE_DEPTH]; ///< Pending PDUs, each referencing the caller's payload.
+    rt_uint32_t txq_head;           ///< Free-running write index, advanced when a PDU is queued.
+    rt_uint32_t txq_tail;           ///< Free-running read index, advanced when a PDU completes or is skipped.
+    int tx_result;                  ///< Final status of the last PDU sent with `isotp_rtt_send`.
+    rt_uint32_t tx_seq;             ///< Sequence number of the last blocking send, never 0.
+    volatile rt_uint32_t tx_wait_seq; ///< Sequence number the blocking sender waits for, 0 if none.
+
+    /* Transaction in progress, see `isotp_rtt_transact_async` */
+    struct isotp_rtt_txn* txn;      ///< The transaction receiving the next PDU, RT_NULL if none.
+    uint32_t txn_start_us;          ///< Time the transaction was started.
+    volatile uint32_t txn_deadline_us; ///< Time the response is due by, valid in ISOTP_RTT_TXN_WAIT.
+
+    /* Receive buffer information, provided by the user during creation */
+    uint8_t* rx_buf_ptr;            ///< Pointer to the user-provided buffer for assembling incoming PDUs.
+#ifdef ISO_TP_STREAMING_RECEIVE
+    isotp_rx_sink_cb rx_sink;       ///< Sink of segmented receptions set with `isotp_rtt_set_rx_sink`, RT_NULL if unused.
+    void* rx_sink_arg;              ///< Argument passed to `rx_sink`.
+#endif
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    struct isotp_rtt_route* route;  ///< Route forwarding the receptions of this link, RT_NULL if none.
+    rt_uint16_t route_refs;         ///< Number of routes this link is the egress of.
+#endif
+
+    /* Optional queue of completed PDUs, backed by a user-provided slab */
+    uint8_t* rxq_slab;              ///< Slab holding `rxq_depth` entries of `rxq_entry_size` bytes, RT_NULL if disabled.
+    volatile rt_uint32_t rxq_head;  ///< Free-running write index, advanced when a PDU is completed.
+    volatile rt_uint32_t rxq_tail;  ///< Free-running read index, advanced when a PDU is handed to the user.
+    rt_uint32_t rx_dropped;         ///< PDUs dropped because no buffer was free (queue full or buffer lent out).
+    uint16_t rx_buf_size;           ///< The total size of the user-provided receive buffer.
+    uint16_t rx_actual_size;        ///< The actual size of the last received PDU.
+    uint16_t rxq_entry_size;        ///< Size of one slab entry (header + `rx_buf_size` bytes of payload).
+    uint16_t rxq_depth;             ///< Number of entries in the slab.
+
+    struct rt_event event;          ///< Event set for synchronizing blocking API calls with asynchronous callbacks.
+    struct rt_mutex send_mutex;     ///< Mutex to ensure thread-safe sending on this specific link.
+
+#ifdef PKG_ISOTP_C_USING_STATS
+    struct isotp_rtt_link_stats stats; ///< Counters, see `isotp_rtt_get_stats`.
+    uint32_t tx_start_us;           ///< Time the PDU in progress was started.
+    uint32_t rx_start_us;           ///< Time the First Frame of the reception in progress arrived.
+    uint32_t fc_start_us;           ///< Time the last FF or CF was sent, while an FC is awaited.
+    rt_uint8_t stats_flags;         ///< ISOTP_RTT_STATS_* timing flags, private to the adapter.
+#endif
+
+    rt_uint8_t send_ide;            ///< The CAN ID type (Standard/Extended) to use for sending frames.
+    rt_uint8_t send_rtr;            ///< The CAN frame type (Data/Remote) to use for sending frames.
+    rt_uint8_t send_fd;             ///< Non-zero to send every frame in CAN FD format (TX_DL > 8).
+    rt_uint8_t send_brs;            ///< Non-zero to switch to the data bitrate in CAN FD frames.
+    rt_uint8_t tx_active;           ///< RT_TRUE while the request at `txq_tail` owns the core's sender.
+    rt_uint8_t tx_kicking;          ///< RT_TRUE while a thread is starting queued requests.
+    rt_uint8_t tx_kick_pending;     ///< Set when the queue changed while another thread was kicking.
+    rt_uint8_t rx_truncated;        ///< Flag indicating if the last received PDU was truncated.
+    rt_uint8_t rx_lent;             ///< RT_TRUE while a PDU is lent to the user by `isotp_rtt_receive_borrow`.
+    rt_uint8_t alloc;               ///< Where the link object lives, one of ISOTP_RTT_LINK_ALLOC_*.
+    volatile rt_uint8_t txn_state;  ///< State of `txn`, private to the adapter.
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+    volatile rt_uint8_t tx_starved; ///< Set while a route has no payload yet for the next consecutive frame.
+    volatile rt_uint8_t rx_resume;  ///< Set by a route for the polling thread to ask the flow control policy again.
+#endif
+#ifdef PKG_ISOTP_C_USING_TX_RING
+    volatile rt_uint8_t tx_stalled; ///< Set while the link waits for room in `tx_ring`.
+#endif
+#ifdef PKG_ISOTP_C_USING_TRACE
+    rt_uint8_t trace_send_status;   ///< Send status last written to the frame trace.
+    rt_uint8_t trace_receive_status; ///< Receive status last written to the frame trace.
+#endif
+#ifdef PKG_ISOTP_C_USING_HW_FILTER
+    rt_int8_t hw_filter_bank;       ///< Filter bank accepting `recv_arbitration_id`, relative to PKG_ISOTP_C_HW_FILTER_BANK_BASE, -1 if none.
+#endif
+};
+
+/**
+ * @brief A request/response transaction, see `isotp_rtt_transact_async`.
+ *
+ * Set it up with `isotp_rtt_txn_init`, which also applies the default P2 timeouts, adjust the
+ * timeouts if needed and start it. The storage belongs to the caller and must stay valid, along
+ * with `request` and `response`, until the transaction has completed.
+ */
+struct isotp_rtt_txn
+{
+    const uint8_t* request;         ///< The request PDU.
+    uint8_t* response;              ///< Buffer receiving the response PDU.
+    isotp_rtt_txn_cb_t cb;          ///< Completion callback, set by `isotp_rtt_transact_async`.
+    void* cb_arg;                   ///< Argument passed to `cb`.
+    uint32_t p2_us;                 ///< Time the response may take after the request was sent (UDS P2).
+    uint32_t p2_ext_us;             ///< Time it may take after each response pending NRC 0x78 (UDS P2*), 0 to treat 0x78 as the response.
+    uint32_t elapsed_us;            ///< Output: time from the start of the transaction to its completion.
+    rt_err_t result;                ///< Output: RT_EOK, or the error the transaction completed with.
+    uint16_t request_size;          ///< The size of `request`.
+    uint16_t response_buf_size;     ///< The size of `response`.
+    uint16_t response_size;         ///< Output: the size of the response received.
+    rt_uint8_t pending;             ///< Output: the number of response pending NRCs (0x7F SID 0x78) received.
+};
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+/**
+ * @brief A cut-through route forwarding the PDUs received on one link to another, see `isotp_rtt_route_init`.
+ *
+ * It lives in caller-provided storage like a link. Its members are private to the adapter,
+ * except for the counters, which may be read at any time.
+ */
+struct isotp_rtt_route
+{
+    struct isotp_rtt_link* from;    ///< Ingress link, whose receptions are forwarded.
+    struct isotp_rtt_link* to;      ///< Egress link the PDUs are sent on.
+    isotp_fc_policy_cb fc_policy;   ///< Flow control policy the ingress link had before, applied first and restored on detach.
+    void* fc_policy_arg;            ///< Argument of `fc_policy`.
+    uint8_t* fifo;                  ///< Caller-provided buffer the payload passes through.
+    uint32_t fifo_size;             ///< Size of `fifo`.
+    uint32_t pdu_size;              ///< Size of the PDU being forwarded.
+    volatile uint32_t copied;       ///< Bytes of that PDU written into `fifo` by the ingress side.
+    volatile uint32_t released;     ///< Bytes of that PDU the egress side will not read again.
+    rt_uint32_t forwarded;          ///< PDUs forwarded successfully.
+    rt_uint32_t failed;             ///< PDUs lost because the ingress or the egress side failed.
+    rt_uint32_t dropped;            ///< Single Frames dropped while the previous PDU was being forwarded.
+    volatile rt_uint8_t state;      ///< Forwarding state, private to the adapter.
+    volatile rt_uint8_t aborted;    ///< Set when the ingress side failed while the egress side was running.
+    volatile rt_uint8_t held;       ///< Set while the ingress flow control holds the sender with FC.WAIT.
+    rt_uint8_t in_frame;            ///< Payload bytes of an ingress consecutive frame.
+};
+#endif
+
+
 /**
  * @brief Creates and initializes a new ISO-TP link instance.
  *
  * This function allocates resources for a new link, initializes the underlying isotp-c library,
  * and adds the link to the internal managed list.
  *
- * @warning This function is not thread-safe. The user must ensure that no other thread is
- *          iterating through the link list (by calling `isotp_rtt_on_can_msg_received`)
- *          at the same time this function is called. A mutex or scheduler lock should be
- *          used in the application layer if links can be created/destroyed dynamically
- *          while communication is active.
+ * @note  Links may be created while other links are communicating, the link list is
+ *        protected internally. Must be called from a thread context.
  *
  * @param can_dev           A handle to a previously opened RT-Thread CAN device.
  * @param send_arbitration_id  The CAN arbitration ID to use when transmitting frames for this link.
@@ -65,6 +330,9 @@ typedef struct isotp_rtt_link* isotp_rtt_link_t;
  * @param recv_buf          A user-provided buffer for the protocol to use for assembling incoming PDUs.
  * @param recv_buf_size     The size of the receive buffer in bytes.
  *
+ * @note  With PKG_ISOTP_C_LINK_POOL_SIZE > 0 the link is taken from a fixed-capacity static pool
+ *        instead of the heap, and creation fails once the pool is exhausted.
+ *
  * @return A handle (`isotp_rtt_link_t`) to the newly created link on success, or RT_NULL on failure (e.g., memory allocation failed).
  */
 isotp_rtt_link_t isotp_rtt_create(rt_device_t can_dev,
@@ -77,16 +345,128 @@ isotp_rtt_link_t isotp_rtt_create(rt_device_t can_dev,
                                   uint8_t* recv_buf,
                                   uint16_t recv_buf_size);
 
+/**
+ * @brief Creates and initializes a new ISO-TP link instance with its own protocol parameters.
+ *
+ * Same as `isotp_rtt_create`, but the link's N_Bs/N_Cr timeout, receive BS/STmin, FC.WAIT limit,
+ * frame padding and TX_DL come from `config` instead of the global ISO_TP_* defaults, so that e.g.
+ * a flash-programming link can use STmin 0, large blocks and long timeouts while a functional
+ * broadcast link on the same bus stays conservative.
+ *
+ * @code
+ * IsoTpLinkConfig cfg;
+ * isotp_link_config_init(&cfg);       // start from the compile-time defaults
+ * cfg.block_size = 0;
+ * cfg.st_min_us = 0;
+ * cfg.response_timeout_us = 1000000;
+ * link = isotp_rtt_create_ex(can_dev, 0x7E0, 0x7E8, RT_CAN_STDID, RT_CAN_DTR,
+ *                            tx_buf, sizeof(tx_buf), rx_buf, sizeof(rx_buf), &cfg);
+ * @endcode
+ *
+ * With ISO_TP_ADDRESSING (PKG_ISOTP_C_USING_ADDRESSING) the config also selects the addressing
+ * format. Extended and mixed links put `send_addr` in front of every frame and only take frames
+ * whose first byte is `receive_addr`, so any number of peers can share one receive ID; the RX
+ * dispatch table is hashed by ID and address byte, a frame only visits the links of its peer.
+ * Normal fixed addressing keeps N_TA/N_SA in the ID, see ISOTP_RTT_NORMAL_FIXED_PHYS_ID.
+ * The addressing of a link is fixed once it is created.
+ *
+ * @code
+ * cfg.addr_mode = ISOTP_ADDRESSING_EXTENDED;
+ * cfg.send_addr = ecu_addr;           // N_TA of our requests
+ * cfg.receive_addr = tester_addr;     // N_TA of the ECU's responses
+ * @endcode
+ *
+ * @param can_dev              A handle to a previously opened RT-Thread CAN device.
+ * @param send_arbitration_id  The CAN arbitration ID to use when transmitting frames for this link.
+ * @param recv_arbitration_id  The CAN arbitration ID this link should listen to for incoming frames.
+ * @param send_ide             The Identifier Extension type for outgoing frames (RT_CAN_STDID or RT_CAN_EXTID).
+ * @param send_rtr             The Remote Transmission Request type for outgoing frames (RT_CAN_DTR or RT_CAN_RTR).
+ * @param send_buf             A user-provided buffer for the protocol to use for formatting outgoing PDUs.
+ * @param send_buf_size        The size of the send buffer in bytes.
+ * @param recv_buf             A user-provided buffer for the protocol to use for assembling incoming PDUs.
+ * @param recv_buf_size        The size of the receive buffer in bytes.
+ * @param config               The link configuration (copied), or RT_NULL for the defaults.
+ *
+ * @return A handle (`isotp_rtt_link_t`) to the newly created link on success, or RT_NULL on failure.
+ */
+isotp_rtt_link_t isotp_rtt_create_ex(rt_device_t can_dev,
+                                     uint32_t send_arbitration_id,
+                                     uint32_t recv_arbitration_id,
+                                     rt_uint8_t send_ide,
+                                     rt_uint8_t send_rtr,
+                                     uint8_t* send_buf,
+                                     uint16_t send_buf_size,
+                                     uint8_t* recv_buf,
+                                     uint16_t recv_buf_size,
+                                     const IsoTpLinkConfig* config);
+
+/**
+ * @brief Initializes an ISO-TP link instance in caller-provided storage.
+ *
+ * The init-style counterpart of `isotp_rtt_create_ex`, in the manner of `rt_event_init`: no memory
+ * is allocated, the link's event and mutex are embedded in `link`. Together with RX queues and the
+ * RX dispatcher this lets the adapter run without any dynamic allocation and with a deterministic
+ * setup time. Undo it with `isotp_rtt_detach`.
+ *
+ * @note  Same rules as `isotp_rtt_create`.
+ *
+ * @param link                 The link storage (e.g. a static `struct isotp_rtt_link`).
+ * @param can_dev              A handle to a previously opened RT-Thread CAN device.
+ * @param send_arbitration_id  The CAN arbitration ID to use when transmitting frames for this link.
+ * @param recv_arbitration_id  The CAN arbitration ID this link should listen to for incoming frames.
+ * @param send_ide             The Identifier Extension type for outgoing frames (RT_CAN_STDID or RT_CAN_EXTID).
+ * @param send_rtr             The Remote Transmission Request type for outgoing frames (RT_CAN_DTR or RT_CAN_RTR).
+ * @param send_buf             A user-provided buffer for the protocol to use for formatting outgoing PDUs.
+ * @param send_buf_size        The size of the send buffer in bytes.
+ * @param recv_buf             A user-provided buffer for the protocol to use for assembling incoming PDUs.
+ * @param recv_buf_size        The size of the receive buffer in bytes.
+ * @param config               The link configuration (copied), or RT_NULL for the defaults.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if `link` or `can_dev` is NULL, -RT_EFULL if
+ *         PKG_ISOTP_C_USING_DEVICE_WORKERS is enabled and no worker is left for `can_dev`, or
+ *         PKG_ISOTP_C_USING_TX_RING is enabled and no TX ring is left for it.
+ */
+rt_err_t isotp_rtt_init(struct isotp_rtt_link* link,
+                        rt_device_t can_dev,
+                        uint32_t send_arbitration_id,
+                        uint32_t recv_arbitration_id,
+                        rt_uint8_t send_ide,
+                        rt_uint8_t send_rtr,
+                        uint8_t* send_buf,
+                        uint16_t send_buf_size,
+                        uint8_t* recv_buf,
+                        uint16_t recv_buf_size,
+                        const IsoTpLinkConfig* config);
+
+/**
+ * @brief Detaches a link set up with `isotp_rtt_init` from the adapter.
+ *
+ * Removes the link from the managed list, fails any PDU still queued for transmission and the
+ * transaction in progress, and detaches its event and mutex. The storage is left to the caller and may be initialized again.
+ *
+ * @warning Same rule as `isotp_rtt_destroy`: do not detach a link that another thread is still
+ *          sending or receiving on.
+ *
+ * @param link The link to detach.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the link is NULL, -RT_EBUSY if it is the ingress or the
+ *         egress of a route (PKG_ISOTP_C_USING_GATEWAY), detach the route first.
+ */
+rt_err_t isotp_rtt_detach(isotp_rtt_link_t link);
+
 /**
  * @brief Destroys an ISO-TP link instance and releases all associated resources.
  *
  * This function removes the link from the managed list and frees all memory and
- * RTOS objects (events, mutexes) associated with it.
+ * RTOS objects (events, mutexes) associated with it. Links come from the heap, or from a static
+ * pool of PKG_ISOTP_C_LINK_POOL_SIZE links when that option is non-zero.
  *
- * @warning This function is not thread-safe. The user must ensure that no other thread is
- *          iterating through the link list (by calling `isotp_rtt_on_can_msg_received`)
- *          at the same time this function is called. A mutex or scheduler lock should be
- *          used in the application layer.
+ * @warning Do not destroy a link that another thread is still sending or receiving on
+ *          (`isotp_rtt_send`, `isotp_rtt_receive` or their variants), it would be left using
+ *          freed memory. Removing the link from the list is protected internally, so other
+ *          links and the CAN receive path may keep running meanwhile.
+ *
+ * @note  A link that is still the ingress or the egress of a route is not destroyed.
  *
  * @param link The handle of the link to be destroyed.
  */
@@ -96,8 +476,9 @@ void isotp_rtt_destroy(isotp_rtt_link_t link);
  * @brief Processes a received CAN message and dispatches it to the appropriate link(s).
  *
  * This is the primary entry point for feeding raw CAN frames into the ISO-TP stack.
- * The function iterates through all active links and passes the message to any link
- * that is configured to listen to the message's arbitration ID.
+ * The message is passed to every link that is configured to listen to its arbitration ID,
+ * on any CAN device. Links are looked up in a hash table maintained by `isotp_rtt_create`
+ * and `isotp_rtt_destroy`, so the cost per frame does not grow with the number of links.
  *
  * @warning This function MUST be called from a thread context (e.g., a dedicated consumer
  *          thread or a workqueue). It must NEVER be called directly from an Interrupt
@@ -109,10 +490,25 @@ void isotp_rtt_destroy(isotp_rtt_link_t link);
  */
 void isotp_rtt_on_can_msg_received(struct rt_can_msg *msg);
 
+/**
+ * @brief Processes a CAN message received on a specific CAN device.
+ *
+ * Same as `isotp_rtt_on_can_msg_received`, but the message is only passed to links created
+ * on `can_dev`. Use this when the same arbitration IDs are in use on more than one bus.
+ *
+ * @warning This function MUST be called from a thread context, see `isotp_rtt_on_can_msg_received`.
+ *
+ * @param can_dev The CAN device the message was received on. RT_NULL matches links on any device.
+ * @param msg     A pointer to the `rt_can_msg` structure received from the CAN driver.
+ */
+void isotp_rtt_on_can_msg_received_from(rt_device_t can_dev, struct rt_can_msg *msg);
+
 /**
  * @brief Sends an ISO-TP message in a blocking manner.
- * @note  This function initiates a transmission and then blocks the calling thread
- *        until the entire message is successfully sent or an error/timeout occurs.
+ * @note  This function queues the message behind any PDUs already queued on the link and then
+ *        blocks the calling thread until the entire message is successfully sent or an
+ *        error/timeout occurs. A message that has already started when the timeout expires is
+ *        finished in the background; its result is not reported to a later call.
  * @param  link The link handle.
  * @param  payload Pointer to the data to send.
  * @param  size Size of the data.
@@ -120,32 +516,87 @@ void isotp_rtt_on_can_msg_received(struct rt_can_msg *msg);
  * @return Returns ISOTP_RET_OK on success.
  * @retval ISOTP_RET_TIMEOUT_RTT on timeout.
  * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
- * @retval Other ISOTP_RET_* codes for protocol-level errors.
+ * @retval ISOTP_RET_ERROR_RTT if the transmission failed (e.g. N_Bs timeout, FC overflow, too many FC.WAIT).
+ * @retval ISOTP_RET_NOSPACE if the link's transmit queue is full.
+ * @retval Other ISOTP_RET_* codes if the message could not be queued.
  */
 int isotp_rtt_send(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size, rt_int32_t timeout);
 
+#ifdef ISO_TP_STREAMING_SEND
+/**
+ * @brief Sends an ISO-TP message whose payload is pulled from a callback while it is being sent.
+ *
+ * Blocking like `isotp_rtt_send`, but nothing is staged in the link's send buffer: `source` is
+ * asked for the bytes of every frame as it is formatted, so a firmware image can be sent
+ * straight from flash or a file, and the PDU may be larger than the send buffer (up to
+ * 4 GB - 1, or 65535 bytes with PKG_ISOTP_C_COMPACT_LINK). Enabled with PKG_ISOTP_C_USING_STREAMING_SEND.
+ *
+ * @note  `source` runs in the calling thread for the first frame and in the `isotp_poll` thread
+ *        for the consecutive frames. Its `link` argument is the `isotp_rtt_link_t`. A range is
+ *        requested again if its frame could not be written, so the source must allow re-reads.
+ *
+ * @param  link The link handle.
+ * @param  size Size of the PDU.
+ * @param  source The payload source, see `isotp_tx_source_cb`.
+ * @param  arg User argument passed to `source`.
+ * @param  timeout Timeout in system ticks.
+ * @return Returns ISOTP_RET_OK on success.
+ * @retval ISOTP_RET_TIMEOUT_RTT on timeout.
+ * @retval ISOTP_RET_INVAL_ARGS if the link handle, size or source is invalid.
+ * @retval ISOTP_RET_ERROR_RTT if the transmission failed, including a failing source.
+ * @retval Other ISOTP_RET_* codes if the message could not be queued.
+ */
+int isotp_rtt_send_stream(isotp_rtt_link_t link, uint32_t size, isotp_tx_source_cb source, void *arg, rt_int32_t timeout);
+#endif
+
 /**
  * @brief Sends an ISO-TP message in a non-blocking manner ("fire and forget").
- * @note  This function queues the message for transmission and returns immediately.
+ * @note  This function starts the transmission and returns immediately.
  *        It does not wait for the transmission to complete. The user cannot know
  *        the final status of the transmission when using this function.
  *        It is suitable for applications that send data periodically without needing
  *        an immediate acknowledgment of transmission completion.
  * @param  link The link handle.
- * @param  payload Pointer to the data to send.
+ * @param  payload Pointer to the data to send. It may be reused as soon as the function returns.
  * @param  size Size of the data.
- * @return Returns ISOTP_RET_OK if the message was successfully queued for sending.
+ * @return Returns ISOTP_RET_OK if the message was successfully started.
  * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
- * @retval Other ISOTP_RET_* codes if the message could not be queued (e.g., another send is already in progress).
+ * @retval ISOTP_RET_INPROGRESS if another send is already in progress or queued on the link.
+ * @retval Other ISOTP_RET_* codes if the message could not be started.
  */
 int isotp_rtt_send_nonblocking(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size);
 
+/**
+ * @brief Queues an ISO-TP message for transmission and reports its final status through a callback.
+ *
+ * Each link has a bounded FIFO of PKG_ISOTP_C_TX_QUEUE_DEPTH pending PDUs. When a PDU completes,
+ * the next one is started immediately from the adapter's completion path, so pipelined requests
+ * go out back-to-back without any caller-side retry loop.
+ *
+ * @note  The payload is not copied when queued: it must stay valid until `cb` is called.
+ *
+ * @param  link The link handle.
+ * @param  payload Pointer to the data to send.
+ * @param  size Size of the data.
+ * @param  cb Completion callback, may be RT_NULL.
+ * @param  arg User argument passed to `cb`.
+ * @return Returns ISOTP_RET_OK if the message was queued.
+ * @retval ISOTP_RET_INVAL_ARGS if the link handle is invalid.
+ * @retval ISOTP_RET_OVERFLOW if the message does not fit into the link's send buffer.
+ * @retval ISOTP_RET_NOSPACE if the link's transmit queue is full.
+ */
+int isotp_rtt_send_async(isotp_rtt_link_t link, const uint8_t *payload, uint16_t size, isotp_rtt_tx_cb_t cb, void* arg);
+
 /**
  * @brief Receives a complete data payload (PDU) from an ISO-TP link in a blocking manner.
  *
  * This function blocks the calling thread until a complete message is received on the
  * specified link or a timeout occurs.
  *
+ * @note  Transmit and receive completions are signalled independently, so one thread may wait
+ *        here while another sends on the same link with `isotp_rtt_send*`; neither consumes
+ *        the other's events.
+ *
  * @param link          The handle of the link to receive the message from.
  * @param payload_buf   A user-provided buffer to store the incoming data payload.
  * @param buf_size      The maximum size of the `payload_buf`.
@@ -157,8 +608,415 @@ int isotp_rtt_send_nonblocking(isotp_rtt_link_t link, const uint8_t *payload, ui
  *         receive buffer was too small. `out_size` will contain the amount of data that was copied.
  * @retval -RT_ENOMEM if the provided `payload_buf` is too small to hold the received data.
  * @retval -RT_ETIMEOUT if no message was received within the specified timeout.
+ * @retval -RT_EBUSY if a PDU obtained with `isotp_rtt_receive_borrow` has not been released yet.
  * @retval -RT_ERROR for other protocol-level errors.
  */
 rt_err_t isotp_rtt_receive(isotp_rtt_link_t link, uint8_t* payload_buf, uint16_t buf_size, uint16_t* out_size, rt_int32_t timeout);
 
-#endif // __ISOTP_RTT_H__
\ No newline at end of file
+/**
+ * @brief Receives a complete PDU without copying it (zero-copy).
+ *
+ * Blocks like `isotp_rtt_receive`, but instead of copying the PDU into a user buffer it returns a
+ * read-only view into the link's receive buffer, or into the oldest RX queue entry when a queue is
+ * configured with `isotp_rtt_set_rx_queue`. The memory is not reused until the caller returns it
+ * with `isotp_rtt_receive_release`. Without a queue, new Single and First Frames arriving for the
+ * link in the meantime are dropped, so the view should be released quickly.
+ *
+ * @param link     The handle of the link to receive the message from.
+ * @param payload  Output: pointer to the received PDU.
+ * @param size     Output: size of the received PDU.
+ * @param timeout  The maximum time to wait for a message to be received, in system ticks.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EFULL if the PDU was truncated to the link's receive buffer size. It must still be released.
+ * @retval -RT_ETIMEOUT if no message was received within the specified timeout.
+ * @retval -RT_EBUSY if a previously borrowed PDU has not been released yet.
+ * @retval -RT_ERROR for other protocol-level errors.
+ */
+rt_err_t isotp_rtt_receive_borrow(isotp_rtt_link_t link, const uint8_t** payload, uint16_t* size, rt_int32_t timeout);
+
+/**
+ * @brief Returns a PDU obtained with `isotp_rtt_receive_borrow` to the link so its memory can be reused.
+ *
+ * @param link The link handle.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if nothing is borrowed on the link.
+ */
+rt_err_t isotp_rtt_receive_release(isotp_rtt_link_t link);
+
+/**
+ * @brief Prepares a transaction for `isotp_rtt_transact` or `isotp_rtt_transact_async`.
+ *
+ * The P2 and P2* timeouts are set to PKG_ISOTP_C_TXN_P2_MS and PKG_ISOTP_C_TXN_P2_EXT_MS
+ * (50 ms and 5000 ms by default, the UDS defaults); change `p2_us` and `p2_ext_us` afterwards
+ * for an ECU with other timing parameters.
+ *
+ * @param txn               The transaction.
+ * @param request           The request PDU.
+ * @param request_size      The size of `request`.
+ * @param response          Buffer receiving the response PDU.
+ * @param response_buf_size The size of `response`.
+ */
+void isotp_rtt_txn_init(struct isotp_rtt_txn* txn, const uint8_t* request, uint16_t request_size,
+                        uint8_t* response, uint16_t response_buf_size);
+
+/**
+ * @brief Starts a request/response transaction and reports its outcome through a callback.
+ *
+ * The link is armed for the response before the request is queued, so a response arriving at
+ * any time after that, even before the request's own completion has been processed, goes
+ * straight from the receive path into `txn->response`; nothing can be lost in the window
+ * between a send and a following `isotp_rtt_receive`. The response must start within `p2_us`
+ * of the end of the request. A negative response 0x7F with the request's SID and NRC 0x78
+ * (response pending) is not delivered: it counts in `pending` and restarts the wait with
+ * `p2_ext_us`, as many times as the ECU sends it. A segmented response is not timed out once
+ * its First Frame has arrived, N_Cr covers it from there.
+ *
+ * Each link runs one transaction at a time, but transactions on different links run
+ * independently, so a tester can keep one outstanding on each ECU link.
+ *
+ * @note  While a transaction is in progress, PDUs received on the link belong to it and are not
+ *        reported to `isotp_rtt_receive`. PDUs received before it was started stay there.
+ *
+ * @param link The link handle.
+ * @param txn  The transaction, prepared with `isotp_rtt_txn_init`.
+ * @param cb   Completion callback, may be RT_NULL.
+ * @param arg  User argument passed to `cb`.
+ *
+ * @return RT_EOK if started; `cb` then reports `txn->result`:
+ *         RT_EOK with the response in `txn->response`,
+ *         -RT_ETIMEOUT if no response arrived in time,
+ *         -RT_EFULL if the response was truncated to the link's receive buffer size,
+ *         -RT_ENOMEM if it does not fit into `response` (`response_size` is 0),
+ *         -RT_ERROR if the request could not be sent or the link was detached.
+ * @retval -RT_EINVAL if the link handle or the transaction is invalid.
+ * @retval -RT_EBUSY if a transaction is already in progress on the link, a received PDU is
+ *         borrowed, or its receptions go to a sink or a route.
+ * @retval -RT_EFULL if the link's transmit queue is full.
+ * @retval -RT_ENOMEM if the request does not fit into the link's send buffer.
+ */
+rt_err_t isotp_rtt_transact_async(isotp_rtt_link_t link, struct isotp_rtt_txn* txn, isotp_rtt_txn_cb_t cb, void* arg);
+
+/**
+ * @brief Sends a request and waits for its response, see `isotp_rtt_transact_async`.
+ *
+ * The calling thread is woken up directly by the completion, so the turnaround is bounded by the
+ * bus and the ECU rather than by the wake-up of a separate receive call.
+ *
+ * @code
+ * struct isotp_rtt_txn txn;
+ * isotp_rtt_txn_init(&txn, req, sizeof(req), resp, sizeof(resp));
+ * if (isotp_rtt_transact(link, &txn) == RT_EOK)
+ *     handle_response(resp, txn.response_size);
+ * @endcode
+ *
+ * @param link The link handle.
+ * @param txn  The transaction, prepared with `isotp_rtt_txn_init`.
+ *
+ * @return `txn->result` once the transaction has completed, or one of the errors with which
+ *         `isotp_rtt_transact_async` refuses to start it.
+ */
+rt_err_t isotp_rtt_transact(isotp_rtt_link_t link, struct isotp_rtt_txn* txn);
+
+/**
+ * @name RX Queue Sizing
+ * @{
+ * @brief Helpers to size the slab passed to `isotp_rtt_set_rx_queue`.
+ */
+#define ISOTP_RTT_RX_QUEUE_ENTRY_HDR_SIZE 4 ///< Per-entry bookkeeping overhead in bytes.
+/** @brief Size of one RX queue entry for a link created with a `recv_buf_size` of `pdu_size`. */
+#define ISOTP_RTT_RX_QUEUE_ENTRY_SIZE(pdu_size) RT_ALIGN((pdu_size) + ISOTP_RTT_RX_QUEUE_ENTRY_HDR_SIZE, RT_ALIGN_SIZE)
+/** @brief Size of a slab holding `depth` PDUs of up to `pdu_size` bytes. */
+#define ISOTP_RTT_RX_QUEUE_SLAB_SIZE(depth, pdu_size) ((depth) * ISOTP_RTT_RX_QUEUE_ENTRY_SIZE(pdu_size))
+/** @} */
+
+/**
+ * @brief Enables a queue of completed PDUs on a link.
+ *
+ * By default a link holds a single received PDU in its receive buffer, and the next incoming
+ * Single or First Frame overwrites it if `isotp_rtt_receive` has not been called in time.
+ * With a queue, every completed PDU is moved into an entry of `slab`, so the receiver can fall
+ * behind by up to `depth` PDUs without losing data. PDUs that arrive while the queue is full
+ * are dropped. The slab is provided by the caller; no memory is allocated on the receive path.
+ *
+ * @note  Call this right after `isotp_rtt_create`, before traffic is received on the link.
+ *
+ * @param link      The link handle.
+ * @param slab      The slab memory, sized with `ISOTP_RTT_RX_QUEUE_SLAB_SIZE(depth, recv_buf_size)`.
+ *                  RT_NULL disables the queue.
+ * @param slab_size The size of `slab` in bytes.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if the link handle is invalid or the slab is too small for a single entry.
+ */
+rt_err_t isotp_rtt_set_rx_queue(isotp_rtt_link_t link, void* slab, rt_size_t slab_size);
+
+#ifdef PKG_ISOTP_C_USING_TRACE
+/**
+ * @brief Starts or stops recording into the frame trace ring.
+ *
+ * With PKG_ISOTP_C_USING_TRACE, every frame sent through `isotp_user_send_can*` and every frame
+ * received through `isotp_rtt_on_can_msg_received*` or an attached port is stored as a compact
+ * binary record (timestamp, device, ID, flags, length, data), along with the send and receive
+ * state transitions of each link. The last PKG_ISOTP_C_TRACE_DEPTH records are kept and can be
+ * dumped with the `isotp_trace` shell command. Recording is on by default.
+ *
+ * @param enable RT_TRUE to record, RT_FALSE to freeze the current content, e.g. right after a fault.
+ */
+void isotp_rtt_trace_enable(rt_bool_t enable);
+
+/**
+ * @brief Discards every record of the frame trace ring.
+ */
+void isotp_rtt_trace_clear(void);
+#endif
+
+#ifdef ISO_TP_STREAMING_RECEIVE
+/**
+ * @brief Streams segmented receptions of a link to a callback chunk by chunk.
+ *
+ * With a sink set, the link's receive buffer only stages the data of a segmented PDU: every
+ * time it is full, and at the end of the PDU, its content is handed to `sink` together with
+ * its offset and the total length announced by the First Frame. Incoming PDUs may therefore be
+ * much larger than `recv_buf_size` (up to 4 GB - 1, or 65535 bytes with PKG_ISOTP_C_COMPACT_LINK),
+ * e.g. a firmware image written to flash while it arrives. Streamed PDUs are not reported to
+ * `isotp_rtt_receive`; Single Frames still are. Enabled with PKG_ISOTP_C_USING_STREAMING_RECEIVE.
+ *
+ * @note  `sink` runs in the thread that dispatches received frames, with the same constraints as
+ *        the rest of the receive path: a slow sink delays every link of that device. Its `link`
+ *        argument is the `isotp_rtt_link_t`; returning anything but ISOTP_RET_OK aborts the
+ *        reception, and an aborted reception is reported with `data` RT_NULL. Use a block size
+ *        (`isotp_rtt_set_rx_flow_control`) to pace the sender when writes are slow.
+ *
+ * @param link The link handle.
+ * @param sink The sink, or RT_NULL to assemble segmented PDUs in the receive buffer again.
+ * @param arg  User argument passed to `sink`.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if the link handle is invalid.
+ * @retval -RT_EBUSY if a reception is currently being streamed on the link, or a transaction is in progress.
+ */
+rt_err_t isotp_rtt_set_rx_sink(isotp_rtt_link_t link, isotp_rx_sink_cb sink, void* arg);
+#endif
+
+#ifdef PKG_ISOTP_C_USING_GATEWAY
+/**
+ * @brief Forwards every PDU received on link `from` to link `to`, cut-through.
+ *
+ * Instead of receiving a whole PDU before sending it again, the route starts the egress First
+ * Frame as soon as the ingress First Frame (or the first bytes after it) has arrived, and each
+ * consecutive frame is sent as soon as its payload has been received. The payload passes through
+ * `fifo` once; the ingress flow control only grants blocks that fit its free space and holds the
+ * sender with FC.WAIT while the egress side is slower, so the transfer is pipelined end to end.
+ * Egress PDUs are queued on `to` like `isotp_rtt_send_async` requests and use its TX_DL, so the
+ * two links may run on different buses with different frame formats. For a diagnostic gateway,
+ * route both directions (tester to ECU and ECU to tester). Enabled with PKG_ISOTP_C_USING_GATEWAY.
+ *
+ * @note  One PDU passes a route at a time: a segmented PDU arriving while the previous one is
+ *        still being sent is held at its First Frame with FC.WAIT, a Single Frame is dropped. A
+ *        failure on one side aborts the other. `from` does not deliver to `isotp_rtt_receive`
+ *        while routed, and its receive buffer is only a staging area of at least one frame.
+ *        `to` may still be used for the application's own PDUs, which are queued in between.
+ *
+ * @param route     Storage for the route, valid until `isotp_rtt_route_detach`.
+ * @param from      The ingress link. Its receive buffer must hold at least 63 bytes with
+ *                  PKG_ISOTP_C_USING_CANFD, 7 bytes otherwise.
+ * @param to        The egress link, different from `from`.
+ * @param fifo      The buffer the payload passes through. Larger buffers absorb longer stalls of
+ *                  the egress side; a few blocks of the ingress sender are enough.
+ * @param fifo_size Size of `fifo`, at least 64 bytes with PKG_ISOTP_C_USING_CANFD, 8 otherwise.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if an argument is invalid or a buffer is too small.
+ * @retval -RT_EBUSY if `from` is already routed, has a sink, has a transaction in progress or is receiving.
+ */
+rt_err_t isotp_rtt_route_init(struct isotp_rtt_route* route, isotp_rtt_link_t from, isotp_rtt_link_t to, uint8_t* fifo, uint32_t fifo_size);
+
+/**
+ * @brief Removes a route; `from` delivers its receptions to `isotp_rtt_receive` again.
+ *
+ * @param route The route.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if the route is invalid.
+ * @retval -RT_EBUSY while a PDU is being forwarded.
+ */
+rt_err_t isotp_rtt_route_detach(struct isotp_rtt_route* route);
+#endif
+
+/**
+ * @brief Sets the transmit data length (TX_DL) of a link and its CAN FD frame options.
+ *
+ * Classic CAN links use TX_DL 8 (the default). With PKG_ISOTP_C_USING_CANFD, a TX_DL of
+ * 12, 16, 20, 24, 32, 48 or 64 makes every frame of the link a CAN FD frame (`rt_can_msg.fd_frame`),
+ * with ISO 15765-2:2016 escape-sequence single frames and DLC-aligned padding. Received frames
+ * are decoded according to the peer's RX_DL, whatever the local TX_DL.
+ *
+ * @param link  The link handle.
+ * @param tx_dl The new TX_DL.
+ * @param brs   RT_TRUE to set `rt_can_msg.brs` (bit rate switching) in CAN FD frames.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if the link handle or TX_DL is invalid.
+ * @retval -RT_EBUSY if a transmission is in progress or queued on the link.
+ */
+rt_err_t isotp_rtt_set_tx_dl(isotp_rtt_link_t link, uint8_t tx_dl, rt_bool_t brs);
+
+/**
+ * @brief Sets the block size (BS) and STmin a link advertises when it receives multi-frame PDUs.
+ *
+ * Links start with ISO_TP_DEFAULT_BLOCK_SIZE and ISO_TP_DEFAULT_ST_MIN_US. A larger block saves
+ * flow control round trips, a block size of 0 sends a single FC per PDU. The link's own
+ * transmissions are not affected, their STmin floor is `tx_st_min_floor_us` of IsoTpLinkConfig.
+ *
+ * @param link       The link handle.
+ * @param block_size Consecutive frames per block, 0 for no limit.
+ * @param st_min_us  Minimum separation time between consecutive frames, in microseconds.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the link handle is invalid.
+ */
+rt_err_t isotp_rtt_set_rx_flow_control(isotp_rtt_link_t link, uint8_t block_size, uint32_t st_min_us);
+
+#ifdef PKG_ISOTP_C_USING_RX_DISPATCHER
+/**
+ * @brief RX path counters of a CAN device attached with `isotp_rtt_port_attach`.
+ */
+struct isotp_rtt_port_stats
+{
+    rt_uint32_t rx_frames;          ///< Frames read from the driver and queued for dispatch.
+    rt_uint32_t rx_dropped;         ///< Frames dropped because the RX ring was full.
+    rt_uint32_t rx_high_watermark;  ///< Highest number of frames seen queued in the RX ring.
+};
+
+/**
+ * @brief Attaches a CAN device to the adapter-owned RX path.
+ *
+ * The adapter installs its own rx_indicate hook on the device. The hook runs in ISR context and
+ * copies each frame once into a per-device lock-free ring. A single dispatcher thread created by
+ * the adapter drains all rings in batches and feeds the frames into the links created on that
+ * device, as `isotp_rtt_on_can_msg_received_from` would. With PKG_ISOTP_C_USING_DEVICE_WORKERS,
+ * each ring is drained by the worker of its device instead. When a device is attached, the
+ * application must not call `isotp_rtt_on_can_msg_received*` for its frames.
+ *
+ * @param can_dev A previously opened CAN device (RT_DEVICE_FLAG_INT_RX).
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if `can_dev` is NULL.
+ * @retval -RT_EBUSY if the device is already attached.
+ * @retval -RT_EFULL if PKG_ISOTP_C_MAX_CAN_PORTS devices are already attached, or no worker is left for it.
+ */
+rt_err_t isotp_rtt_port_attach(rt_device_t can_dev);
+
+/**
+ * @brief Detaches a CAN device from the adapter-owned RX path and restores its original rx_indicate callback.
+ *
+ * @param can_dev The CAN device to detach.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the device is not attached.
+ */
+rt_err_t isotp_rtt_port_detach(rt_device_t can_dev);
+
+/**
+ * @brief Reads the RX path counters of an attached CAN device.
+ *
+ * @param can_dev The attached CAN device.
+ * @param stats   Output: a snapshot of the counters.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the device is not attached.
+ */
+rt_err_t isotp_rtt_port_get_stats(rt_device_t can_dev, struct isotp_rtt_port_stats *stats);
+
+/**
+ * @brief Enables or disables adaptive receiver flow control on a link.
+ *
+ * When enabled, every flow control frame is derived from the fill level of the RX ring of the
+ * link's CAN device: wide blocks while the dispatcher keeps up, a raised STmin when the ring is
+ * half full (PKG_ISOTP_C_ADAPTIVE_FC_BUSY_PERCENT), and FC.WAIT when it is nearly full
+ * (PKG_ISOTP_C_ADAPTIVE_FC_WAIT_PERCENT) or the link's RX queue has no free entry.
+ *
+ * @param link   The link handle.
+ * @param enable RT_TRUE to enable the policy, RT_FALSE to use the values of `isotp_rtt_set_rx_flow_control`.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the link handle is invalid, -RT_EBUSY if the link is
+ *         the ingress of a route (set it before `isotp_rtt_route_init`, the route applies it first).
+ */
+rt_err_t isotp_rtt_set_adaptive_fc(isotp_rtt_link_t link, rt_bool_t enable);
+#endif /* PKG_ISOTP_C_USING_RX_DISPATCHER */
+
+#ifdef PKG_ISOTP_C_USING_DEVICE_WORKERS
+/**
+ * @brief Sets the priority and CPU affinity of the worker thread of a CAN device.
+ *
+ * With PKG_ISOTP_C_USING_DEVICE_WORKERS, the links are sharded by CAN device: instead of one
+ * polling thread for all links, each device gets a worker thread that runs the timers of its own
+ * links only and, when the device is attached with `isotp_rtt_port_attach`, dispatches its
+ * received frames. Buses therefore do not delay each other, and on an SMP system the workers can
+ * run on different cores. A worker is started with PKG_ISOTP_C_WORKER_PRIORITY and no CPU binding
+ * when the first link or port of its device is set up, or by this function.
+ *
+ * @note  Single Frames, and the First Frame of a transmission, are still sent from the thread
+ *        calling `isotp_rtt_send*`; frames fed with `isotp_rtt_on_can_msg_received*` are still
+ *        dispatched in the calling thread.
+ *
+ * @param can_dev  The CAN device.
+ * @param priority The thread priority.
+ * @param cpu      The CPU to bind the worker to, or -1 to let the scheduler choose. Only
+ *                 meaningful with RT_USING_SMP; otherwise only -1 and 0 are accepted.
+ *
+ * @return RT_EOK on success.
+ * @retval -RT_EINVAL if `can_dev` is NULL, or the priority or the CPU is out of range.
+ * @retval -RT_EFULL if the device has no worker yet and all PKG_ISOTP_C_MAX_WORKERS are in use.
+ */
+rt_err_t isotp_rtt_worker_config(rt_device_t can_dev, rt_uint8_t priority, rt_int8_t cpu);
+#endif
+
+#ifdef PKG_ISOTP_C_USING_TX_RING
+/**
+ * @brief TX ring counters of a CAN device, see PKG_ISOTP_C_USING_TX_RING.
+ */
+struct isotp_rtt_tx_ring_stats
+{
+    rt_uint32_t tx_frames;          ///< Frames the TX thread wrote to the device.
+    rt_uint32_t tx_dropped;         ///< Frames queued on the ring that the device then refused.
+};
+
+/**
+ * @brief Reads the TX ring counters of a CAN device.
+ *
+ * A frame is reported to the core as sent once it is queued on the ring. When the device refuses
+ * it later, the peer only runs into N_Bs or N_Cr, and `tx_dropped` is where such a loss shows up.
+ *
+ * @param can_dev The CAN device.
+ * @param stats   Output: a snapshot of the counters.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if no link was created on the device or `stats` is NULL.
+ */
+rt_err_t isotp_rtt_tx_ring_get_stats(rt_device_t can_dev, struct isotp_rtt_tx_ring_stats *stats);
+#endif
+
+#ifdef PKG_ISOTP_C_USING_STATS
+/**
+ * @brief Reads the counters and latency histograms of a link.
+ *
+ * The counters are updated without locking from the adapter's threads and are cheap enough to
+ * stay enabled in production. They wrap at 2^32. The `isotp_stat` shell command prints them
+ * for every link.
+ *
+ * @param link  The link handle.
+ * @param stats Output: a snapshot of the counters.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the link handle or `stats` is invalid.
+ */
+rt_err_t isotp_rtt_get_stats(isotp_rtt_link_t link, struct isotp_rtt_link_stats *stats);
+
+/**
+ * @brief Clears the counters and latency histograms of a link.
+ *
+ * @param link The link handle.
+ *
+ * @return RT_EOK on success, -RT_EINVAL if the link handle is invalid.
+ */
+rt_err_t isotp_rtt_reset_stats(isotp_rtt_link_t link);
+#endif /* PKG_ISOTP_C_USING_STATS */
+
+#endif // __ISOTP_RTT_H__